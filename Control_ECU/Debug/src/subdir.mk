@@ -5,40 +5,106 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../src/Control_Application.c \
+../src/audit_log.c \
+../src/baud.c \
 ../src/buzzer.c \
+../src/config_store.c \
+../src/counters.c \
+../src/crc.c \
+../src/credentials.c \
 ../src/dc_motor.c \
+../src/dual_bank.c \
 ../src/external_eeprom.c \
+../src/flash_log.c \
 ../src/gpio.c \
+../src/heartbeat.c \
+../src/internal_eeprom.c \
+../src/link.c \
+../src/lockout.c \
+../src/otp.c \
+../src/password_hash.c \
+../src/ram_monitor.c \
+../src/rtc.c \
+../src/sha1.c \
+../src/sha256.c \
+../src/speck.c \
+../src/storage.c \
 ../src/timer.c \
+../src/trace.c \
 ../src/twi.c \
-../src/uart.c 
+../src/uart.c \
+../src/watchdog.c 
 
 OBJS += \
 ./src/Control_Application.o \
+./src/audit_log.o \
+./src/baud.o \
 ./src/buzzer.o \
+./src/config_store.o \
+./src/counters.o \
+./src/crc.o \
+./src/credentials.o \
 ./src/dc_motor.o \
+./src/dual_bank.o \
 ./src/external_eeprom.o \
+./src/flash_log.o \
 ./src/gpio.o \
+./src/heartbeat.o \
+./src/internal_eeprom.o \
+./src/link.o \
+./src/lockout.o \
+./src/otp.o \
+./src/password_hash.o \
+./src/ram_monitor.o \
+./src/rtc.o \
+./src/sha1.o \
+./src/sha256.o \
+./src/speck.o \
+./src/storage.o \
 ./src/timer.o \
+./src/trace.o \
 ./src/twi.o \
-./src/uart.o 
+./src/uart.o \
+./src/watchdog.o 
 
 C_DEPS += \
 ./src/Control_Application.d \
+./src/audit_log.d \
+./src/baud.d \
 ./src/buzzer.d \
+./src/config_store.d \
+./src/counters.d \
+./src/crc.d \
+./src/credentials.d \
 ./src/dc_motor.d \
+./src/dual_bank.d \
 ./src/external_eeprom.d \
+./src/flash_log.d \
 ./src/gpio.d \
+./src/heartbeat.d \
+./src/internal_eeprom.d \
+./src/link.d \
+./src/lockout.d \
+./src/otp.d \
+./src/password_hash.d \
+./src/ram_monitor.d \
+./src/rtc.d \
+./src/sha1.d \
+./src/sha256.d \
+./src/speck.d \
+./src/storage.d \
 ./src/timer.d \
+./src/trace.d \
 ./src/twi.d \
-./src/uart.d 
+./src/uart.d \
+./src/watchdog.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.c src/subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: AVR Compiler'
-	avr-gcc -Wall -g2 -gstabs -O0 -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
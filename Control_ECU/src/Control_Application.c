@@ -12,6 +12,8 @@
 
 #include <util/delay.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
 #include "Control_Application.h"
 #include "external_eeprom.h"
 #include "dc_motor.h"
@@ -19,11 +21,55 @@
 #include "buzzer.h"
 #include "timer.h"
 #include "uart.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "ram_monitor.h"
+#include "lockout.h"
+#include "password_hash.h"
+#include "link.h"
+#include "otp.h"
+#include "rtc.h"
+#include "credentials.h"
+#include "config_store.h"
+#include "crc.h"
 #include "Macros.h"
 
 
+/*******************************************************************************
+ *                           Configuration Table                               *
+ *******************************************************************************/
+
+/* Defaults and ranges of the configuration store keys, indexed by CTRL_ConfigKeyType */
+static const CFG_ItemType g_configItems[CONFIG_COUNT] PROGMEM = {
+	/* default                  min  max */
+	{ DOOR_UNLOCKING_PERIOD,    1,   255  },  /* CONFIG_DOOR_UNLOCKING_PERIOD  (sent to the HMI ECU in one byte) */
+	{ DOOR_LEFT_OPEN_PERIOD,    1,   255  },  /* CONFIG_DOOR_LEFT_OPEN_PERIOD  */
+	{ DOOR_LOCKING_PERIOD,      1,   255  },  /* CONFIG_DOOR_LOCKING_PERIOD    */
+	{ ALARM_ON_DELAY,           0,   3600 },  /* CONFIG_ALARM_ON_DELAY         */
+	{ LOCKOUT_FREE_ATTEMPTS,    1,   10   },  /* CONFIG_LOCKOUT_FREE_ATTEMPTS  */
+	{ LOCKOUT_BASE_PERIOD,      1,   1800 },  /* CONFIG_LOCKOUT_BASE_PERIOD    */
+	{ LOCKOUT_MAX_DOUBLINGS,    0,   5    },  /* CONFIG_LOCKOUT_MAX_DOUBLINGS  (1800 << 5 still fits the 16-bit period) */
+};
+
+/* Archive of the audit log, reserved in the image and programmed at run time */
+FLASHLOG_REGION(g_flashLogRegion, FLASH_LOG_PAGES);
+
 int main(void)
 {
+	/* Trace Configuration (must run before any driver logs an event):
+	 * Time base --> Timer1 counts of 128us, 7814 counts per compare interrupt (see Timer1 configuration)
+	 */
+	Trace_ConfigType traceConfig = { TRACE_ECU_CONTROL, 128, TIMER1_COMPARE_VALUE + 1 };
+	TRACE_init(&traceConfig);
+
+	/* Watchdog Configuration:
+	 * Tasks --> main task only, reset the MCU if it stops checking in for 3 seconds
+	 */
+	WDG_ConfigType wdgConfig = { 1, { CTRL_WDG_MAIN_TIMEOUT } };
+	WDG_init(&wdgConfig);
+
+	RAMMON_init();                  /* Sampled every second by CTRL_timerCallBack */
+
 	SET_BIT(SREG, PIN7_ID);       /* Enable Global Interrupts (I-Bit) */
 
 	/* Timer Configuration:
@@ -35,17 +81,24 @@ int main(void)
 	 * AS FCPU = 8MHz so Ftimer = 8MHz/1024 = 128us & To force timer to produce interrupt every 1 second
 	 * SO Compare Value = 1/128us = 7813
 	 */
-	Timer_ConfigType timerConfig = { TIMER1, COMPARE_MODE, 0, 7813, FCPU_1024, DUMMY };
+	Timer_ConfigType timerConfig = { TIMER1, COMPARE_MODE, 0, TIMER1_COMPARE_VALUE, FCPU_1024, DUMMY };
+
+	/* RTC Configuration:
+	 * Tick --> Timer1 compare interrupt, 7814 counts of 128us = 1.000192 seconds (the 192us are compensated)
+	 */
+	RTC_ConfigType rtcConfig = { RTC_TICK_MICROSECONDS };
+	RTC_init(&rtcConfig);
+
 	Timer_setCallBack(CTRL_timerCallBack, TIMER1);
 	Timer_init(&timerConfig);
 
 	/* UART Configuration:
-	 * BaudRate --> 9600 Bps
+	 * BaudRate --> 9600 Bps until the HMI ECU negotiates a faster rate
 	 * CharacterSize --> 8 Data Bits
 	 * ParityMode --> No Parity
 	 * No. of Stop Bits --> One Stop Bit
 	 */
-	UART_ConfigType uartConfig = { 9600, DATA_EIGHT, NO_PARITY, ONE_STOP_BIT };
+	UART_ConfigType uartConfig = { LINK_BOOT_BAUD, DATA_EIGHT, NO_PARITY, ONE_STOP_BIT };
 	UART_init(&uartConfig);
 
 	/* TWI(I2C) Configuration:
@@ -56,67 +109,173 @@ int main(void)
 	TWI_ConfigType twiConfig = { 0x02, TWI_CONTROL_ECU_ADDRESS, PRESCALER_1 };
 	TWI_init(&twiConfig);
 
+	/* External EEPROM Configuration:
+	 * Device --> 24C16, 8-bit addresses with A8..A10 in the device address, 16-byte pages, 5 ms write cycle
+	 * A larger part (up to the 64 KB 24C512) only needs another profile
+	 */
+	EEPROM_ConfigType eepromConfig = EEPROM_PROFILE;
+	EEPROM_init(&eepromConfig);
+
+	/* Configuration Store:
+	 * 8 pages of 16 bytes, the values are replayed once into RAM and read from there
+	 */
+	CFG_ConfigType cfgConfig = { EEPROM_CONFIG_ADDRESS, CONFIG_PAGES, g_configItems, CONFIG_COUNT };
+	CFG_init(&cfgConfig);
+
+	/* Audit Log Configuration:
+	 * 80 records of 8 bytes between the OTP counter and the lifetime counters, appended behind the responses
+	 */
+	AUDIT_ConfigType auditConfig = { EEPROM_AUDIT_ADDRESS, AUDIT_RECORDS, CTRL_archiveAudit };
+	AUDIT_init(&auditConfig);
+
+	/* Flash Log Configuration:
+	 * 48 pages of 128 bytes that keep every audit record after the EEPROM ring overwrites it
+	 */
+	FLASHLOG_ConfigType flashLogConfig = { g_flashLogRegion, FLASH_LOG_PAGES };
+	FLASHLOG_init(&flashLogConfig);
+
+	/* Lifetime Counters Configuration:
+	 * 4 counters with a ring of 2 pages of 16 bytes each, read from their RAM mirror
+	 */
+	COUNTER_ConfigType counterConfig = { EEPROM_COUNTERS_ADDRESS, CTRL_COUNTER_COUNT, COUNTER_PAGES };
+	COUNTER_init(&counterConfig);
+
 	/* Initialize DC MOTOR & BUZZER */
 	DcMotor_Init();
 	BUZZER_init();
 
-	CTRL_SystemPasswordInit(g_receivedPassword);
+	/* Lockout Configuration:
+	 * 3 wrong passwords in a row --> 60 seconds lockout, doubled by every wrong password after it (up to 32 minutes)
+	 * by default, the policy comes from the configuration store
+	 * The consecutive failures are kept in the internal EEPROM so a power cycle does not reset them
+	 */
+	LOCKOUT_ConfigType lockoutConfig = { (uint8)CFG_get(CONFIG_LOCKOUT_FREE_ATTEMPTS), CFG_get(CONFIG_LOCKOUT_BASE_PERIOD),
+										 (uint8)CFG_get(CONFIG_LOCKOUT_MAX_DOUBLINGS), &STORAGE_internalEeprom, IEEPROM_LOCKOUT_ADDRESS };
+	LOCKOUT_init(&lockoutConfig);
+
+	/* Link Configuration:
+	 * Role --> responder, the HMI ECU starts the nonce exchange
+	 * Boot counter of the nonces --> internal EEPROM
+	 * A REKEY tells an HMI that is already running that its session is gone
+	 */
+	LINK_ConfigType linkConfig = { LINK_ROLE_RESPONDER, LINK_NONCE_EEPROM_ADDRESS };
+	LINK_init(&linkConfig);
+	LINK_connect();
+
+	/* Heartbeat Configuration:
+	 * Ping every 2 seconds, the HMI ECU is down after 6 seconds without any message (reported to the diagnostics tool)
+	 */
+	HB_ConfigType heartbeatConfig = { HEARTBEAT_PERIOD, HEARTBEAT_TIMEOUT };
+	HB_init(&heartbeatConfig);
+
+	/* Baud Rate Configuration:
+	 * The rate proposed by the HMI ECU is accepted up to 250000 Bps, back to 9600 Bps when the HMI ECU is down
+	 */
+	BAUD_ConfigType baudConfig = { LINK_BOOT_BAUD, LINK_FASTEST_BAUD, LINK_BAUD_TIMEOUT, CTRL_WDG_TASK_MAIN };
+	BAUD_init(&baudConfig);
+
+	/* One-Time Access Codes Configuration:
+	 * Mode --> TOTP, 6 digits, a new code every 30 seconds
+	 * Window --> the previous and the next code are also accepted (clock skew of the tokens)
+	 * Last used code --> EEPROM, so a code can never be used twice even across a reset
+	 */
+	OTP_ConfigType otpConfig = { OTP_MODE_TOTP, ACCESS_CODE_LENGTH, ACCESS_CODE_TIME_STEP, ACCESS_CODE_WINDOW, EEPROM_OTP_ADDRESS };
+	OTP_init(&otpConfig);
+
+	/* Users Configuration:
+	 * 31 slots of 32 bytes hashed on the PBKDF2 digest of the code, in the upper KB of the 24C16
+	 * The header has two banks (its first 16 bytes and the last 16 bytes of the 24C16)
+	 */
+	CRED_ConfigType credConfig = { EEPROM_CREDENTIALS_ADDRESS, CREDENTIAL_SLOTS, EEPROM_CREDENTIALS_HEADER_COPY };
+	CRED_init(&credConfig);
 
-	uint8 receivedByte = 0;
+	/* Create the system password on the first run only */
+	if (!CTRL_isPasswordStored())
+	{
+		CTRL_SystemPasswordInit(g_receivedPassword);
+	}
+
+	const uint8 *message;
+	uint8 length;
+	uint8 command;
+	uint8 verification;
 
 	while (1)
 	{
-		if (UART_recieveByte() == READY_TO_SEND)
+		TRACE_setState(LOCKOUT_getRemaining() ? CTRL_STATE_LOCKED_OUT : CTRL_STATE_WAIT_COMMAND);
+		message = CTRL_receiveMessage(&length);
+		command = message[0];
+
+		if (command == SYSTEM_STATUS_REQUEST)
+		{
+			CTRL_sendSystemStatus();
+		}
+		else if ((command == OPEN_DOOR_OPTION) && (length == 1 + PASSWORD_LENGTH))
 		{
-			CTRL_receivePasswordByUART(g_receivedPassword);
-			receivedByte = UART_recieveByte();
+			TRACE_setState(CTRL_STATE_RECEIVE_COMMAND);
+			memcpy(g_receivedPassword, &message[1], PASSWORD_LENGTH);
 
-			if (receivedByte == OPEN_DOOR_OPTION)
+			if (LOCKOUT_getRemaining() != 0)
 			{
-				if (CTRL_comparePasswords(g_storedPassword, g_receivedPassword) == PASSWORD_MATCHED)
+				/* Attempts during a lockout are not even checked */
+				CTRL_sendLockoutStatus(LOCKOUT_getRemaining());
+			}
+			else
+			{
+				verification = CTRL_verifyPassword(g_receivedPassword);
+				if (verification == PASSWORD_MATCHED)
 				{
-					UART_sendByte(UNLOCKING_DOOR); /* inform HMI ECU to display that door is unlocking */
-					CTRL_OpenDoor();               /* start opening door process/task */
-					g_wrongPasswordCounter = 0;    /* reset the counter */
+					LOCKOUT_registerSuccess();
+					CTRL_sendUnlockingDoor();          /* inform HMI ECU to display that door is unlocking */
+					AUDIT_record(AUDIT_EVT_DOOR_OPENED, AUDIT_BY_PASSWORD, CTRL_getMatchedUser());
+					CTRL_OpenDoor();                   /* start opening door process/task */
+				}
+				else if (verification == PASSWORD_NOT_CHECKED)
+				{
+					CTRL_sendResponse(WRONG_PASSWORD); /* Refused, but not counted */
 				}
 				else
 				{
-					UART_sendByte(WRONG_PASSWORD);
-
-					/* Count number of wrong attempts, and turn on a buzzer of it exceeds the limit */
-					g_wrongPasswordCounter++;
-					if (g_wrongPasswordCounter == NUMBER_OF_WRONG_PASSWORD_ATTEMPTS)
-					{
-						BUZZER_ON();
-						g_sec = 0;
-						while (g_sec < ALARM_ON_DELAY); /* turn on alarm for a certain period */
-						BUZZER_OFF();
-						g_wrongPasswordCounter = 0; /* reset the counter */
-					}
+					/* A known password refused by its validity window is logged apart */
+					CTRL_handleWrongPassword((g_matchedSlot != CRED_NOT_FOUND) ? AUDIT_BY_PASSWORD_OUT_OF_WINDOW : AUDIT_BY_PASSWORD);
 				}
 			}
-			else if (receivedByte == CHANGE_PASSWORD_OPTION)
+		}
+		else if ((command == CHANGE_PASSWORD_OPTION) && (length == 1 + 2 * PASSWORD_LENGTH))
+		{
+			TRACE_setState(CTRL_STATE_RECEIVE_COMMAND);
+			CTRL_changePassword(&message[1], &message[1 + PASSWORD_LENGTH]);
+		}
+		else if ((command == USER_ADD_REQUEST) || (command == USER_REVOKE_REQUEST) || (command == USER_LIST_REQUEST))
+		{
+			TRACE_setState(CTRL_STATE_RECEIVE_COMMAND);
+			CTRL_manageUsers(message, length);
+		}
+		else if ((command == ACCESS_CODE_OPTION) && (length == 1 + ACCESS_CODE_LENGTH))
+		{
+			TRACE_setState(CTRL_STATE_RECEIVE_COMMAND);
+
+			if (LOCKOUT_getRemaining() != 0)
 			{
-				if (CTRL_comparePasswords(g_storedPassword, g_receivedPassword) == PASSWORD_MATCHED)
-				{
-					UART_sendByte(CHANGING_PASSWORD); /* inform HMI to process changing password */
-					CTRL_SystemPasswordInit(g_receivedPassword);
-					g_wrongPasswordCounter = 0;    /* reset the counter */
-				}
-				else
+				CTRL_sendLockoutStatus(LOCKOUT_getRemaining());
+			}
+			else
+			{
+				/* Wrong codes count in the same lockout as wrong passwords */
+				switch (OTP_verify(&message[1]))
 				{
-					UART_sendByte(WRONG_PASSWORD);
-
-					/* Count number of wrong attempts, and turn on a buzzer of it exceeds the limit */
-					g_wrongPasswordCounter++;
-					if (g_wrongPasswordCounter == NUMBER_OF_WRONG_PASSWORD_ATTEMPTS)
-					{
-						BUZZER_ON();
-						g_sec = 0;
-						while (g_sec < ALARM_ON_DELAY); /* turn on alarm for a certain period */
-						BUZZER_OFF();
-						g_wrongPasswordCounter = 0; /* reset the counter */
-					}
+				case OTP_ACCEPTED:
+					LOCKOUT_registerSuccess();
+					CTRL_sendUnlockingDoor();
+					AUDIT_record(AUDIT_EVT_DOOR_OPENED, AUDIT_BY_ACCESS_CODE, AUDIT_USER_NONE);
+					CTRL_OpenDoor();
+					break;
+				case OTP_NO_CLOCK:
+					CTRL_sendResponse(ACCESS_CODE_UNAVAILABLE);
+					break;
+				default:
+					CTRL_handleWrongPassword(AUDIT_BY_ACCESS_CODE);
+					break;
 				}
 			}
 		}
@@ -129,24 +288,46 @@ int main(void)
  *******************************************************************************/
 
 /*
- * Description: a function to compare the stored pass with the received one
+ * Description: a function to compare two passwords in constant time (password and its confirmation)
  */
 uint8 CTRL_comparePasswords(const uint8 *a_password1,const uint8 *a_password2)
 {
+	return PWHASH_isEqual(a_password1, a_password2, PASSWORD_LENGTH) ? PASSWORD_MATCHED : PASSWORD_UNMATCHED;
+}
+
+/*
+ * Description: a function to look the received password up in the users table and check the validity window of its user,
+ *              PASSWORD_NOT_CHECKED if the table could not be read
+ */
+uint8 CTRL_verifyPassword(const uint8 *a_password)
+{
+	g_matchedSlot = CRED_lookup(a_password, PASSWORD_LENGTH, &g_matchedUser);
+	if (g_matchedSlot == CRED_READ_FAILED)
+	{
+		/* The code may be right, a bus error must not count towards the lockout */
+		g_matchedSlot = CRED_NOT_FOUND;
+		return PASSWORD_NOT_CHECKED;
+	}
+	if (g_matchedSlot != CRED_NOT_FOUND)
+	{
+		return CRED_isValidAt(&g_matchedUser, RTC_getTime(), RTC_isSet()) ? PASSWORD_MATCHED : PASSWORD_UNMATCHED;
+	}
+
+	/* Password of an older firmware: it becomes the administrator at its first use (no cost once moved) */
 	CTRL_updateStoredPassword();
-	uint8 i;
-	for (i = 0; i < PASSWORD_LENGTH; i++)
+	if (PWHASH_verify(&g_storedCredential, a_password, PASSWORD_LENGTH) && CTRL_addAdministrator(a_password))
 	{
-		if (a_password1[i] != a_password2[i])
-		{
-			return PASSWORD_UNMATCHED;
-		}
+		g_storedCredential.magic = 0xFFFF;
+		EEPROM_writeBlock(EEPROM_STORE_ADDREESS, (const uint8 *)&g_storedCredential.magic, sizeof(g_storedCredential.magic));
+
+		g_matchedSlot = CRED_lookup(a_password, PASSWORD_LENGTH, &g_matchedUser);
+		return PASSWORD_MATCHED;
 	}
-	return PASSWORD_MATCHED;
+	return PASSWORD_UNMATCHED;
 }
 
 /*
- * Description: a function to initialize the password in first-run OR to change the password
+ * Description: a function to initialize the password in first-run
  */
 void CTRL_SystemPasswordInit(uint8 *pass)
 {
@@ -156,28 +337,78 @@ void CTRL_SystemPasswordInit(uint8 *pass)
 
 	while (!matchingFlag)
 	{
-		while (UART_recieveByte() != READY_TO_SEND);   /* wait till HMI gets ready */
-		UART_sendByte(READY_TO_RECEIVE);               /* inform HMI that Control ECU ready to receive the password */
+		TRACE_setState(CTRL_STATE_WAIT_PASSWORD);
+		CTRL_waitReadyToSend();                        /* wait till HMI gets ready */
+		CTRL_sendResponse(READY_TO_RECEIVE);           /* inform HMI that Control ECU ready to receive the password */
+		TRACE_setState(CTRL_STATE_RECEIVE_PASSWORD);
 		CTRL_receivePasswordByUART(pass);
 
-		while (UART_recieveByte() != READY_TO_SEND);
-		UART_sendByte(READY_TO_RECEIVE);               /* inform HMI to send the confirmation password */
+		TRACE_setState(CTRL_STATE_WAIT_CONFIRMATION);
+		CTRL_waitReadyToSend();
+		CTRL_sendResponse(READY_TO_RECEIVE);           /* inform HMI to send the confirmation password */
+		TRACE_setState(CTRL_STATE_RECEIVE_CONFIRMATION);
 		CTRL_receivePasswordByUART(confirmationPassword);
 
-		if (CTRL_comparePasswords(pass, confirmationPassword) == PASSWORD_MATCHED)
+		/* A code already used by another user is refused like a mismatch, the code is the lookup key */
+		TRACE_setState(CTRL_STATE_STORE_PASSWORD);
+		if ((CTRL_comparePasswords(pass, confirmationPassword) == PASSWORD_MATCHED) && CTRL_storePassword())
 		{
-			UART_sendByte(READY_TO_SEND);
-			UART_sendByte(PASSWORD_MATCHED);
-			CTRL_storePassword();
+			CTRL_sendResponse(READY_TO_SEND);
+			CTRL_sendResponse(PASSWORD_MATCHED);
+			AUDIT_record(AUDIT_EVT_PASSWORD_CHANGED, 0,
+						 (g_matchedSlot != CRED_NOT_FOUND) ? g_matchedUser.userId : CTRL_ADMIN_USER_ID);
 			matchingFlag = 1;
 		}
 
 		else
 		{
-			UART_sendByte(READY_TO_SEND);
-			UART_sendByte(PASSWORD_UNMATCHED);
+			CTRL_sendResponse(READY_TO_SEND);
+			CTRL_sendResponse(PASSWORD_UNMATCHED);
+		}
+	}
+}
+
+/*
+ * Description: a function to change the password of the matched user in a single transaction, the HMI already
+ *              matched the new password with its confirmation. One status is sent once the new one is stored.
+ */
+void CTRL_changePassword(const uint8 *a_oldPassword, const uint8 *a_newPassword)
+{
+	uint8 verification;
+
+	if (LOCKOUT_getRemaining() != 0)
+	{
+		/* Attempts during a lockout are not even checked */
+		CTRL_sendLockoutStatus(LOCKOUT_getRemaining());
+		return;
+	}
+
+	verification = CTRL_verifyPassword(a_oldPassword);
+	if (verification == PASSWORD_MATCHED)
+	{
+		LOCKOUT_registerSuccess();
+
+		/* A code already used by another user is refused like a mismatch, the code is the lookup key */
+		TRACE_setState(CTRL_STATE_STORE_PASSWORD);
+		memcpy(g_receivedPassword, a_newPassword, PASSWORD_LENGTH);
+		if (CTRL_storePassword())
+		{
+			CTRL_sendResponse(PASSWORD_MATCHED);
+			AUDIT_record(AUDIT_EVT_PASSWORD_CHANGED, 0, g_matchedUser.userId);
+		}
+		else
+		{
+			CTRL_sendResponse(PASSWORD_UNMATCHED);
 		}
 	}
+	else if (verification == PASSWORD_NOT_CHECKED)
+	{
+		CTRL_sendResponse(PASSWORD_UNMATCHED);         /* Like a failed store, not counted */
+	}
+	else
+	{
+		CTRL_handleWrongPassword((g_matchedSlot != CRED_NOT_FOUND) ? AUDIT_BY_PASSWORD_OUT_OF_WINDOW : AUDIT_BY_PASSWORD);
+	}
 }
 
 /* Description:
@@ -187,22 +418,28 @@ void CTRL_SystemPasswordInit(uint8 *pass)
  */
 void CTRL_OpenDoor(void)
 {
+	TRACE_setState(CTRL_STATE_OPEN_DOOR);
+
 	/* run the DC motor clockwise for 15 seconds */
-	g_sec = 0;
 	DcMotor_Rotate(CLOCKWISE);
-	while (g_sec < DOOR_UNLOCKING_PERIOD);
+	AUDIT_flush();                             /* Nothing is received while the door moves */
+	FLASHLOG_flush();
+	CTRL_runDoorPhase(DOOR_PHASE_UNLOCKING, CFG_get(CONFIG_DOOR_UNLOCKING_PERIOD));
 
 	/* let the door be open for 3 seconds */
-	g_sec = 0;
 	DcMotor_Rotate(STOP);
-	while (g_sec < DOOR_LEFT_OPEN_PERIOD);
+	COUNTER_add(CTRL_COUNTER_UNLOCKS, 1);
+	COUNTER_add(CTRL_COUNTER_MOTOR_SECONDS, CFG_get(CONFIG_DOOR_UNLOCKING_PERIOD));
+	CTRL_runDoorPhase(DOOR_PHASE_OPEN, CFG_get(CONFIG_DOOR_LEFT_OPEN_PERIOD));
 
 	/* hold the system for 15 seconds & display to user that door is locking */
-	g_sec = 0;
 	DcMotor_Rotate(Anti_CLOCKWISE);
-	while (g_sec < DOOR_LOCKING_PERIOD);
+	CTRL_runDoorPhase(DOOR_PHASE_LOCKING, CFG_get(CONFIG_DOOR_LOCKING_PERIOD));
 
 	DcMotor_Rotate(STOP);
+	COUNTER_add(CTRL_COUNTER_MOTOR_SECONDS, CFG_get(CONFIG_DOOR_LOCKING_PERIOD));
+	CTRL_sendDoorProgress(DOOR_PHASE_CLOSED, 0, 0);
+	HB_hold();                                 /* The pings of the HMI were not read, it is not down */
 }
 
 /*
@@ -211,42 +448,628 @@ void CTRL_OpenDoor(void)
 void CTRL_timerCallBack(void)
 {
 	g_sec++;
+	if (g_linkIdleSeconds != 0xFF)
+	{
+		g_linkIdleSeconds++;
+	}
+	RTC_tick();
+	LOCKOUT_tick();
+	WDG_supervise();
+	RAMMON_sample();
 }
 
 /*
- * Description: A function to receive the password via UART by looping on receiveByte function
+ * Description: A function to wait for a message from the HMI (whose arrival depends on the user), the main task keeps
+ *              checking in with the watchdog and serves the diagnostics requests and the link handshake while waiting
  */
-void CTRL_receivePasswordByUART(uint8 * pass)
+const uint8* CTRL_receiveMessage(uint8 *length)
 {
-	uint8 i;
-	for (i = 0; i < PASSWORD_LENGTH; i++)
+	const uint8 *message;
+	UART_RxStatusType status;
+	uint8 data;
+
+	while (1)
+	{
+		while (!UART_isByteReceived())
+		{
+			WDG_checkIn(CTRL_WDG_TASK_MAIN);
+			CTRL_serviceLockout();
+			CTRL_serviceAudit();
+			if (HB_service() == HB_EVENT_PEER_DOWN)
+			{
+				BAUD_fallback();
+			}
+		}
+		PWHASH_addEntropy((uint8)TCNT1);     /* The arrival time depends on the user */
+		status = UART_readByte(&data);
+		g_linkIdleSeconds = 0;
+
+		/* A line error drops the frame being received, a corrupted byte is not fed at all */
+		if (status != UART_RX_OK)
+		{
+			LINK_resync();
+			if (status != UART_RX_OVERRUN)
+				continue;
+		}
+
+		switch (LINK_receiveByte(data))
+		{
+		case LINK_RX_MESSAGE:
+			message = LINK_getMessage(length);
+			if ((*length != 0) && !HB_handleMessage(message, *length) && !BAUD_handleMessage(message, *length))
+			{
+				return message;
+			}
+			break;
+		case LINK_RX_RAW:
+			CTRL_serveDiagnostics(data);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*
+ * Description: A function to answer a diagnostics request byte received outside the link frames
+ */
+void CTRL_serveDiagnostics(uint8 request)
+{
+	switch (request)
+	{
+	case TRACE_DUMP_REQUEST:
+		TRACE_dump();
+		break;
+	case RESET_REPORT_REQUEST:
+		WDG_sendResetReport();
+		break;
+	case RAM_REPORT_REQUEST:
+		RAMMON_sendReport();
+		break;
+	case HASH_BENCHMARK_REQUEST:
+		PWHASH_sendBenchmark(PASSWORD_VERIFY_BUDGET_MS);
+		break;
+	case LINK_BENCHMARK_REQUEST:
+		LINK_sendBenchmark();
+		break;
+	case OTP_BENCHMARK_REQUEST:
+		OTP_sendBenchmark();
+		break;
+	case CLOCK_SET_REQUEST:
+		CTRL_setClock();
+		break;
+	case AUDIT_QUERY_REQUEST:
+		CTRL_queryAudit();
+		break;
+	case CONFIG_SET_REQUEST:
+		CTRL_setConfig();
+		break;
+	case CONFIG_DUMP_REQUEST:
+		CTRL_sendConfig();
+		break;
+	case COUNTERS_REQUEST:
+		COUNTER_sendReport();
+		break;
+	case FLASH_LOG_QUERY_REQUEST:
+		CTRL_queryFlashLog();
+		break;
+	case LINE_ERRORS_REQUEST:
+		UART_sendErrorReport();
+		break;
+	case HEARTBEAT_REPORT_REQUEST:
+		HB_sendReport();
+		break;
+#if CRC_BENCHMARK_ENABLE
+	case CRC_BENCHMARK_REQUEST:
+		CRC_sendBenchmark();
+		break;
+#endif
+	default:
+		break;
+	}
+}
+
+/*
+ * Description: A function to set the clock from the provisioning tool: challenge, then the time and its tag
+ *              computed with the link master key. The clock never goes backwards while it is set.
+ */
+void CTRL_setClock(void)
+{
+	uint8 answer[4 + LINK_TAG_SIZE];
+	uint32 time;
+	uint8 result = FALSE;
+
+	LINK_sendToolChallenge();
+
+	if (CTRL_receiveRawBytes(answer, sizeof(answer)) && LINK_isToolTagValid(answer, 4, &answer[4]))
+	{
+		time = ((uint32)answer[3] << 24) | ((uint32)answer[2] << 16) | ((uint16)answer[1] << 8) | answer[0];
+		if (!RTC_isSet() || (time >= RTC_getTime()))
+		{
+			RTC_setTime(time);
+			result = TRUE;
+		}
+	}
+
+	AUDIT_record(AUDIT_EVT_CLOCK_SET, result, AUDIT_USER_NONE);
+	UART_sendByte(CLOCK_REPORT_SYNC1);
+	UART_sendByte(CLOCK_REPORT_SYNC2);
+	UART_sendByte(result);
+}
+
+/*
+ * Description: A function to receive the bytes following a diagnostics request, FALSE if they do not arrive in time
+ */
+uint8 CTRL_receiveRawBytes(uint8 *data, uint8 length)
+{
+	uint16 start = g_sec;
+	uint8 i = 0;
+
+	while (i < length)
+	{
+		if (UART_isByteReceived())
+		{
+			/* A byte lost or corrupted on the line fails the request, the tool sends it again */
+			if (UART_readByte(&data[i]) != UART_RX_OK)
+				return FALSE;
+			i++;
+		}
+		else if ((uint16)(g_sec - start) > DIAG_PAYLOAD_TIMEOUT)
+		{
+			return FALSE;
+		}
+		WDG_checkIn(CTRL_WDG_TASK_MAIN);
+	}
+	return TRUE;
+}
+
+/*
+ * Description: A function to send a one byte message to the HMI through the link
+ */
+void CTRL_sendResponse(uint8 response)
+{
+	(void)LINK_sendMessage(&response, 1);
+}
+
+/*
+ * Description: A function to wait for the HMI to be ready to send a new password, answering its status requests meanwhile
+ */
+void CTRL_waitReadyToSend(void)
+{
+	const uint8 *message;
+	uint8 length;
+
+	do
+	{
+		message = CTRL_receiveMessage(&length);
+		if (message[0] == SYSTEM_STATUS_REQUEST)
+		{
+			CTRL_sendResponse(PASSWORD_NOT_SET);   /* The HMI was reset while a password is being created */
+		}
+	} while (message[0] != READY_TO_SEND);
+}
+
+/*
+ * Description: A function to answer the HMI status request with the lockout status, SYSTEM_READY or PASSWORD_NOT_SET
+ */
+void CTRL_sendSystemStatus(void)
+{
+	uint16 remaining = LOCKOUT_getRemaining();
+
+	if (remaining != 0)
+	{
+		CTRL_sendLockoutStatus(remaining);
+	}
+	else
+	{
+		CTRL_sendResponse(SYSTEM_READY);
+	}
+}
+
+/*
+ * Description: A function to send LOCKOUT_STATUS followed by the remaining lockout seconds
+ */
+void CTRL_sendLockoutStatus(uint16 remaining)
+{
+	uint8 message[3];
+
+	message[0] = LOCKOUT_STATUS;
+	message[1] = (uint8)remaining;
+	message[2] = (uint8)(remaining >> 8);
+
+	/* Without a session the push is retried, and the HMI asks for the status once connected */
+	if (LINK_sendMessage(message, sizeof(message)))
+	{
+		g_lockoutReported = remaining;
+	}
+}
+
+/*
+ * Description: A function to count a wrong password, it answers WRONG_PASSWORD or starts a lockout with the buzzer on
+ */
+void CTRL_handleWrongPassword(AUDIT_ResultType method)
+{
+	uint16 period = LOCKOUT_registerFailure();
+
+	COUNTER_add(CTRL_COUNTER_FAILED_ATTEMPTS, 1);
+	AUDIT_record(AUDIT_EVT_ACCESS_DENIED, method, (method == AUDIT_BY_ACCESS_CODE) ? AUDIT_USER_NONE : CTRL_getMatchedUser());
+	if (period != 0)
+	{
+		AUDIT_record(AUDIT_EVT_LOCKOUT, 0, AUDIT_USER_NONE);
+	}
+
+	if (period == 0)
+	{
+		CTRL_sendResponse(WRONG_PASSWORD);
+	}
+	else
+	{
+		CTRL_sendLockoutStatus(period);
+		BUZZER_ON();
+		g_alarmStart = g_sec;
+		g_alarmOn = TRUE;
+		COUNTER_add(CTRL_COUNTER_ALARMS, 1);
+	}
+}
+
+/*
+ * Description: A function to write the queued audit records once the link is quiet, called while the main task is idle
+ */
+void CTRL_serviceAudit(void)
+{
+	/* A write cycle blocks for milliseconds, long enough to overrun the UART if a frame was arriving */
+	if (AUDIT_hasPending() && (g_linkIdleSeconds >= AUDIT_FLUSH_IDLE_SECONDS))
+	{
+		AUDIT_flush();
+	}
+	/* A page program also stops the interrupts for about 9 ms */
+	if (FLASHLOG_hasPending() && (g_linkIdleSeconds >= AUDIT_FLUSH_IDLE_SECONDS))
+	{
+		FLASHLOG_flush();
+	}
+}
+
+/*
+ * Description: A function to answer an audit log query of the diagnostics tool
+ */
+void CTRL_queryAudit(void)
+{
+	uint8 query[AUDIT_QUERY_PAYLOAD];
+
+	if (CTRL_receiveRawBytes(query, sizeof(query)))
+	{
+		AUDIT_sendRecords((AUDIT_QueryType)query[0], CTRL_getLong(&query[1]));
+	}
+}
+
+/*
+ * Description: A function to copy an audit record written to the EEPROM into the flash log
+ */
+void CTRL_archiveAudit(const AUDIT_RecordType *record)
+{
+	FLASHLOG_append((const uint8 *)record);
+}
+
+/*
+ * Description: A function to answer a flash log query of the diagnostics tool
+ */
+void CTRL_queryFlashLog(void)
+{
+	uint8 query[FLASH_LOG_QUERY_PAYLOAD];
+
+	if (CTRL_receiveRawBytes(query, sizeof(query)))
+	{
+		FLASHLOG_sendRecords(query[0] | ((uint16)query[1] << 8));
+	}
+}
+
+/*
+ * Description: A function to store a configuration value sent by the provisioning tool, authenticated like the clock
+ */
+void CTRL_setConfig(void)
+{
+	uint8 answer[3 + LINK_TAG_SIZE];
+	uint8 status = CFG_INVALID_KEY;
+
+	LINK_sendToolChallenge();
+
+	if (CTRL_receiveRawBytes(answer, sizeof(answer)) && LINK_isToolTagValid(answer, 3, &answer[3]))
+	{
+		status = CFG_set(answer[0], answer[1] | ((uint16)answer[2] << 8));
+		if ((status == CFG_OK) && (answer[0] >= CONFIG_LOCKOUT_FREE_ATTEMPTS))
+		{
+			CTRL_applyLockoutPolicy();
+		}
+		AUDIT_record(AUDIT_EVT_CONFIG_CHANGED, status, answer[0]);
+	}
+
+	UART_sendByte(CONFIG_RESULT_SYNC1);
+	UART_sendByte(CONFIG_RESULT_SYNC2);
+	UART_sendByte(status);
+}
+
+/*
+ * Description: A function to send every configuration value to the diagnostics tool
+ */
+void CTRL_sendConfig(void)
+{
+	uint8 key;
+
+	UART_sendByte(CONFIG_DUMP_SYNC1);
+	UART_sendByte(CONFIG_DUMP_SYNC2);
+	UART_sendByte(CONFIG_COUNT);
+	for (key = 0; key < CONFIG_COUNT; key++)
+	{
+		UART_sendByte((uint8)CFG_get(key));
+		UART_sendByte((uint8)(CFG_get(key) >> 8));
+	}
+}
+
+/*
+ * Description: A function to hand the lockout keys of the configuration store to the lockout module
+ */
+void CTRL_applyLockoutPolicy(void)
+{
+	LOCKOUT_setPolicy((uint8)CFG_get(CONFIG_LOCKOUT_FREE_ATTEMPTS), CFG_get(CONFIG_LOCKOUT_BASE_PERIOD),
+					  (uint8)CFG_get(CONFIG_LOCKOUT_MAX_DOUBLINGS));
+}
+
+/*
+ * Description: A function to answer UNLOCKING_DOOR with the door periods, so the HMI ECU follows the configuration
+ */
+void CTRL_sendUnlockingDoor(void)
+{
+	uint8 message[1 + DOOR_PERIODS_PAYLOAD];
+
+	message[0] = UNLOCKING_DOOR;
+	message[1] = (uint8)CFG_get(CONFIG_DOOR_UNLOCKING_PERIOD);
+	message[2] = (uint8)CFG_get(CONFIG_DOOR_LEFT_OPEN_PERIOD);
+	message[3] = (uint8)CFG_get(CONFIG_DOOR_LOCKING_PERIOD);
+	(void)LINK_sendMessage(message, sizeof(message));
+}
+
+/*
+ * Description: A function to run one phase of the door for its period, the HMI ECU is told the progress every second
+ */
+void CTRL_runDoorPhase(uint8 phase, uint16 period)
+{
+	uint16 elapsed;
+
+	g_sec = 0;
+	CTRL_sendDoorProgress(phase, 0, period);
+	elapsed = 0;
+	while (g_sec < period)
+	{
+		WDG_checkIn(CTRL_WDG_TASK_MAIN);
+		if (g_sec != elapsed)
+		{
+			elapsed = g_sec;
+			if (elapsed < period)
+			{
+				CTRL_sendDoorProgress(phase, elapsed, period);
+			}
+		}
+	}
+}
+
+/*
+ * Description: A function to send DOOR_PROGRESS with the phase, its percentage done and its remaining seconds
+ */
+void CTRL_sendDoorProgress(uint8 phase, uint16 elapsed, uint16 period)
+{
+	uint8 message[1 + DOOR_PROGRESS_PAYLOAD];
+
+	message[0] = DOOR_PROGRESS;
+	message[1] = phase;
+	message[2] = (period != 0) ? (uint8)((elapsed * 100UL) / period) : 100;
+	message[3] = (uint8)(period - elapsed);
+	(void)LINK_sendMessage(message, sizeof(message));
+}
+
+/*
+ * Description: A function to return the user of the last verified password for the audit log
+ */
+uint8 CTRL_getMatchedUser(void)
+{
+	return (g_matchedSlot != CRED_NOT_FOUND) ? g_matchedUser.userId : AUDIT_USER_NONE;
+}
+
+/*
+ * Description: A function to push the remaining lockout time to the HMI every second and stop the buzzer,
+ *              called while the main task is idle
+ */
+void CTRL_serviceLockout(void)
+{
+	uint16 remaining = LOCKOUT_getRemaining();
+
+	if (g_alarmOn && ((remaining == 0) || ((uint16)(g_sec - g_alarmStart) >= CFG_get(CONFIG_ALARM_ON_DELAY))))
 	{
-		pass[i] = UART_recieveByte();
-		_delay_ms(100);
+		BUZZER_OFF();
+		g_alarmOn = FALSE;
+	}
+
+	/* The last push (0) tells the HMI that the lockout is over */
+	if (remaining != g_lockoutReported)
+	{
+		CTRL_sendLockoutStatus(remaining);
 	}
 }
 
 /*
- * Description: A function to retrieve the stored password from EEPROM
+ * Description: A function to check whether an administrator password was stored in EEPROM (not the first run)
+ */
+uint8 CTRL_isPasswordStored(void)
+{
+	CTRL_updateStoredPassword();
+	return CRED_hasAdmin() || PWHASH_isValid(&g_storedCredential);
+}
+
+/*
+ * Description: A function to wait for the PASSWORD_DATA message and copy the password it carries
+ */
+void CTRL_receivePasswordByUART(uint8 * pass)
+{
+	const uint8 *message;
+	uint8 length;
+
+	do
+	{
+		message = CTRL_receiveMessage(&length);
+	} while ((message[0] != PASSWORD_DATA) || (length != 1 + PASSWORD_LENGTH));
+
+	memcpy(pass, &message[1], PASSWORD_LENGTH);
+}
+
+/*
+ * Description: A function to retrieve the password record of an older firmware (salt, iterations and digest) from EEPROM
  */
 void CTRL_updateStoredPassword(void)
 {
+	uint8 *record = (uint8 *)&g_storedCredential;
 	uint8 i;
-	for (i = 0; i < PASSWORD_LENGTH; i++)
+
+	for (i = 0; i < sizeof(PWHASH_RecordType); i++)
 	{
-		EEPROM_readByte(EEPROM_STORE_ADDREESS + i, g_storedPassword + i);
+		EEPROM_readByte(EEPROM_STORE_ADDREESS + i, record + i);
 	}
 }
 
 /*
- * Description: A function to store the password in EEPROM
+ * Description: A function to store the received password: the new code of the matched user, or the first administrator
  */
-void CTRL_storePassword(void)
+uint8 CTRL_storePassword(void)
 {
-	uint8 i;
-	for (i = 0; i < PASSWORD_LENGTH; i++)
+	if (g_matchedSlot != CRED_NOT_FOUND)
 	{
-		EEPROM_writeByte(EEPROM_STORE_ADDREESS + i, g_receivedPassword[i]);
-		_delay_ms(100);
+		return (CRED_changeCode(g_matchedSlot, g_receivedPassword, PASSWORD_LENGTH) == CRED_OK) ? TRUE : FALSE;
 	}
+	return CTRL_addAdministrator(g_receivedPassword);
+}
+
+/*
+ * Description: A function to create the users table if needed and add the first administrator with the given password
+ */
+uint8 CTRL_addAdministrator(const uint8 *a_password)
+{
+	/* The iteration count follows the measured speed of this MCU, so a lookup stays within budget */
+	if (!CRED_isFormatted() && (CRED_format(PWHASH_calibrate(PASSWORD_VERIFY_BUDGET_MS)) != CRED_OK))
+		return FALSE;
+
+	return (CRED_add(CTRL_ADMIN_USER_ID, a_password, PASSWORD_LENGTH, CRED_FLAG_ADMIN,
+					 CRED_ALWAYS_VALID_FROM, CRED_ALWAYS_VALID_UNTIL) == CRED_OK) ? TRUE : FALSE;
+}
+
+/*
+ * Description: A function to check an administrator password, counted by the lockout like any other password
+ */
+uint8 CTRL_authenticateAdmin(const uint8 *a_password)
+{
+	uint8 verification;
+	uint8 result[2];
+
+	if (LOCKOUT_getRemaining() != 0)
+	{
+		CTRL_sendLockoutStatus(LOCKOUT_getRemaining());
+		return FALSE;
+	}
+
+	verification = CTRL_verifyPassword(a_password);
+	if ((verification == PASSWORD_MATCHED) && (g_matchedUser.flags & CRED_FLAG_ADMIN))
+	{
+		LOCKOUT_registerSuccess();
+		return TRUE;
+	}
+	if (verification == PASSWORD_NOT_CHECKED)
+	{
+		/* Not counted, the administrator is told the table could not be read */
+		result[0] = USER_RESULT;
+		result[1] = CRED_EEPROM_ERROR;
+		(void)LINK_sendMessage(result, sizeof(result));
+		return FALSE;
+	}
+
+	CTRL_handleWrongPassword(AUDIT_BY_PASSWORD);
+	return FALSE;
+}
+
+/*
+ * Description: A function to serve the users requests (add, revoke, list) of an administrator
+ */
+void CTRL_manageUsers(const uint8 *message, uint8 length)
+{
+	uint8 request[USER_ADD_LENGTH];
+	uint8 result[2];
+
+	/* The message buffer is reused by the link, the request is kept while the password is checked */
+	if (((message[0] == USER_ADD_REQUEST) && (length != USER_ADD_LENGTH)) ||
+		((message[0] == USER_REVOKE_REQUEST) && (length != USER_REVOKE_LENGTH)) ||
+		((message[0] == USER_LIST_REQUEST) && (length != USER_LIST_LENGTH)))
+	{
+		return;
+	}
+	memcpy(request, message, length);
+
+	if (!CTRL_authenticateAdmin(&request[1]))
+		return;
+
+	result[0] = USER_RESULT;
+	if (request[0] == USER_ADD_REQUEST)
+	{
+		/* admin(5) userId flags code(5) validFrom(4) validUntil(4) */
+		result[1] = CRED_add(request[6], &request[8], PASSWORD_LENGTH, request[7],
+							 CTRL_getLong(&request[13]), CTRL_getLong(&request[17]));
+		AUDIT_record(AUDIT_EVT_USER_ADDED, result[1], request[6]);
+	}
+	else if (request[0] == USER_REVOKE_REQUEST)
+	{
+		result[1] = CRED_revoke(request[6]);
+		AUDIT_record(AUDIT_EVT_USER_REVOKED, result[1], request[6]);
+	}
+	else
+	{
+		CTRL_listUsers();
+		return;
+	}
+	(void)LINK_sendMessage(result, sizeof(result));
+}
+
+/*
+ * Description: A function to send the users of the table, one USER_ENTRY each, then USER_LIST_END
+ */
+void CTRL_listUsers(void)
+{
+	CRED_SlotType slot;
+	uint8 entry[11];
+	uint8 index, i;
+	uint8 count = 0;
+
+	for (index = 0; index < CRED_getSlotCount(); index++)
+	{
+		if (CRED_readSlot(index, &slot) != CRED_READ_USED)
+			continue;
+
+		entry[0] = USER_ENTRY;
+		entry[1] = slot.userId;
+		entry[2] = slot.flags;
+		for (i = 0; i < 4; i++)
+		{
+			entry[3 + i] = (uint8)(slot.validFrom >> (8 * i));
+			entry[7 + i] = (uint8)(slot.validUntil >> (8 * i));
+		}
+		(void)LINK_sendMessage(entry, sizeof(entry));
+		count++;
+		WDG_checkIn(CTRL_WDG_TASK_MAIN);
+	}
+
+	entry[0] = USER_LIST_END;
+	entry[1] = count;
+	(void)LINK_sendMessage(entry, 2);
+}
+
+/*
+ * Description: A function to read a 32-bit value sent low byte first
+ */
+uint32 CTRL_getLong(const uint8 *bytes)
+{
+	return ((uint32)bytes[3] << 24) | ((uint32)bytes[2] << 16) | ((uint16)bytes[1] << 8) | bytes[0];
 }
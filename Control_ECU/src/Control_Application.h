@@ -14,6 +14,16 @@
 #define CONTROL_APPLICATION_H_
 
 #include "gpio.h"
+#include "password_hash.h"
+#include "link.h"
+#include "otp.h"
+#include "credentials.h"
+#include "audit_log.h"
+#include "config_store.h"
+#include "counters.h"
+#include "flash_log.h"
+#include "heartbeat.h"
+#include "baud.h"
 
 /******************************************************************************
  *                              Definitions                                   *
@@ -23,34 +33,182 @@
 #define PASSWORD_LENGTH                     5
 #define PASSWORD_MATCHED                    TRUE
 #define PASSWORD_UNMATCHED                  FALSE
+#define PASSWORD_NOT_CHECKED                2         /* The users table could not be read, not counted by the lockout */
 
 /* TWI & EEPROM MACROS */
 #define TWI_CONTROL_ECU_ADDRESS				0x01
-#define EEPROM_STORE_ADDREESS				0x00
+#define EEPROM_PROFILE                      EEPROM_PROFILE_24C16   /* Fitted part, the addresses below fit its 2 KB */
+#define EEPROM_STORE_ADDREESS				0x00      /* PWHASH_RecordType (44 bytes) of older firmwares, moved to the users table at its first use */
+                                                      /* 0x40..0x5F: free, lockout slots of older firmwares */
+#define EEPROM_OTP_ADDRESS					0x60      /* OTP_SLOTS * OTP_SLOT_SIZE bytes */
+#define EEPROM_AUDIT_ADDRESS				0x80      /* AUDIT_RECORDS * AUDIT_RECORD_SIZE bytes (up to 0x2FF) */
+#define EEPROM_COUNTERS_ADDRESS				0x300     /* CTRL_COUNTER_COUNT * COUNTER_PAGES * COUNTER_PAGE_SIZE bytes (up to 0x37F) */
+#define EEPROM_CONFIG_ADDRESS				0x380     /* CONFIG_PAGES * CFG_PAGE_SIZE bytes (up to 0x3FF) */
+#define EEPROM_CREDENTIALS_ADDRESS			0x400     /* CRED_HEADER_SIZE + CREDENTIAL_SLOTS * CRED_SLOT_SIZE bytes (up to 0x7EF) */
+#define EEPROM_CREDENTIALS_HEADER_COPY		0x7F0     /* Second bank of the users table header (16 bytes) */
 
-/* TIMING MACROS */
+/* INTERNAL EEPROM MACROS (the link nonces take 0x00..0x03, see LINK MACROS) */
+#define IEEPROM_LOCKOUT_ADDRESS             0x10      /* LOCKOUT_SLOTS * LOCKOUT_SLOT_SIZE bytes, written on every wrong password */
+
+/* USERS MACROS */
+#define CREDENTIAL_SLOTS                    31        /* Prime table size, kept at most ~2/3 full the probes stay at 1-2 slots */
+#define CTRL_ADMIN_USER_ID                  0         /* User created by the first-run password setup */
+
+/* AUDIT LOG MACROS */
+#define AUDIT_RECORDS                       80        /* Oldest records are overwritten once the region is full */
+#define AUDIT_FLUSH_IDLE_SECONDS            1         /* Queued records are written once the link was quiet for this time */
+
+/* FLASH LOG MACROS (the region is part of .text, which must end below the boot section at 0x7000:
+ * the link fails on the overlap, lower the pages or keep the -Os build if it does) */
+#define FLASH_LOG_PAGES                     48        /* 6 KB of application flash, 720 archived audit records */
+
+/* LIFETIME COUNTERS MACROS */
+#define COUNTER_PAGES                       2         /* Pages of each counter ring: a unary byte is rewritten 8 times per 160 counts */
+
+/* Lifetime counters, also the order of the counters report */
+typedef enum {
+	CTRL_COUNTER_UNLOCKS,
+	CTRL_COUNTER_FAILED_ATTEMPTS,
+	CTRL_COUNTER_MOTOR_SECONDS,
+	CTRL_COUNTER_ALARMS,
+	CTRL_COUNTER_COUNT
+} CTRL_CounterType;
+
+/* LINK MACROS */
+#define LINK_NONCE_EEPROM_ADDRESS           0x00      /* Internal EEPROM, boot counter of the link nonces (4 bytes) */
+#define LINK_BOOT_BAUD                      UART_BAUD_9600     /* Rate after a reset, the one of the diagnostics tool */
+#define LINK_FASTEST_BAUD                   UART_BAUD_250000   /* Fastest rate accepted, LINK_BOOT_BAUD keeps the boot rate */
+#define LINK_BAUD_TIMEOUT                   200       /* ms to wait for each check message at a new rate */
+
+/* HEARTBEAT MACROS (the HMI ECU pings every second, these pings only measure the RTT from this side) */
+#define HEARTBEAT_PERIOD                    2000      /* ms between two pings to the HMI ECU */
+#define HEARTBEAT_TIMEOUT                   6000      /* ms without any message before the HMI ECU is down */
+
+/* PASSWORD HASHING MACROS */
+#define PASSWORD_VERIFY_BUDGET_MS           150       /* The PBKDF2 iterations are calibrated to verify within this time */
+
+/* ONE-TIME ACCESS CODES MACROS (TOTP, RFC 6238 defaults) */
+#define ACCESS_CODE_LENGTH                  6
+#define ACCESS_CODE_TIME_STEP               30        /* Seconds per code */
+#define ACCESS_CODE_WINDOW                  1         /* Steps accepted before/after the current one: 3 HMACs per check */
+
+/* CLOCK MACROS */
+#define TIMER1_COMPARE_VALUE                7813      /* CTC: a Timer1 period is TIMER1_COMPARE_VALUE + 1 counts */
+#define RTC_TICK_MICROSECONDS               1000192   /* Timer1 period: (7813 + 1) counts of 128us */
+#define DIAG_PAYLOAD_TIMEOUT                2         /* Seconds to receive the bytes following a diagnostics request */
+
+/* CONFIGURATION MACROS (defaults of the configuration store, the values in use are read with CFG_get) */
+#define CONFIG_PAGES                        8         /* Pages of the configuration log, each one is rewritten once per lap */
 #define DOOR_UNLOCKING_PERIOD	            15
 #define DOOR_LOCKING_PERIOD	                15
 #define DOOR_LEFT_OPEN_PERIOD	            3
-#define NUMBER_OF_WRONG_PASSWORD_ATTEMPTS 	3
-#define ALARM_ON_DELAY						60
+#define ALARM_ON_DELAY						60        /* Longest time the buzzer sounds when a lockout starts */
+#define LOCKOUT_FREE_ATTEMPTS               3         /* Wrong passwords in a row before the first lockout */
+#define LOCKOUT_BASE_PERIOD                 60        /* Seconds of the first lockout, doubled by each wrong password after it */
+#define LOCKOUT_MAX_DOUBLINGS               5         /* Longest lockout = 60 << 5 = 32 minutes */
 
+/* Keys of the configuration store */
+typedef enum {
+	CONFIG_DOOR_UNLOCKING_PERIOD,
+	CONFIG_DOOR_LEFT_OPEN_PERIOD,
+	CONFIG_DOOR_LOCKING_PERIOD,
+	CONFIG_ALARM_ON_DELAY,
+	CONFIG_LOCKOUT_FREE_ATTEMPTS,
+	CONFIG_LOCKOUT_BASE_PERIOD,
+	CONFIG_LOCKOUT_MAX_DOUBLINGS,
+	CONFIG_COUNT
+} CTRL_ConfigKeyType;
 
-/***** UART MACROS *****/
+/***** LINK MESSAGES (first byte of every encrypted message) *****/
 //Send & Receive Handlers
 #define READY_TO_SEND               0x10
 #define READY_TO_RECEIVE            0x20
+#define PASSWORD_DATA               0x21      /* Followed by the PASSWORD_LENGTH digits */
 
 //Change Password Handlers
-#define CHANGE_PASSWORD_OPTION	    0x18
-#define CHANGING_PASSWORD		    0x30
+#define CHANGE_PASSWORD_OPTION	    0x18      /* Followed by the old then the new password (PASSWORD_LENGTH digits each), */
+                                              /* answered by PASSWORD_MATCHED once stored or PASSWORD_UNMATCHED        */
 
 //Open Door Handlers
-#define OPEN_DOOR_OPTION            0x19
-#define UNLOCKING_DOOR			    0x31
+#define OPEN_DOOR_OPTION            0x19      /* Followed by the PASSWORD_LENGTH digits */
+#define UNLOCKING_DOOR			    0x31      /* Followed by the unlocking, left open and locking periods (seconds, 1 byte each) */
+#define DOOR_PERIODS_PAYLOAD        3
+#define DOOR_PROGRESS               0x35      /* Followed by the door phase, its percentage done and its remaining seconds, */
+#define DOOR_PROGRESS_PAYLOAD       3         /* pushed by the Control ECU when a phase starts then every second            */
 
-//Wrong Password Handler
+/* Door phases of DOOR_PROGRESS, in the order of the door timeline */
+#define DOOR_PHASE_UNLOCKING        0
+#define DOOR_PHASE_OPEN             1
+#define DOOR_PHASE_LOCKING          2
+#define DOOR_PHASE_CLOSED           3
+
+//One-Time Access Code Handlers (opens the door, the password is left unchanged)
+#define ACCESS_CODE_OPTION          0x1A      /* Followed by the ACCESS_CODE_LENGTH digits (0..9) */
+#define ACCESS_CODE_UNAVAILABLE     0x34      /* The clock was not set since the last reset */
+
+//Wrong Password Handlers
 #define WRONG_PASSWORD			    0x25
+#define LOCKOUT_STATUS              0x26      /* Followed by the remaining lockout seconds (2 bytes, low first), 0 = lockout over */
+
+//System Status Handlers (HMI asks at boot whether a password exists or a lockout is running)
+#define SYSTEM_STATUS_REQUEST       0x12
+#define SYSTEM_READY                0x32
+#define PASSWORD_NOT_SET            0x33
+
+//Users Handlers (every request starts with an administrator password, answered by USER_RESULT)
+#define USER_ADD_REQUEST            0x50      /* admin(5) userId flags code(5) validFrom(4) validUntil(4), times low first */
+#define USER_REVOKE_REQUEST         0x51      /* admin(5) userId */
+#define USER_LIST_REQUEST           0x52      /* admin(5), answered by one USER_ENTRY per user then USER_LIST_END */
+#define USER_ENTRY                  0x53      /* userId flags validFrom(4) validUntil(4) */
+#define USER_LIST_END               0x54      /* count */
+#define USER_RESULT                 0x55      /* CRED_StatusType */
+#define USER_ADD_LENGTH             (1 + PASSWORD_LENGTH + 2 + PASSWORD_LENGTH + 8)
+#define USER_REVOKE_LENGTH          (1 + PASSWORD_LENGTH + 1)
+#define USER_LIST_LENGTH            (1 + PASSWORD_LENGTH)
+
+//Diagnostics Handlers (single bytes sent in clear outside the frames by the diagnostics tool)
+#define TRACE_DUMP_REQUEST          0x40
+#define RESET_REPORT_REQUEST        0x41
+#define RAM_REPORT_REQUEST          0x42
+#define HASH_BENCHMARK_REQUEST      0x43
+#define LINK_BENCHMARK_REQUEST      0x44
+#define OTP_BENCHMARK_REQUEST       0x45
+#define CLOCK_SET_REQUEST           0x46      /* Answered by a challenge, then time(4, low first) tag(4) are expected */
+#define AUDIT_QUERY_REQUEST         0x47      /* Followed by AUDIT_QueryType(1) key(4, low first), see AUDIT_sendRecords */
+#define AUDIT_QUERY_PAYLOAD         5
+#define CONFIG_SET_REQUEST          0x48      /* Answered by a challenge, then key(1) value(2, low first) tag(4) are expected */
+#define CONFIG_DUMP_REQUEST         0x49      /* Answered by 'C' 'V' count value(2, low first) per key */
+#define COUNTERS_REQUEST            0x4A      /* Answered by 'P' 'C' count value(4, low first) per counter, see COUNTER_sendReport */
+#define FLASH_LOG_QUERY_REQUEST     0x4B      /* Followed by position(2, low first), see FLASHLOG_sendRecords */
+#define FLASH_LOG_QUERY_PAYLOAD     2
+#define CRC_BENCHMARK_REQUEST       0x4C      /* Answered by 'C' 'B', see CRC_sendBenchmark */
+#define LINE_ERRORS_REQUEST         0x4D      /* Answered by 'U' 'E', see UART_sendErrorReport */
+#define HEARTBEAT_REPORT_REQUEST    0x4E      /* Answered by 'H' 'T', see HB_sendReport */
+
+/* Sync bytes of the answer to CLOCK_SET_REQUEST, followed by TRUE if the clock was set */
+#define CLOCK_REPORT_SYNC1          'R'
+#define CLOCK_REPORT_SYNC2          'T'
+
+/* Sync bytes of the answers to CONFIG_SET_REQUEST (followed by CFG_StatusType) and CONFIG_DUMP_REQUEST */
+#define CONFIG_RESULT_SYNC1         'C'
+#define CONFIG_RESULT_SYNC2         'F'
+#define CONFIG_DUMP_SYNC1           'C'
+#define CONFIG_DUMP_SYNC2           'V'
+
+/* WATCHDOG MACROS */
+#define CTRL_WDG_TASK_MAIN                  0
+#define CTRL_WDG_MAIN_TIMEOUT               3     /* Seconds without a check-in before resetting */
+
+/* TRACE STATES (logged by TRACE_setState to locate a stuck handshake step) */
+#define CTRL_STATE_WAIT_COMMAND             0x00
+#define CTRL_STATE_RECEIVE_COMMAND          0x01
+#define CTRL_STATE_WAIT_PASSWORD            0x02
+#define CTRL_STATE_RECEIVE_PASSWORD         0x03
+#define CTRL_STATE_WAIT_CONFIRMATION        0x04
+#define CTRL_STATE_RECEIVE_CONFIRMATION     0x05
+#define CTRL_STATE_STORE_PASSWORD           0x06
+#define CTRL_STATE_OPEN_DOOR                0x07
+#define CTRL_STATE_LOCKED_OUT               0x08
 
 
 /*******************************************************************************
@@ -58,24 +216,41 @@
  *******************************************************************************/
 
 uint8 g_receivedPassword[PASSWORD_LENGTH];   /* Global array to hold the values of the received password from HMI ECU */
-uint8 g_storedPassword[PASSWORD_LENGTH];     /* Global array to store the values of the password In EEPROM if password is correct */
-uint8 g_wrongPasswordCounter=0;              /* Global variable that is used as counter of number of wrong passwords entered */
-uint16 g_sec = 0;                            /* Global variable that is incremented inside Timer1 ISR every interrupt (1 Second) */
+PWHASH_RecordType g_storedCredential;        /* Password record of older firmwares (see EEPROM_STORE_ADDREESS) */
+CRED_SlotType g_matchedUser;                 /* User of the last password that was verified */
+uint8 g_matchedSlot = CRED_NOT_FOUND;        /* Its slot in the users table, CRED_NOT_FOUND for the first-run setup */
+volatile uint16 g_sec = 0;                   /* Global variable that is incremented inside Timer1 ISR every interrupt (1 Second) */
+uint16 g_alarmStart = 0;                     /* g_sec value when the buzzer was turned on */
+uint8 g_alarmOn = FALSE;
+uint16 g_lockoutReported = 0;                /* Last remaining lockout time sent to the HMI ECU */
+volatile uint8 g_linkIdleSeconds = 0;        /* Seconds since the last byte received by UART (saturates) */
 
 /*******************************************************************************
  *                           Functions Prototypes                              *
  *******************************************************************************/
 
 /*
- * Description: a function to compare the stored pass with the received one
+ * Description: a function to compare two passwords in constant time (password and its confirmation)
  */
 uint8 CTRL_comparePasswords(const uint8 *a_password1,const uint8 *a_password2);
 
 /*
- * Description: a function to initialize the password in first-run OR to change the password
+ * Description: a function to look the received password up in the users table and check the validity window of its user,
+ *              PASSWORD_NOT_CHECKED if the table could not be read
+ */
+uint8 CTRL_verifyPassword(const uint8 *a_password);
+
+/*
+ * Description: a function to initialize the password in first-run
  */
 void CTRL_SystemPasswordInit(uint8 *pass);
 
+/*
+ * Description: a function to change the password of the matched user in a single transaction, the HMI already
+ *              matched the new password with its confirmation. One status is sent once the new one is stored.
+ */
+void CTRL_changePassword(const uint8 *a_oldPassword, const uint8 *a_newPassword);
+
 /* Description:
  *    A function that 1) Rotates on the DC motor for 15 seconds clockwise,
  *                    2) Stops it for 3 seconds,
@@ -89,18 +264,156 @@ void CTRL_OpenDoor(void);
 void CTRL_timerCallBack(void);
 
 /*
- * Description: A function to receive the password via UART by looping on receiveByte function
+ * Description: A function to wait for a message from the HMI (whose arrival depends on the user), the main task keeps
+ *              checking in with the watchdog and serves the diagnostics requests and the link handshake while waiting
+ */
+const uint8* CTRL_receiveMessage(uint8 *length);
+
+/*
+ * Description: A function to answer a diagnostics request byte received outside the link frames
+ */
+void CTRL_serveDiagnostics(uint8 request);
+
+/*
+ * Description: A function to set the clock from the provisioning tool: challenge, then the time and its tag
+ *              computed with the link master key. The clock never goes backwards while it is set.
+ */
+void CTRL_setClock(void);
+
+/*
+ * Description: A function to receive the bytes following a diagnostics request, FALSE if they do not arrive in time
+ */
+uint8 CTRL_receiveRawBytes(uint8 *data, uint8 length);
+
+/*
+ * Description: A function to send a one byte message to the HMI through the link
+ */
+void CTRL_sendResponse(uint8 response);
+
+/*
+ * Description: A function to wait for the HMI to be ready to send a new password, answering its status requests meanwhile
+ */
+void CTRL_waitReadyToSend(void);
+
+/*
+ * Description: A function to answer the HMI status request with the lockout status, SYSTEM_READY or PASSWORD_NOT_SET
+ */
+void CTRL_sendSystemStatus(void);
+
+/*
+ * Description: A function to send LOCKOUT_STATUS followed by the remaining lockout seconds
+ */
+void CTRL_sendLockoutStatus(uint16 remaining);
+
+/*
+ * Description: A function to count a wrong password, it answers WRONG_PASSWORD or starts a lockout with the buzzer on
+ */
+void CTRL_handleWrongPassword(AUDIT_ResultType method);
+
+/*
+ * Description: A function to write the queued audit records once the link is quiet, called while the main task is idle
+ */
+void CTRL_serviceAudit(void);
+
+/*
+ * Description: A function to answer an audit log query of the diagnostics tool
+ */
+void CTRL_queryAudit(void);
+
+/*
+ * Description: A function to copy an audit record written to the EEPROM into the flash log
+ */
+void CTRL_archiveAudit(const AUDIT_RecordType *record);
+
+/*
+ * Description: A function to answer a flash log query of the diagnostics tool
+ */
+void CTRL_queryFlashLog(void);
+
+/*
+ * Description: A function to store a configuration value sent by the provisioning tool, authenticated like the clock
+ */
+void CTRL_setConfig(void);
+
+/*
+ * Description: A function to send every configuration value to the diagnostics tool
+ */
+void CTRL_sendConfig(void);
+
+/*
+ * Description: A function to hand the lockout keys of the configuration store to the lockout module
+ */
+void CTRL_applyLockoutPolicy(void);
+
+/*
+ * Description: A function to answer UNLOCKING_DOOR with the door periods, so the HMI ECU follows the configuration
+ */
+void CTRL_sendUnlockingDoor(void);
+
+/*
+ * Description: A function to run one phase of the door for its period, the HMI ECU is told the progress every second
+ */
+void CTRL_runDoorPhase(uint8 phase, uint16 period);
+
+/*
+ * Description: A function to send DOOR_PROGRESS with the phase, its percentage done and its remaining seconds
+ */
+void CTRL_sendDoorProgress(uint8 phase, uint16 elapsed, uint16 period);
+
+/*
+ * Description: A function to return the user of the last verified password for the audit log
+ */
+uint8 CTRL_getMatchedUser(void);
+
+/*
+ * Description: A function to push the remaining lockout time to the HMI every second and stop the buzzer,
+ *              called while the main task is idle
+ */
+void CTRL_serviceLockout(void);
+
+/*
+ * Description: A function to check whether an administrator password was stored in EEPROM (not the first run)
+ */
+uint8 CTRL_isPasswordStored(void);
+
+/*
+ * Description: A function to wait for the PASSWORD_DATA message and copy the password it carries
  */
 void CTRL_receivePasswordByUART(uint8 * pass);
 
 /*
- * Description: A function to retrieve the stored password from EEPROM
+ * Description: A function to retrieve the password record of an older firmware (salt, iterations and digest) from EEPROM
  */
 void CTRL_updateStoredPassword(void);
 
 /*
- * Description: A function to store the password in EEPROM
+ * Description: A function to store the received password: the new code of the matched user, or the first administrator
+ */
+uint8 CTRL_storePassword(void);
+
+/*
+ * Description: A function to create the users table if needed and add the first administrator with the given password
+ */
+uint8 CTRL_addAdministrator(const uint8 *a_password);
+
+/*
+ * Description: A function to check an administrator password, counted by the lockout like any other password
+ */
+uint8 CTRL_authenticateAdmin(const uint8 *a_password);
+
+/*
+ * Description: A function to serve the users requests (add, revoke, list) of an administrator
+ */
+void CTRL_manageUsers(const uint8 *message, uint8 length);
+
+/*
+ * Description: A function to send the users of the table, one USER_ENTRY each, then USER_LIST_END
+ */
+void CTRL_listUsers(void);
+
+/*
+ * Description: A function to read a 32-bit value sent low byte first
  */
-void CTRL_storePassword(void);
+uint32 CTRL_getLong(const uint8 *bytes);
 
 #endif /* CTRL_APPLICATION_H_ */
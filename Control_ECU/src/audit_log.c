@@ -0,0 +1,327 @@
+ /******************************************************************************
+ *
+ * Module: AUDIT
+ *
+ * File Name: audit_log.c
+ *
+ * Description: Source file for the append-only access audit log kept in the external EEPROM
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include "audit_log.h"
+#include "external_eeprom.h"
+#include "rtc.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define AUDIT_SCAN_RECORDS         8         /* Records read at once while scanning the region */
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static AUDIT_ConfigType g_auditConfig;
+
+/* RAM index: where the oldest record is, its sequence and the number of records */
+static uint16 g_auditOldest = 0;
+static uint16 g_auditOldestSequence = 0;
+static uint16 g_auditCount = 0;
+
+static AUDIT_RecordType g_auditQueue[AUDIT_QUEUE_SIZE];
+static uint8 g_auditPending = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint8 AUDIT_isErased(const AUDIT_RecordType *record);
+static uint16 AUDIT_slotAddress(uint16 slot);
+static uint16 AUDIT_nextSequence(void);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Scan the region once to find the oldest and the newest records (the RAM index).
+ */
+void AUDIT_init(const AUDIT_ConfigType *configPtr)
+{
+	AUDIT_RecordType records[AUDIT_SCAN_RECORDS];
+	AUDIT_RecordType previous;
+	uint16 slot, newest = AUDIT_NOT_FOUND;
+	uint8 i, chunk;
+
+	g_auditConfig = *configPtr;
+	g_auditOldest = 0;
+	g_auditCount = 0;
+	g_auditPending = 0;
+	memset(&previous, 0xFF, sizeof(AUDIT_RecordType));
+
+	/* The newest record is the first valid one not followed by the next sequence */
+	for (slot = 0; (slot < g_auditConfig.records) && (newest == AUDIT_NOT_FOUND); slot += chunk)
+	{
+		chunk = (g_auditConfig.records - slot < AUDIT_SCAN_RECORDS) ? (uint8)(g_auditConfig.records - slot) : AUDIT_SCAN_RECORDS;
+		if (EEPROM_readBlock(AUDIT_slotAddress(slot), (uint8 *)records, (uint16)chunk * AUDIT_RECORD_SIZE) == ERROR)
+			return;
+
+		for (i = 0; i < chunk; i++)
+		{
+			if (!AUDIT_isErased(&previous) &&
+				(AUDIT_isErased(&records[i]) || (records[i].sequence != (uint16)(previous.sequence + 1))))
+			{
+				newest = slot + i - 1;
+				break;
+			}
+			previous = records[i];
+		}
+	}
+	if ((newest == AUDIT_NOT_FOUND) && !AUDIT_isErased(&previous))
+	{
+		newest = g_auditConfig.records - 1;
+	}
+	if (newest == AUDIT_NOT_FOUND)
+		return;                                     /* Empty log */
+
+	/* Once the region was filled, the oldest record follows the newest one */
+	slot = (newest + 1) % g_auditConfig.records;
+	if ((EEPROM_readBlock(AUDIT_slotAddress(slot), (uint8 *)&records[0], AUDIT_RECORD_SIZE) == SUCCESS) &&
+		!AUDIT_isErased(&records[0]))
+	{
+		g_auditOldest = slot;
+		g_auditCount = g_auditConfig.records;
+		g_auditOldestSequence = records[0].sequence;
+	}
+	else
+	{
+		g_auditCount = newest + 1;
+		g_auditOldestSequence = (uint16)(previous.sequence - newest);
+	}
+}
+
+/*
+ * Description :
+ * Time stamp a record and queue it in RAM, nothing is written to EEPROM until
+ * AUDIT_flush (unless the queue is full).
+ */
+void AUDIT_record(AUDIT_EventType event, uint8 result, uint8 user)
+{
+	AUDIT_RecordType *record;
+
+	if (g_auditPending == AUDIT_QUEUE_SIZE)
+	{
+		AUDIT_flush();
+		if (g_auditPending == AUDIT_QUEUE_SIZE)
+			return;                                 /* EEPROM failure, the queued records are kept */
+	}
+
+	record = &g_auditQueue[g_auditPending];
+	record->sequence = AUDIT_nextSequence() + g_auditPending;
+	record->time = RTC_getTime();
+	record->user = user;
+	record->event = AUDIT_EVENT_BYTE(event, result);
+	if (!RTC_isSet())
+	{
+		record->event |= AUDIT_FLAG_NO_CLOCK;
+	}
+	g_auditPending++;
+}
+
+/*
+ * Description :
+ * Return TRUE if records are waiting for AUDIT_flush.
+ */
+uint8 AUDIT_hasPending(void)
+{
+	return (g_auditPending != 0) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Append the queued records with page writes, the oldest records are overwritten when the region is full.
+ */
+void AUDIT_flush(void)
+{
+	uint16 slot = (g_auditOldest + g_auditCount) % g_auditConfig.records;
+	uint8 done = 0;
+	uint8 chunk;
+
+	if ((g_auditPending == 0) || (g_auditConfig.records == 0))
+		return;
+
+	/* At most two contiguous runs: up to the end of the region, then from its start */
+	while (done < g_auditPending)
+	{
+		chunk = g_auditPending - done;
+		if (slot + chunk > g_auditConfig.records)
+		{
+			chunk = (uint8)(g_auditConfig.records - slot);
+		}
+		if (EEPROM_writeBlock(AUDIT_slotAddress(slot), (const uint8 *)&g_auditQueue[done], (uint16)chunk * AUDIT_RECORD_SIZE) == ERROR)
+			break;
+
+		done += chunk;
+		slot = (slot + chunk) % g_auditConfig.records;
+	}
+
+	/* Update the index with what was written, a failed write is retried on the next flush */
+	if (g_auditCount + done > g_auditConfig.records)
+	{
+		g_auditOldest = (g_auditOldest + (g_auditCount + done - g_auditConfig.records)) % g_auditConfig.records;
+		g_auditCount = g_auditConfig.records;
+	}
+	else
+	{
+		g_auditCount += done;
+	}
+	if (g_auditCount == done)
+	{
+		g_auditOldestSequence = g_auditQueue[0].sequence;
+	}
+	else if (g_auditCount == g_auditConfig.records)
+	{
+		g_auditOldestSequence = (uint16)(g_auditQueue[done - 1].sequence - (g_auditConfig.records - 1));
+	}
+
+	if (g_auditConfig.archive != NULL_PTR)
+	{
+		for (chunk = 0; chunk < done; chunk++)
+		{
+			g_auditConfig.archive(&g_auditQueue[chunk]);
+		}
+	}
+
+	g_auditPending -= done;
+	memmove(&g_auditQueue[0], &g_auditQueue[done], (uint16)g_auditPending * AUDIT_RECORD_SIZE);
+}
+
+uint16 AUDIT_getCount(void)
+{
+	return g_auditCount;
+}
+
+/*
+ * Description :
+ * Position of a sequence from the RAM index only, the oldest record if it was overwritten.
+ */
+uint16 AUDIT_findSequence(uint16 sequence)
+{
+	uint16 position = sequence - g_auditOldestSequence;
+
+	/* Sequences before the oldest one (overwritten) wrap to the upper half */
+	if (position >= g_auditCount)
+	{
+		return ((position & 0x8000) && (g_auditCount != 0)) ? 0 : AUDIT_NOT_FOUND;
+	}
+	return position;
+}
+
+/*
+ * Description :
+ * Position of the first record at or after a time, oldest first. The times are not ordered
+ * (uptime until the clock is set after a power cycle, clock set back) so every record is
+ * read, a chunk at a time; records without the clock are skipped.
+ */
+uint16 AUDIT_findTime(uint32 time)
+{
+	AUDIT_RecordType records[AUDIT_SCAN_RECORDS];
+	uint16 position, slot;
+	uint8 i, chunk;
+
+	for (position = 0; position < g_auditCount; position += chunk)
+	{
+		/* A chunk stops at the end of the region, the next one starts at its beginning */
+		slot = (g_auditOldest + position) % g_auditConfig.records;
+		chunk = (g_auditCount - position < AUDIT_SCAN_RECORDS) ? (uint8)(g_auditCount - position) : AUDIT_SCAN_RECORDS;
+		if (g_auditConfig.records - slot < chunk)
+		{
+			chunk = (uint8)(g_auditConfig.records - slot);
+		}
+		if (EEPROM_readBlock(AUDIT_slotAddress(slot), (uint8 *)records, (uint16)chunk * AUDIT_RECORD_SIZE) == ERROR)
+			return AUDIT_NOT_FOUND;
+
+		for (i = 0; i < chunk; i++)
+		{
+			if (!(records[i].event & AUDIT_FLAG_NO_CLOCK) && (records[i].time >= time))
+				return position + i;
+		}
+	}
+	return AUDIT_NOT_FOUND;
+}
+
+/*
+ * Description :
+ * Read the record at a position (0 = oldest), FALSE if there is no such record.
+ */
+uint8 AUDIT_read(uint16 position, AUDIT_RecordType *record)
+{
+	if (position >= g_auditCount)
+		return FALSE;
+
+	return EEPROM_readBlock(AUDIT_slotAddress((g_auditOldest + position) % g_auditConfig.records),
+							(uint8 *)record, AUDIT_RECORD_SIZE) == SUCCESS;
+}
+
+/*
+ * Description :
+ * Send up to AUDIT_QUERY_MAX records from a sequence or a time through UART:
+ * 'A' 'L' count record(8) ... with the records as stored in EEPROM.
+ */
+void AUDIT_sendRecords(AUDIT_QueryType query, uint32 key)
+{
+	AUDIT_RecordType record;
+	uint16 position;
+	uint8 count = 0;
+	uint8 i;
+
+	AUDIT_flush();
+
+	position = (query == AUDIT_QUERY_TIME) ? AUDIT_findTime(key) : AUDIT_findSequence((uint16)key);
+	if (position != AUDIT_NOT_FOUND)
+	{
+		count = (g_auditCount - position < AUDIT_QUERY_MAX) ? (uint8)(g_auditCount - position) : AUDIT_QUERY_MAX;
+	}
+
+	UART_sendByte(AUDIT_REPORT_SYNC1);
+	UART_sendByte(AUDIT_REPORT_SYNC2);
+	UART_sendByte(count);
+	while (count != 0)
+	{
+		if (!AUDIT_read(position, &record))
+		{
+			memset(&record, 0xFF, sizeof(AUDIT_RecordType));
+		}
+		for (i = 0; i < AUDIT_RECORD_SIZE; i++)
+		{
+			UART_sendByte(((const uint8 *)&record)[i]);
+		}
+		position++;
+		count--;
+	}
+}
+
+static uint8 AUDIT_isErased(const AUDIT_RecordType *record)
+{
+	return (record->sequence == 0xFFFF) && (record->time == 0xFFFFFFFFUL);
+}
+
+static uint16 AUDIT_slotAddress(uint16 slot)
+{
+	return g_auditConfig.eepromAddress + (slot * AUDIT_RECORD_SIZE);
+}
+
+/*
+ * Description :
+ * Sequence of the next record written to EEPROM.
+ */
+static uint16 AUDIT_nextSequence(void)
+{
+	return (g_auditCount == 0) ? 0 : (uint16)(g_auditOldestSequence + g_auditCount);
+}
@@ -0,0 +1,131 @@
+ /******************************************************************************
+ *
+ * Module: AUDIT
+ *
+ * File Name: audit_log.h
+ *
+ * Description: Header file for the append-only access audit log kept in the external EEPROM
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef AUDIT_LOG_H_
+#define AUDIT_LOG_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Circular log of 8-byte records: sequence(2) time(4) user(1) event(1), all low byte first.
+ * The sequence increments by one per record, the newest record is the one whose next
+ * slot does not hold the next sequence. An erased record reads all 0xFF.
+ */
+#define AUDIT_RECORD_SIZE          8
+#define AUDIT_QUEUE_SIZE           4         /* Records waiting in RAM for AUDIT_flush */
+#define AUDIT_QUERY_MAX            8         /* Records sent per AUDIT_sendRecords */
+
+/* Event byte: event ID (high nibble) | AUDIT_FLAG_NO_CLOCK | result (0..7) */
+#define AUDIT_EVENT_BYTE(event, result)   ((uint8)(((event) << 4) | ((result) & 0x07)))
+#define AUDIT_GET_EVENT(byte)             ((byte) >> 4)
+#define AUDIT_GET_RESULT(byte)            ((byte) & 0x07)
+#define AUDIT_FLAG_NO_CLOCK        0x08      /* The time is the uptime in seconds, the clock was not set */
+
+#define AUDIT_USER_NONE            0xFF      /* No user is known (access code, unknown password) */
+#define AUDIT_NOT_FOUND            0xFFFF
+
+/* Sync bytes that start the query answer sent over the UART */
+#define AUDIT_REPORT_SYNC1         'A'
+#define AUDIT_REPORT_SYNC2         'L'
+
+typedef enum {
+	AUDIT_EVT_DOOR_OPENED = 1,     /* result = AUDIT_ResultType of the credential used        */
+	AUDIT_EVT_ACCESS_DENIED,       /* result = AUDIT_ResultType of the credential tried       */
+	AUDIT_EVT_LOCKOUT,             /* result = 0, a lockout period started                    */
+	AUDIT_EVT_PASSWORD_CHANGED,    /* user = its new password owner                           */
+	AUDIT_EVT_USER_ADDED,          /* user = added user, result = status of the users table   */
+	AUDIT_EVT_USER_REVOKED,        /* user = revoked user, result = status of the users table */
+	AUDIT_EVT_CLOCK_SET,           /* result = TRUE if the time was accepted                  */
+	AUDIT_EVT_CONFIG_CHANGED       /* user = configuration key, result = status of the store  */
+} AUDIT_EventType;
+
+typedef enum {
+	AUDIT_BY_PASSWORD,
+	AUDIT_BY_ACCESS_CODE,
+	AUDIT_BY_PASSWORD_OUT_OF_WINDOW    /* Known user outside its validity window */
+} AUDIT_ResultType;
+
+typedef enum {
+	AUDIT_QUERY_SEQUENCE,          /* From the first record with this sequence (or the oldest one) */
+	AUDIT_QUERY_TIME               /* From the first record at or after this time                  */
+} AUDIT_QueryType;
+
+typedef struct {
+	uint16 sequence;
+	uint32 time;
+	uint8 user;
+	uint8 event;
+} AUDIT_RecordType;
+
+typedef struct {
+	uint16 eepromAddress;          /* Start of the region, 8-byte aligned */
+	uint16 records;                /* Region size in records */
+	void (*archive)(const AUDIT_RecordType *record);   /* Called per record written, or NULL_PTR */
+} AUDIT_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Scan the region once to find the oldest and the newest records (the RAM index).
+ */
+void AUDIT_init(const AUDIT_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Time stamp a record and queue it in RAM, nothing is written to EEPROM until
+ * AUDIT_flush (unless the queue is full).
+ */
+void AUDIT_record(AUDIT_EventType event, uint8 result, uint8 user);
+
+/*
+ * Description :
+ * Return TRUE if records are waiting for AUDIT_flush.
+ */
+uint8 AUDIT_hasPending(void);
+
+/*
+ * Description :
+ * Append the queued records with page writes, the oldest records are overwritten when the region is full.
+ */
+void AUDIT_flush(void);
+
+/*
+ * Description :
+ * Number of records in the log and position (0 = oldest) of a sequence or of a time.
+ * A sequence is found with the RAM index only, a time with a scan of the records
+ * logged with the clock set (their times are not ordered across power cycles).
+ */
+uint16 AUDIT_getCount(void);
+uint16 AUDIT_findSequence(uint16 sequence);
+uint16 AUDIT_findTime(uint32 time);
+
+/*
+ * Description :
+ * Read the record at a position (0 = oldest), FALSE if there is no such record.
+ */
+uint8 AUDIT_read(uint16 position, AUDIT_RecordType *record);
+
+/*
+ * Description :
+ * Send up to AUDIT_QUERY_MAX records from a sequence or a time through UART:
+ * 'A' 'L' count record(8) ... with the records as stored in EEPROM.
+ */
+void AUDIT_sendRecords(AUDIT_QueryType query, uint32 key);
+
+#endif /* AUDIT_LOG_H_ */
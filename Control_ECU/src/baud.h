@@ -0,0 +1,85 @@
+ /******************************************************************************
+ *
+ * Module: BAUD
+ *
+ * File Name: baud.h
+ *
+ * Description: Header file for the negotiation of the fastest UART baud rate of the link
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef BAUD_H_
+#define BAUD_H_
+
+#include "std_types.h"
+#include "uart.h"
+#include "link.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Link messages (first byte) of the negotiation, all followed by a UART_BaudType:
+ * the initiator sends PROPOSE with its fastest rate, the responder answers ACCEPT with the
+ * rate it switches to (its fastest one at most). Both switch, the initiator sends a burst of
+ * full CHECK frames back to back at the new rate and the responder echoes a burst once it
+ * received them all, so each ECU checks frames arriving at the line rate. A rate is kept
+ * only once both bursts went through, otherwise both ECUs fall back to the boot rate and a
+ * slower one is proposed.
+ */
+#define BAUD_PROPOSE_MESSAGE       0x15
+#define BAUD_ACCEPT_MESSAGE        0x16
+#define BAUD_CHECK_MESSAGE         0x17      /* Followed by the rate, its index in the burst and a fill */
+#define BAUD_MESSAGE_LENGTH        2
+#define BAUD_CHECK_LENGTH          LINK_MAX_PAYLOAD
+#define BAUD_CHECK_BURST           4         /* CHECK messages sent back to back each way */
+
+typedef struct {
+	UART_BaudType boot;        /* Rate of UART_init, used by the diagnostics tool too        */
+	UART_BaudType fastest;     /* Fastest rate proposed or accepted, boot to disable it      */
+	uint16 timeout;            /* Milliseconds to wait for an answer of the peer              */
+	uint8 wdgTask;             /* Watchdog task checked in while waiting                      */
+} BAUD_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Keep the configuration, the UART must already run at the boot rate.
+ */
+void BAUD_init(const BAUD_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Initiator: agree with the peer on the fastest rate that passes the check, from the
+ * fastest one down. Blocks up to one timeout per message awaited, call it right after a new
+ * session (a peer that does not know the messages leaves the link at its current rate).
+ */
+void BAUD_negotiate(void);
+
+/*
+ * Description :
+ * Responder: answer a PROPOSE message and check the new rate (blocks up to one timeout per CHECK).
+ * Return TRUE if the message was one of the negotiation.
+ */
+uint8 BAUD_handleMessage(const uint8 *message, uint8 length);
+
+/*
+ * Description :
+ * Go back to the boot rate, called when the peer stopped answering: a peer that was reset
+ * (or dropped a rate) runs at the boot rate.
+ */
+void BAUD_fallback(void);
+
+/*
+ * Description :
+ * Return the rate in use.
+ */
+UART_BaudType BAUD_getCurrent(void);
+
+#endif /* BAUD_H_ */
@@ -0,0 +1,246 @@
+ /******************************************************************************
+ *
+ * Module: CFG
+ *
+ * File Name: config_store.c
+ *
+ * Description: Source file for the wear-leveled key/value configuration store kept in the external EEPROM
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "config_store.h"
+#include "external_eeprom.h"
+#include "crc.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define CFG_NO_PAGE                0xFF
+#define CFG_ERASED_KEY             0xFF
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static CFG_ConfigType g_cfgConfig;
+
+/* RAM table: every value and the log page holding its latest record */
+static uint16 g_cfgValues[CFG_MAX_ITEMS];
+static uint8 g_cfgPage[CFG_MAX_ITEMS];
+
+static uint8 g_cfgHead = 0;                /* Page the records are appended to */
+static uint8 g_cfgUsed = CFG_RECORDS_PER_PAGE;   /* Records already in the head page */
+static uint16 g_cfgSequence = 0xFFFF;      /* Sequence of the head page */
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static CFG_StatusType CFG_startPage(void);
+static void CFG_makeRecord(uint8 *record, uint16 sequence, uint8 key, uint16 value);
+static uint16 CFG_pageAddress(uint8 page);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Replay the log once into the RAM table, keys without a valid record keep their default.
+ */
+void CFG_init(const CFG_ConfigType *configPtr)
+{
+	uint8 page[CFG_PAGE_SIZE];
+	CFG_ItemType item;
+	uint16 sequence, value;
+	uint8 found = FALSE;
+	uint8 index, p, r, key;
+	uint8 *record;
+
+	g_cfgConfig = *configPtr;
+	if (g_cfgConfig.itemCount > CFG_MAX_ITEMS)
+	{
+		g_cfgConfig.itemCount = CFG_MAX_ITEMS;
+	}
+	for (key = 0; key < g_cfgConfig.itemCount; key++)
+	{
+		memcpy_P(&item, &g_cfgConfig.items[key], sizeof(CFG_ItemType));
+		g_cfgValues[key] = item.defaultValue;
+		g_cfgPage[key] = CFG_NO_PAGE;
+	}
+
+	/* The head page is the valid page with the highest sequence (modulo 2^16) */
+	g_cfgHead = g_cfgConfig.pages - 1;
+	g_cfgUsed = CFG_RECORDS_PER_PAGE;
+	g_cfgSequence = 0xFFFF;
+	for (p = 0; p < g_cfgConfig.pages; p++)
+	{
+		if (EEPROM_readBlock(CFG_pageAddress(p), page, CFG_HEADER_SIZE) == ERROR)
+			continue;
+
+		sequence = page[0] | ((uint16)page[1] << 8);
+		if ((page[2] != CFG_PAGE_MARKER) || (page[3] != CRC_block8(CRC8_INIT, page, 3)))
+			continue;
+
+		if (!found || ((sint16)(sequence - g_cfgSequence) > 0))
+		{
+			found = TRUE;
+			g_cfgHead = p;
+			g_cfgSequence = sequence;
+		}
+	}
+	if (!found)
+		return;
+
+	/* Replay the pages from the oldest one (right after the head) to the head */
+	for (index = 1; index <= g_cfgConfig.pages; index++)
+	{
+		p = (g_cfgHead + index) % g_cfgConfig.pages;
+		if (EEPROM_readBlock(CFG_pageAddress(p), page, CFG_PAGE_SIZE) == ERROR)
+			continue;
+
+		sequence = page[0] | ((uint16)page[1] << 8);
+		if ((page[2] != CFG_PAGE_MARKER) || (page[3] != CRC_block8(CRC8_INIT, page, 3)) ||
+			((uint16)(g_cfgSequence - sequence) >= g_cfgConfig.pages))
+			continue;       /* Erased, torn, or left from an older lap */
+
+		for (r = 0; r < CFG_RECORDS_PER_PAGE; r++)
+		{
+			record = &page[CFG_HEADER_SIZE + (r * CFG_RECORD_SIZE)];
+			if (record[0] == CFG_ERASED_KEY)
+				break;
+
+			key = record[0];
+			value = record[1] | ((uint16)record[2] << 8);
+			if ((key < g_cfgConfig.itemCount) && (record[3] == CRC_block8(CRC_block8(CRC8_INIT, page, 2), record, 3)))
+			{
+				memcpy_P(&item, &g_cfgConfig.items[key], sizeof(CFG_ItemType));
+				if ((value >= item.minValue) && (value <= item.maxValue))
+				{
+					g_cfgValues[key] = value;
+					g_cfgPage[key] = p;
+				}
+			}
+		}
+		if (p == g_cfgHead)
+		{
+			g_cfgUsed = r;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Return the value of a key from the RAM table (0 for an unknown key).
+ */
+uint16 CFG_get(uint8 key)
+{
+	return (key < g_cfgConfig.itemCount) ? g_cfgValues[key] : 0;
+}
+
+/*
+ * Description :
+ * Check the range of a new value, append it to the log and update the RAM table.
+ * Setting the current value again writes nothing.
+ */
+CFG_StatusType CFG_set(uint8 key, uint16 value)
+{
+	uint8 record[CFG_RECORD_SIZE];
+	CFG_ItemType item;
+	CFG_StatusType status;
+
+	if (key >= g_cfgConfig.itemCount)
+		return CFG_INVALID_KEY;
+
+	memcpy_P(&item, &g_cfgConfig.items[key], sizeof(CFG_ItemType));
+	if ((value < item.minValue) || (value > item.maxValue))
+		return CFG_OUT_OF_RANGE;
+	if (value == g_cfgValues[key])
+		return CFG_OK;
+
+	if (g_cfgUsed == CFG_RECORDS_PER_PAGE)
+	{
+		status = CFG_startPage();
+		if (status != CFG_OK)
+			return status;
+	}
+
+	CFG_makeRecord(record, g_cfgSequence, key, value);
+	if (EEPROM_writeBlock(CFG_pageAddress(g_cfgHead) + CFG_HEADER_SIZE + (g_cfgUsed * CFG_RECORD_SIZE),
+						  record, CFG_RECORD_SIZE) == ERROR)
+	{
+		return CFG_EEPROM_ERROR;
+	}
+
+	g_cfgUsed++;
+	g_cfgValues[key] = value;
+	g_cfgPage[key] = g_cfgHead;
+	return CFG_OK;
+}
+
+/*
+ * Description :
+ * Move the head to the next page, rewritten in a single write with a new header and
+ * the values whose latest record it held. Repeated while the carried values fill the page.
+ */
+static CFG_StatusType CFG_startPage(void)
+{
+	uint8 page[CFG_PAGE_SIZE];
+	uint8 next, key, used, attempts;
+
+	for (attempts = 0; attempts < g_cfgConfig.pages; attempts++)
+	{
+		next = (g_cfgHead + 1) % g_cfgConfig.pages;
+		memset(page, 0xFF, CFG_PAGE_SIZE);
+		page[0] = (uint8)(g_cfgSequence + 1);
+		page[1] = (uint8)((g_cfgSequence + 1) >> 8);
+		page[2] = CFG_PAGE_MARKER;
+		page[3] = CRC_block8(CRC8_INIT, page, 3);
+
+		used = 0;
+		for (key = 0; key < g_cfgConfig.itemCount; key++)
+		{
+			if (g_cfgPage[key] == next)
+			{
+				CFG_makeRecord(&page[CFG_HEADER_SIZE + (used * CFG_RECORD_SIZE)], g_cfgSequence + 1, key, g_cfgValues[key]);
+				used++;
+			}
+		}
+
+		if (EEPROM_writeBlock(CFG_pageAddress(next), page, CFG_PAGE_SIZE) == ERROR)
+			return CFG_EEPROM_ERROR;
+
+		g_cfgHead = next;
+		g_cfgSequence++;
+		g_cfgUsed = used;
+		if (used < CFG_RECORDS_PER_PAGE)
+			return CFG_OK;
+	}
+	return CFG_EEPROM_ERROR;
+}
+
+/*
+ * Description :
+ * The record CRC also covers the page sequence, a record left from an older lap is never replayed.
+ */
+static void CFG_makeRecord(uint8 *record, uint16 sequence, uint8 key, uint16 value)
+{
+	uint8 sequenceBytes[2];
+
+	sequenceBytes[0] = (uint8)sequence;
+	sequenceBytes[1] = (uint8)(sequence >> 8);
+	record[0] = key;
+	record[1] = (uint8)value;
+	record[2] = (uint8)(value >> 8);
+	record[3] = CRC_block8(CRC_block8(CRC8_INIT, sequenceBytes, 2), record, 3);
+}
+
+static uint16 CFG_pageAddress(uint8 page)
+{
+	return g_cfgConfig.eepromAddress + ((uint16)page * CFG_PAGE_SIZE);
+}
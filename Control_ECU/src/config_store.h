@@ -0,0 +1,80 @@
+ /******************************************************************************
+ *
+ * Module: CFG
+ *
+ * File Name: config_store.h
+ *
+ * Description: Header file for the wear-leveled key/value configuration store kept in the external EEPROM
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef CONFIG_STORE_H_
+#define CONFIG_STORE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * The store is a log of 16-byte pages used in turn: header sequence(2) marker crc,
+ * then 3 records key value(2, low first) crc. A new value is appended to the current
+ * page, the latest record of a key wins. When the log moves to the next page, the
+ * values still living in it are carried forward first, so no page is rewritten
+ * before all the others were (compaction and wear leveling at once).
+ */
+#define CFG_PAGE_SIZE              16
+#define CFG_HEADER_SIZE            4
+#define CFG_RECORD_SIZE            4
+#define CFG_RECORDS_PER_PAGE       ((CFG_PAGE_SIZE - CFG_HEADER_SIZE) / CFG_RECORD_SIZE)
+#define CFG_PAGE_MARKER            0xC5
+#define CFG_MAX_ITEMS              8         /* Must stay below the records of all the pages but one */
+
+typedef enum {
+	CFG_OK,
+	CFG_INVALID_KEY,
+	CFG_OUT_OF_RANGE,
+	CFG_EEPROM_ERROR
+} CFG_StatusType;
+
+/* Stored in flash, indexed by the key */
+typedef struct {
+	uint16 defaultValue;           /* Used until a value is stored */
+	uint16 minValue;
+	uint16 maxValue;
+} CFG_ItemType;
+
+typedef struct {
+	uint16 eepromAddress;          /* Start of the log, 16-byte aligned */
+	uint8 pages;                   /* Log size in CFG_PAGE_SIZE pages */
+	const CFG_ItemType *items;     /* PROGMEM table of the keys */
+	uint8 itemCount;               /* Up to CFG_MAX_ITEMS */
+} CFG_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Replay the log once into the RAM table, keys without a valid record keep their default.
+ */
+void CFG_init(const CFG_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Return the value of a key from the RAM table (0 for an unknown key).
+ */
+uint16 CFG_get(uint8 key);
+
+/*
+ * Description :
+ * Check the range of a new value, append it to the log and update the RAM table.
+ * Setting the current value again writes nothing.
+ */
+CFG_StatusType CFG_set(uint8 key, uint16 value);
+
+#endif /* CONFIG_STORE_H_ */
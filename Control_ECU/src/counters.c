@@ -0,0 +1,213 @@
+ /******************************************************************************
+ *
+ * Module: COUNTER
+ *
+ * File Name: counters.c
+ *
+ * Description: Source file for the lifetime counters kept in the external EEPROM with a unary encoding
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include "counters.h"
+#include "external_eeprom.h"
+#include "crc.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define COUNTER_ERASED_BYTE        0xFF
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static COUNTER_ConfigType g_counterConfig;
+
+/* RAM mirror: every value, the page of its ring in use, the page sequence and the bits cleared in it */
+static uint32 g_counterValues[COUNTER_MAX_COUNTERS];
+static uint8 g_counterPage[COUNTER_MAX_COUNTERS];
+static uint8 g_counterSequence[COUNTER_MAX_COUNTERS];
+static uint8 g_counterUsed[COUNTER_MAX_COUNTERS];
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint8 COUNTER_startPage(uint8 counter);
+static uint8 COUNTER_unaryByte(uint8 used, uint8 index);
+static uint16 COUNTER_pageAddress(uint8 counter, uint8 page);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read every ring once to load the RAM mirror, an erased ring counts from 0.
+ */
+void COUNTER_init(const COUNTER_ConfigType *configPtr)
+{
+	uint8 page[COUNTER_PAGE_SIZE];
+	uint8 counter, p, i, bits, found;
+
+	g_counterConfig = *configPtr;
+	if (g_counterConfig.counters > COUNTER_MAX_COUNTERS)
+	{
+		g_counterConfig.counters = COUNTER_MAX_COUNTERS;
+	}
+
+	for (counter = 0; counter < g_counterConfig.counters; counter++)
+	{
+		/* Nothing valid yet: the first increment starts the first page */
+		g_counterValues[counter] = 0;
+		g_counterPage[counter] = g_counterConfig.pages - 1;
+		g_counterSequence[counter] = 0xFF;
+		g_counterUsed[counter] = COUNTER_BITS_PER_PAGE;
+		found = FALSE;
+
+		/* The page in use is the valid page with the highest sequence (modulo 2^8),
+		 * the CRC-8 of an erased (0xFF) header is 0xE7 so an erased page never validates */
+		for (p = 0; p < g_counterConfig.pages; p++)
+		{
+			if ((EEPROM_readBlock(COUNTER_pageAddress(counter, p), page, COUNTER_HEADER_SIZE) == ERROR) ||
+				(page[5] != CRC_block8(CRC8_INIT, page, 5)))
+				continue;       /* Erased, or the page write was interrupted by a reset */
+
+			if (!found || ((sint8)(page[4] - g_counterSequence[counter]) > 0))
+			{
+				found = TRUE;
+				g_counterPage[counter] = p;
+				g_counterSequence[counter] = page[4];
+			}
+		}
+		if (!found)
+			continue;
+
+		/* Value = base + the bits cleared in the unary bytes */
+		if (EEPROM_readBlock(COUNTER_pageAddress(counter, g_counterPage[counter]), page, COUNTER_PAGE_SIZE) == ERROR)
+			continue;
+
+		g_counterValues[counter] = page[0] | ((uint32)page[1] << 8) | ((uint32)page[2] << 16) | ((uint32)page[3] << 24);
+		g_counterUsed[counter] = 0;
+		for (i = COUNTER_HEADER_SIZE; i < COUNTER_PAGE_SIZE; i++)
+		{
+			for (bits = (uint8)~page[i]; bits != 0; bits &= (uint8)(bits - 1))
+			{
+				g_counterUsed[counter]++;      /* One per cleared bit, a torn byte is counted as read */
+			}
+		}
+		g_counterValues[counter] += g_counterUsed[counter];
+	}
+}
+
+/*
+ * Description :
+ * Add to a counter: the bits are cleared in one write of the bytes they touch, or the
+ * new value is consolidated into the next page when the current one has no bits left.
+ * Return ERROR if the EEPROM write failed (the RAM mirror is updated anyway).
+ */
+uint8 COUNTER_add(uint8 counter, uint16 amount)
+{
+	uint8 bytes[COUNTER_UNARY_SIZE];
+	uint8 first, last, i;
+	uint16 used;
+
+	if ((counter >= g_counterConfig.counters) || (amount == 0))
+		return ERROR;
+
+	g_counterValues[counter] += amount;
+
+	used = (uint16)g_counterUsed[counter] + amount;
+	if (used > COUNTER_BITS_PER_PAGE)
+		return COUNTER_startPage(counter);
+
+	/* Only the bytes holding the new bits are rewritten, most of the time a single one */
+	first = g_counterUsed[counter] / 8;
+	last = (uint8)((used - 1) / 8);
+	for (i = first; i <= last; i++)
+	{
+		bytes[i - first] = COUNTER_unaryByte((uint8)used, i);
+	}
+	g_counterUsed[counter] = (uint8)used;
+
+	return EEPROM_writeBlock(COUNTER_pageAddress(counter, g_counterPage[counter]) + COUNTER_HEADER_SIZE + first,
+							 bytes, (uint16)(last - first) + 1);
+}
+
+/*
+ * Description :
+ * Return the value of a counter from the RAM mirror (0 for an unknown counter).
+ */
+uint32 COUNTER_get(uint8 counter)
+{
+	return (counter < g_counterConfig.counters) ? g_counterValues[counter] : 0;
+}
+
+/*
+ * Description :
+ * Send every counter through UART: 'P' 'C' count value(4, low first) ...
+ */
+void COUNTER_sendReport(void)
+{
+	uint8 counter, i;
+
+	UART_sendByte(COUNTER_REPORT_SYNC1);
+	UART_sendByte(COUNTER_REPORT_SYNC2);
+	UART_sendByte(g_counterConfig.counters);
+	for (counter = 0; counter < g_counterConfig.counters; counter++)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			UART_sendByte((uint8)(g_counterValues[counter] >> (8 * i)));
+		}
+	}
+}
+
+/*
+ * Description :
+ * Consolidate the RAM value into the base of the next page of the ring, written in a
+ * single page write with all its unary bits erased. Until it completes, the previous
+ * page still holds the previous value.
+ */
+static uint8 COUNTER_startPage(uint8 counter)
+{
+	uint8 page[COUNTER_PAGE_SIZE];
+	uint8 next = (g_counterPage[counter] + 1) % g_counterConfig.pages;
+
+	memset(page, COUNTER_ERASED_BYTE, COUNTER_PAGE_SIZE);
+	page[0] = (uint8)g_counterValues[counter];
+	page[1] = (uint8)(g_counterValues[counter] >> 8);
+	page[2] = (uint8)(g_counterValues[counter] >> 16);
+	page[3] = (uint8)(g_counterValues[counter] >> 24);
+	page[4] = g_counterSequence[counter] + 1;
+	page[5] = CRC_block8(CRC8_INIT, page, 5);
+
+	if (EEPROM_writeBlock(COUNTER_pageAddress(counter, next), page, COUNTER_PAGE_SIZE) == ERROR)
+		return ERROR;
+
+	g_counterPage[counter] = next;
+	g_counterSequence[counter]++;
+	g_counterUsed[counter] = 0;
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Unary byte at an index once the first used bits are cleared, from the low bit up.
+ */
+static uint8 COUNTER_unaryByte(uint8 used, uint8 index)
+{
+	uint8 cleared = (used > (uint8)(index * 8)) ? (uint8)(used - (index * 8)) : 0;
+
+	return (cleared >= 8) ? 0x00 : (uint8)(COUNTER_ERASED_BYTE << cleared);
+}
+
+static uint16 COUNTER_pageAddress(uint8 counter, uint8 page)
+{
+	return g_counterConfig.eepromAddress + (((uint16)counter * g_counterConfig.pages + page) * COUNTER_PAGE_SIZE);
+}
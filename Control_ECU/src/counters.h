@@ -0,0 +1,74 @@
+ /******************************************************************************
+ *
+ * Module: COUNTER
+ *
+ * File Name: counters.h
+ *
+ * Description: Header file for the lifetime counters kept in the external EEPROM with a unary encoding
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef COUNTERS_H_
+#define COUNTERS_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Every counter owns a ring of 16-byte pages: base(4, low first) sequence check,
+ * then 10 unary bytes. An increment clears the next bit of the unary bytes (erased = 0xFF),
+ * so most increments rewrite a single byte. Once the 80 bits are cleared, the counter
+ * is consolidated into the base of the next page of its ring, written in one page write.
+ */
+#define COUNTER_PAGE_SIZE          16
+#define COUNTER_HEADER_SIZE        6
+#define COUNTER_UNARY_SIZE         (COUNTER_PAGE_SIZE - COUNTER_HEADER_SIZE)
+#define COUNTER_BITS_PER_PAGE      (COUNTER_UNARY_SIZE * 8)
+#define COUNTER_MAX_COUNTERS       4
+
+/* Sync bytes that start the report sent over the UART */
+#define COUNTER_REPORT_SYNC1       'P'
+#define COUNTER_REPORT_SYNC2       'C'
+
+typedef struct {
+	uint16 eepromAddress;          /* Start of the rings, 16-byte aligned */
+	uint8 counters;                /* Up to COUNTER_MAX_COUNTERS, the rings follow each other */
+	uint8 pages;                   /* Pages of each ring, each one is rewritten once per lap */
+} COUNTER_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read every ring once to load the RAM mirror, an erased ring counts from 0.
+ */
+void COUNTER_init(const COUNTER_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Add to a counter: the bits are cleared in one write of the bytes they touch, or the
+ * new value is consolidated into the next page when the current one has no bits left.
+ * Return ERROR if the EEPROM write failed (the RAM mirror is updated anyway).
+ */
+uint8 COUNTER_add(uint8 counter, uint16 amount);
+
+/*
+ * Description :
+ * Return the value of a counter from the RAM mirror (0 for an unknown counter).
+ */
+uint32 COUNTER_get(uint8 counter);
+
+/*
+ * Description :
+ * Send every counter through UART: 'P' 'C' count value(4, low first) ...
+ */
+void COUNTER_sendReport(void);
+
+#endif /* COUNTERS_H_ */
@@ -0,0 +1,460 @@
+ /******************************************************************************
+ *
+ * Module: CRC
+ *
+ * File Name: crc.c
+ *
+ * Description: Source file for the CRC-8, CRC-16-CCITT and CRC-32 engine of the storage records
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include "crc.h"
+#include "uart.h"
+#include "trace.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define CRC8_POLYNOMIAL            0x07
+#define CRC16_POLYNOMIAL           0x1021
+#define CRC32_POLYNOMIAL           0xEDB88320    /* Reflected 0x04C11DB7 */
+
+/* An implementation is compiled if it is selected or measured */
+#define CRC_IS_USED(impl)          (CRC_BENCHMARK_ENABLE || (CRC_IMPLEMENTATION == (impl)))
+
+#define CRC_BENCHMARK_PASSES       16        /* Passes over the check buffer, 1 KB per implementation */
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+#if CRC_IS_USED(CRC_IMPL_BITWISE)
+static uint8 CRC_bitwise8(uint8 crc, uint8 data);
+static uint16 CRC_bitwise16(uint16 crc, uint8 data);
+static uint32 CRC_bitwise32(uint32 crc, uint8 data);
+#endif
+#if CRC_IS_USED(CRC_IMPL_NIBBLE)
+static uint8 CRC_nibble8(uint8 crc, uint8 data);
+static uint16 CRC_nibble16(uint16 crc, uint8 data);
+#endif
+#if CRC_IS_USED(CRC_IMPL_NIBBLE) || CRC_IS_USED(CRC_IMPL_LIBC)
+static uint32 CRC_nibble32(uint32 crc, uint8 data);
+#endif
+#if CRC_IS_USED(CRC_IMPL_TABLE)
+static uint8 CRC_table8(uint8 crc, uint8 data);
+static uint16 CRC_table16(uint16 crc, uint8 data);
+static uint32 CRC_table32(uint32 crc, uint8 data);
+#endif
+#if CRC_IS_USED(CRC_IMPL_LIBC)
+static uint8 CRC_libc8(uint8 crc, uint8 data);
+static uint16 CRC_libc16(uint16 crc, uint8 data);
+#endif
+#if CRC_BENCHMARK_ENABLE
+static uint16 CRC_cyclesPerByte(uint32 microseconds);
+static void CRC_sendWord(uint16 value);
+#endif
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+#if CRC_IS_USED(CRC_IMPL_NIBBLE)
+/* CRC of the 4 high bits (CRC-8, CRC-16) of the index */
+static const uint8 g_crc8Nibbles[16] PROGMEM = {
+	0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+static const uint16 g_crc16Nibbles[16] PROGMEM = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_NIBBLE) || CRC_IS_USED(CRC_IMPL_LIBC)
+/* CRC of the 4 low bits (reflected CRC-32) of the index */
+static const uint32 g_crc32Nibbles[16] PROGMEM = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_TABLE)
+static const uint8 g_crc8Table[256] PROGMEM = {
+	0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+	0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+	0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+	0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+	0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+	0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+	0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+	0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+	0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+	0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+	0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+	0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+	0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+	0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+	0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+	0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+
+static const uint16 g_crc16Table[256] PROGMEM = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+static const uint32 g_crc32Table[256] PROGMEM = {
+	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+	0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+	0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+	0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+	0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+	0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+	0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+	0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+	0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+	0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+	0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+	0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+};
+#endif
+
+#if CRC_BENCHMARK_ENABLE
+/* Every implementation of a width, in CRC_IMPL_* order */
+static uint8 (* const g_crc8Functions[CRC_IMPL_COUNT])(uint8 crc, uint8 data) = {
+	CRC_bitwise8, CRC_nibble8, CRC_table8, CRC_libc8
+};
+static uint16 (* const g_crc16Functions[CRC_IMPL_COUNT])(uint16 crc, uint8 data) = {
+	CRC_bitwise16, CRC_nibble16, CRC_table16, CRC_libc16
+};
+static uint32 (* const g_crc32Functions[CRC_IMPL_COUNT])(uint32 crc, uint8 data) = {
+	CRC_bitwise32, CRC_nibble32, CRC_table32, CRC_nibble32
+};
+#endif
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Update a CRC with one byte, for the data checked while it streams in (ISR, block reads).
+ */
+uint8 CRC_update8(uint8 crc, uint8 data)
+{
+#if (CRC_IMPLEMENTATION == CRC_IMPL_BITWISE)
+	return CRC_bitwise8(crc, data);
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_NIBBLE)
+	return CRC_nibble8(crc, data);
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_TABLE)
+	return CRC_table8(crc, data);
+#else
+	return CRC_libc8(crc, data);
+#endif
+}
+
+uint16 CRC_update16(uint16 crc, uint8 data)
+{
+#if (CRC_IMPLEMENTATION == CRC_IMPL_BITWISE)
+	return CRC_bitwise16(crc, data);
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_NIBBLE)
+	return CRC_nibble16(crc, data);
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_TABLE)
+	return CRC_table16(crc, data);
+#else
+	return CRC_libc16(crc, data);
+#endif
+}
+
+uint32 CRC_update32(uint32 crc, uint8 data)
+{
+#if (CRC_IMPLEMENTATION == CRC_IMPL_BITWISE)
+	return CRC_bitwise32(crc, data);
+#elif (CRC_IMPLEMENTATION == CRC_IMPL_TABLE)
+	return CRC_table32(crc, data);
+#else
+	return CRC_nibble32(crc, data);
+#endif
+}
+
+/*
+ * Description :
+ * Update a CRC with a block of bytes.
+ */
+uint8 CRC_block8(uint8 crc, const uint8 *data, uint16 length)
+{
+	while (length-- != 0)
+	{
+		crc = CRC_update8(crc, *data++);
+	}
+	return crc;
+}
+
+uint16 CRC_block16(uint16 crc, const uint8 *data, uint16 length)
+{
+	while (length-- != 0)
+	{
+		crc = CRC_update16(crc, *data++);
+	}
+	return crc;
+}
+
+uint32 CRC_block32(uint32 crc, const uint8 *data, uint16 length)
+{
+	while (length-- != 0)
+	{
+		crc = CRC_update32(crc, *data++);
+	}
+	return crc;
+}
+
+#if CRC_BENCHMARK_ENABLE
+/*
+ * Description :
+ * Check every implementation against the "123456789" check values and measure it,
+ * then send the report through UART, all values little-endian:
+ * 'C' 'B' failures(2) then cycles per byte(2) of BITWISE NIBBLE TABLE LIBC for CRC-8, CRC-16, CRC-32
+ * where bit (width * CRC_IMPL_COUNT + implementation) of failures is set by a wrong check value.
+ */
+void CRC_sendBenchmark(void)
+{
+	static const uint8 check[9] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	uint16 cycles[3][CRC_IMPL_COUNT];
+	uint16 failures = 0;
+	uint32 start;
+	uint8 crc8;
+	uint16 crc16;
+	uint32 crc32;
+	uint8 impl, pass, i;
+
+	for (impl = 0; impl < CRC_IMPL_COUNT; impl++)
+	{
+		crc8 = CRC8_INIT;
+		crc16 = CRC16_INIT;
+		crc32 = CRC32_INIT;
+		for (i = 0; i < sizeof(check); i++)
+		{
+			crc8 = g_crc8Functions[impl](crc8, check[i]);
+			crc16 = g_crc16Functions[impl](crc16, check[i]);
+			crc32 = g_crc32Functions[impl](crc32, check[i]);
+		}
+		if (crc8 != 0xF4)
+			failures |= (uint16)1 << impl;
+		if (crc16 != 0x29B1)
+			failures |= (uint16)1 << (CRC_IMPL_COUNT + impl);
+		if (CRC32_FINAL(crc32) != 0xCBF43926)
+			failures |= (uint16)1 << ((2 * CRC_IMPL_COUNT) + impl);
+
+		/* The data does not change the cost, includes the call per byte like CRC_update8/16/32 */
+		start = TRACE_getMicroseconds();
+		for (pass = 0; pass < CRC_BENCHMARK_PASSES; pass++)
+		{
+			for (i = 0; i < 64; i++)
+			{
+				crc8 = g_crc8Functions[impl](crc8, pass);
+			}
+		}
+		cycles[0][impl] = CRC_cyclesPerByte(TRACE_getMicroseconds() - start);
+
+		start = TRACE_getMicroseconds();
+		for (pass = 0; pass < CRC_BENCHMARK_PASSES; pass++)
+		{
+			for (i = 0; i < 64; i++)
+			{
+				crc16 = g_crc16Functions[impl](crc16, pass);
+			}
+		}
+		cycles[1][impl] = CRC_cyclesPerByte(TRACE_getMicroseconds() - start);
+
+		start = TRACE_getMicroseconds();
+		for (pass = 0; pass < CRC_BENCHMARK_PASSES; pass++)
+		{
+			for (i = 0; i < 64; i++)
+			{
+				crc32 = g_crc32Functions[impl](crc32, pass);
+			}
+		}
+		cycles[2][impl] = CRC_cyclesPerByte(TRACE_getMicroseconds() - start);
+	}
+
+	UART_sendByte(CRC_REPORT_SYNC1);
+	UART_sendByte(CRC_REPORT_SYNC2);
+	CRC_sendWord(failures);
+	for (i = 0; i < 3; i++)
+	{
+		for (impl = 0; impl < CRC_IMPL_COUNT; impl++)
+		{
+			CRC_sendWord(cycles[i][impl]);
+		}
+	}
+}
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_BITWISE)
+static uint8 CRC_bitwise8(uint8 crc, uint8 data)
+{
+	uint8 bit;
+
+	crc ^= data;
+	for (bit = 0; bit < 8; bit++)
+	{
+		crc = (crc & 0x80) ? (uint8)((crc << 1) ^ CRC8_POLYNOMIAL) : (uint8)(crc << 1);
+	}
+	return crc;
+}
+
+static uint16 CRC_bitwise16(uint16 crc, uint8 data)
+{
+	uint8 bit;
+
+	crc ^= (uint16)data << 8;
+	for (bit = 0; bit < 8; bit++)
+	{
+		crc = (crc & 0x8000) ? (uint16)((crc << 1) ^ CRC16_POLYNOMIAL) : (uint16)(crc << 1);
+	}
+	return crc;
+}
+
+static uint32 CRC_bitwise32(uint32 crc, uint8 data)
+{
+	uint8 bit;
+
+	crc ^= data;
+	for (bit = 0; bit < 8; bit++)
+	{
+		crc = (crc & 1) ? ((crc >> 1) ^ CRC32_POLYNOMIAL) : (crc >> 1);
+	}
+	return crc;
+}
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_NIBBLE)
+static uint8 CRC_nibble8(uint8 crc, uint8 data)
+{
+	crc ^= data;
+	crc = (uint8)(crc << 4) ^ pgm_read_byte(&g_crc8Nibbles[crc >> 4]);
+	crc = (uint8)(crc << 4) ^ pgm_read_byte(&g_crc8Nibbles[crc >> 4]);
+	return crc;
+}
+
+static uint16 CRC_nibble16(uint16 crc, uint8 data)
+{
+	crc ^= (uint16)data << 8;
+	crc = (uint16)(crc << 4) ^ pgm_read_word(&g_crc16Nibbles[crc >> 12]);
+	crc = (uint16)(crc << 4) ^ pgm_read_word(&g_crc16Nibbles[crc >> 12]);
+	return crc;
+}
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_NIBBLE) || CRC_IS_USED(CRC_IMPL_LIBC)
+static uint32 CRC_nibble32(uint32 crc, uint8 data)
+{
+	crc ^= data;
+	crc = (crc >> 4) ^ pgm_read_dword(&g_crc32Nibbles[crc & 0x0F]);
+	crc = (crc >> 4) ^ pgm_read_dword(&g_crc32Nibbles[crc & 0x0F]);
+	return crc;
+}
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_TABLE)
+static uint8 CRC_table8(uint8 crc, uint8 data)
+{
+	return pgm_read_byte(&g_crc8Table[crc ^ data]);
+}
+
+static uint16 CRC_table16(uint16 crc, uint8 data)
+{
+	return (uint16)(crc << 8) ^ pgm_read_word(&g_crc16Table[(uint8)(crc >> 8) ^ data]);
+}
+
+static uint32 CRC_table32(uint32 crc, uint8 data)
+{
+	return (crc >> 8) ^ pgm_read_dword(&g_crc32Table[(uint8)crc ^ data]);
+}
+#endif
+
+#if CRC_IS_USED(CRC_IMPL_LIBC)
+static uint8 CRC_libc8(uint8 crc, uint8 data)
+{
+	return _crc8_ccitt_update(crc, data);
+}
+
+static uint16 CRC_libc16(uint16 crc, uint8 data)
+{
+	return _crc_xmodem_update(crc, data);
+}
+#endif
+
+#if CRC_BENCHMARK_ENABLE
+/*
+ * Description :
+ * Cycles per byte of the CRC_BENCHMARK_PASSES * 64 bytes timed, rounded.
+ */
+static uint16 CRC_cyclesPerByte(uint32 microseconds)
+{
+	uint32 bytes = (uint32)CRC_BENCHMARK_PASSES * 64;
+
+	return (uint16)(((microseconds * (F_CPU / 1000000UL)) + (bytes / 2)) / bytes);
+}
+
+static void CRC_sendWord(uint16 value)
+{
+	UART_sendByte((uint8)value);
+	UART_sendByte((uint8)(value >> 8));
+}
+#endif
@@ -0,0 +1,91 @@
+ /******************************************************************************
+ *
+ * Module: CRC
+ *
+ * File Name: crc.h
+ *
+ * Description: Header file for the CRC-8, CRC-16-CCITT and CRC-32 engine of the storage records
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Implementation used by CRC_update8/16/32 and CRC_block8/16/32, chosen at build time
+ * with -DCRC_IMPLEMENTATION=...:
+ * BITWISE: no table, one shift per bit.
+ * NIBBLE : 16-entry tables in flash (112 bytes for the three widths), two lookups per byte.
+ * TABLE  : 256-entry tables in flash (1792 bytes for the three widths), one lookup per byte.
+ * LIBC   : the avr-libc <util/crc16.h> inline assembly routines (CRC-32 has none, it uses NIBBLE).
+ */
+#define CRC_IMPL_BITWISE           0
+#define CRC_IMPL_NIBBLE            1
+#define CRC_IMPL_TABLE             2
+#define CRC_IMPL_LIBC              3
+#define CRC_IMPL_COUNT             4
+
+#ifndef CRC_IMPLEMENTATION
+#define CRC_IMPLEMENTATION         CRC_IMPL_NIBBLE
+#endif
+
+/* The benchmark links every implementation, so only a diagnostics build enables it with -DCRC_BENCHMARK_ENABLE=1 */
+#ifndef CRC_BENCHMARK_ENABLE
+#define CRC_BENCHMARK_ENABLE       0
+#endif
+
+/*
+ * CRC-8      : poly 0x07, not reflected, init 0x00 (the records of the storage modules).
+ * CRC-16     : CCITT poly 0x1021, not reflected, init 0xFFFF (CRC-16/CCITT-FALSE).
+ * CRC-32     : poly 0x04C11DB7 reflected, init and final XOR 0xFFFFFFFF (IEEE 802.3).
+ * Start with the INIT value, feed the bytes as they arrive, then apply the FINAL macro.
+ */
+#define CRC8_INIT                  0x00
+#define CRC16_INIT                 0xFFFF
+#define CRC32_INIT                 0xFFFFFFFF
+#define CRC32_FINAL(crc)           (~(crc))
+
+/* Sync bytes that start the benchmark report sent over the UART */
+#define CRC_REPORT_SYNC1           'C'
+#define CRC_REPORT_SYNC2           'B'
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Update a CRC with one byte, for the data checked while it streams in (ISR, block reads).
+ */
+uint8 CRC_update8(uint8 crc, uint8 data);
+uint16 CRC_update16(uint16 crc, uint8 data);
+uint32 CRC_update32(uint32 crc, uint8 data);
+
+/*
+ * Description :
+ * Update a CRC with a block of bytes.
+ */
+uint8 CRC_block8(uint8 crc, const uint8 *data, uint16 length);
+uint16 CRC_block16(uint16 crc, const uint8 *data, uint16 length);
+uint32 CRC_block32(uint32 crc, const uint8 *data, uint16 length);
+
+#if CRC_BENCHMARK_ENABLE
+/*
+ * Description :
+ * Check every implementation against the "123456789" check values and measure it,
+ * then send the report through UART, all values little-endian:
+ * 'C' 'B' failures(2) then cycles per byte(2) of BITWISE NIBBLE TABLE LIBC for CRC-8, CRC-16, CRC-32
+ * where bit (width * CRC_IMPL_COUNT + implementation) of failures is set by a wrong check value.
+ */
+void CRC_sendBenchmark(void);
+#endif
+
+#endif /* CRC_H_ */
@@ -0,0 +1,437 @@
+ /******************************************************************************
+ *
+ * Module: CREDENTIALS
+ *
+ * File Name: credentials.c
+ *
+ * Description: Source file for the multi-user credentials table hashed on the entered code
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include "credentials.h"
+#include "password_hash.h"
+#include "external_eeprom.h"
+#include "dual_bank.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static CRED_ConfigType g_credConfig;
+static CRED_HeaderType g_credHeader;
+static BANK_RecordType g_credHeaderBanks;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint8 CRED_find(const uint8 *digest, CRED_SlotType *slot);
+static uint8 CRED_findUser(uint8 userId, CRED_SlotType *slot);
+static CRED_StatusType CRED_insert(CRED_SlotType *slot);
+static void CRED_finishChanges(void);
+static uint8 CRED_homeSlot(const uint8 *digest);
+static uint16 CRED_slotAddress(uint8 index);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Load the newest valid bank of the table header from EEPROM, then finish a code change
+ * interrupted by a reset.
+ */
+void CRED_init(const CRED_ConfigType *configPtr)
+{
+	uint8 legacy[BANK_PAGE_SIZE];
+
+	g_credConfig = *configPtr;
+	g_credHeaderBanks.backend = &STORAGE_externalEeprom;       /* Next to the slots */
+	g_credHeaderBanks.addressA = g_credConfig.eepromAddress;
+	g_credHeaderBanks.addressB = g_credConfig.headerCopyAddress;
+	g_credHeaderBanks.size = sizeof(CRED_HeaderType);
+
+	g_credHeader.magic = 0;
+	if (!BANK_load(&g_credHeaderBanks, (uint8 *)&g_credHeader))
+	{
+		/* A header of older firmwares has no sequence and no CRC (0xFF 0xFF), it is rewritten as a bank once */
+		if ((EEPROM_readBlock(g_credConfig.eepromAddress, legacy, BANK_PAGE_SIZE) == SUCCESS) &&
+			(legacy[BANK_SEQUENCE_OFFSET] == 0xFF) && (legacy[BANK_CRC_OFFSET] == 0xFF))
+		{
+			memcpy(&g_credHeader, legacy, sizeof(CRED_HeaderType));
+			if (CRED_isFormatted())
+			{
+				BANK_store(&g_credHeaderBanks, (const uint8 *)&g_credHeader);
+			}
+		}
+	}
+
+	if (CRED_isFormatted())
+	{
+		CRED_finishChanges();
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE if the table was formatted.
+ */
+uint8 CRED_isFormatted(void)
+{
+	return (g_credHeader.magic == CRED_MAGIC) &&
+		   (g_credHeader.iterations >= PWHASH_MIN_ITERATIONS) && (g_credHeader.iterations <= PWHASH_MAX_ITERATIONS);
+}
+
+/*
+ * Description :
+ * Create an empty table with a new salt and the given PBKDF2 iteration count.
+ */
+CRED_StatusType CRED_format(uint16 iterations)
+{
+	uint8 state = CRED_SLOT_EMPTY;
+	uint8 index;
+
+	/* The header is only valid once every slot was emptied */
+	g_credHeader.magic = 0;
+	if (BANK_store(&g_credHeaderBanks, (const uint8 *)&g_credHeader) == ERROR)
+		return CRED_EEPROM_ERROR;
+
+	for (index = 0; index < g_credConfig.slots; index++)
+	{
+		if (EEPROM_writeBlock(CRED_slotAddress(index), &state, 1) == ERROR)
+			return CRED_EEPROM_ERROR;
+	}
+
+	PWHASH_newSalt(g_credHeader.salt, (const uint8 *)&g_credHeader, sizeof(CRED_HeaderType));
+	g_credHeader.iterations = iterations;
+	g_credHeader.magic = CRED_MAGIC;
+	memset(g_credHeader.reserved, 0xFF, sizeof(g_credHeader.reserved));
+	if (BANK_store(&g_credHeaderBanks, (const uint8 *)&g_credHeader) == ERROR)
+		return CRED_EEPROM_ERROR;
+
+	return CRED_OK;
+}
+
+/*
+ * Description :
+ * Find the user of a code, return its slot index (and the slot) or CRED_NOT_FOUND.
+ * One PBKDF2 derivation and usually one or two slot reads, whatever the number of users.
+ */
+uint8 CRED_lookup(const uint8 *code, uint8 length, CRED_SlotType *slot)
+{
+	uint8 digest[PWHASH_DIGEST_SIZE];
+
+	if (!CRED_isFormatted())
+		return CRED_NOT_FOUND;
+
+	PWHASH_derive(code, length, g_credHeader.salt, g_credHeader.iterations, digest);
+	return CRED_find(digest, slot);
+}
+
+/*
+ * Description :
+ * Add a user with its code, flags and validity window.
+ */
+CRED_StatusType CRED_add(uint8 userId, const uint8 *code, uint8 length, uint8 flags, uint32 validFrom, uint32 validUntil)
+{
+	CRED_SlotType slot;
+	uint8 digest[PWHASH_DIGEST_SIZE];
+
+	if (!CRED_isFormatted())
+		return CRED_EEPROM_ERROR;
+	switch (CRED_findUser(userId, &slot))
+	{
+	case CRED_NOT_FOUND:
+		break;
+	case CRED_READ_FAILED:
+		return CRED_EEPROM_ERROR;
+	default:
+		return CRED_ID_IN_USE;
+	}
+
+	memset(&slot, 0xFF, sizeof(CRED_SlotType));
+	slot.userId = userId;
+	slot.flags = flags;
+	slot.generation = 0;
+	slot.validFrom = validFrom;
+	slot.validUntil = validUntil;
+	PWHASH_derive(code, length, g_credHeader.salt, g_credHeader.iterations, digest);
+	memcpy(slot.digest, digest, CRED_DIGEST_SIZE);
+
+	return CRED_insert(&slot);
+}
+
+/*
+ * Description :
+ * Give the user of a slot a new code (the slot follows the new digest).
+ */
+CRED_StatusType CRED_changeCode(uint8 index, const uint8 *code, uint8 length)
+{
+	CRED_SlotType slot;
+	uint8 state = CRED_SLOT_DELETED;
+	CRED_StatusType status;
+	uint8 digest[PWHASH_DIGEST_SIZE];
+
+	if (index >= g_credConfig.slots)
+		return CRED_UNKNOWN_USER;
+	switch (CRED_readSlot(index, &slot))
+	{
+	case CRED_READ_ERROR:
+		return CRED_EEPROM_ERROR;
+	case CRED_READ_FREE:
+		return CRED_UNKNOWN_USER;
+	default:
+		break;
+	}
+
+	PWHASH_derive(code, length, g_credHeader.salt, g_credHeader.iterations, digest);
+	if (PWHASH_isEqual(digest, slot.digest, CRED_DIGEST_SIZE))
+		return CRED_OK;         /* Same code, nothing to move */
+	memcpy(slot.digest, digest, CRED_DIGEST_SIZE);
+	slot.generation++;
+
+	/* The new slot is written before the old one is deleted, a reset in between is finished by CRED_init */
+	status = CRED_insert(&slot);
+	if (status != CRED_OK)
+		return status;
+
+	if (EEPROM_writeBlock(CRED_slotAddress(index), &state, 1) == ERROR)
+		return CRED_EEPROM_ERROR;
+	return CRED_OK;
+}
+
+/*
+ * Description :
+ * Revoke every code of a user.
+ */
+CRED_StatusType CRED_revoke(uint8 userId)
+{
+	CRED_SlotType slot;
+	uint8 state = CRED_SLOT_DELETED;
+	uint8 index = CRED_findUser(userId, &slot);
+
+	if (index == CRED_NOT_FOUND)
+		return CRED_UNKNOWN_USER;
+
+	/* A tombstone, not an empty slot: the users probed after it must still be found */
+	while (index != CRED_NOT_FOUND)
+	{
+		if ((index == CRED_READ_FAILED) || (EEPROM_writeBlock(CRED_slotAddress(index), &state, 1) == ERROR))
+			return CRED_EEPROM_ERROR;
+		index = CRED_findUser(userId, &slot);
+	}
+
+	return CRED_OK;
+}
+
+/*
+ * Description :
+ * Read a slot by index (0 to slots - 1), return whether it holds a user. Used to list the users.
+ */
+CRED_ReadType CRED_readSlot(uint8 index, CRED_SlotType *slot)
+{
+	if (EEPROM_readBlock(CRED_slotAddress(index), (uint8 *)slot, sizeof(CRED_SlotType)) == ERROR)
+		return CRED_READ_ERROR;
+
+	return (slot->state == CRED_SLOT_USED) ? CRED_READ_USED : CRED_READ_FREE;
+}
+
+/*
+ * Description :
+ * Return the number of slots of the table.
+ */
+uint8 CRED_getSlotCount(void)
+{
+	return g_credConfig.slots;
+}
+
+/*
+ * Description :
+ * Return TRUE if at least one administrator is stored.
+ */
+uint8 CRED_hasAdmin(void)
+{
+	CRED_SlotType slot;
+	uint8 index;
+
+	if (!CRED_isFormatted())
+		return FALSE;
+
+	for (index = 0; index < g_credConfig.slots; index++)
+	{
+		/* An unreadable slot may hold the administrator, the first-run setup must not be offered */
+		switch (CRED_readSlot(index, &slot))
+		{
+		case CRED_READ_ERROR:
+			return TRUE;
+		case CRED_READ_USED:
+			if (slot.flags & CRED_FLAG_ADMIN)
+				return TRUE;
+			break;
+		default:
+			break;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Return TRUE if the user may enter at the given time. A user with a validity window
+ * is refused while the time is not known (clock not set).
+ */
+uint8 CRED_isValidAt(const CRED_SlotType *slot, uint32 time, uint8 timeKnown)
+{
+	if ((slot->validFrom == CRED_ALWAYS_VALID_FROM) && (slot->validUntil == CRED_ALWAYS_VALID_UNTIL))
+		return TRUE;
+
+	return timeKnown && (time >= slot->validFrom) && (time <= slot->validUntil);
+}
+
+/*
+ * Description :
+ * Probe from the home slot of the digest until an empty slot, return the index of the
+ * used slot holding the digest, CRED_NOT_FOUND or CRED_READ_FAILED (the probe cannot go on).
+ */
+static uint8 CRED_find(const uint8 *digest, CRED_SlotType *slot)
+{
+	uint8 index = CRED_homeSlot(digest);
+	uint8 probe;
+
+	for (probe = 0; probe < g_credConfig.slots; probe++)
+	{
+		if (CRED_readSlot(index, slot) == CRED_READ_ERROR)
+			return CRED_READ_FAILED;
+		if (slot->state == CRED_SLOT_EMPTY)
+			break;
+		if ((slot->state == CRED_SLOT_USED) && PWHASH_isEqual(slot->digest, digest, CRED_DIGEST_SIZE))
+			return index;
+
+		index = (index + 1) % g_credConfig.slots;
+	}
+	return CRED_NOT_FOUND;
+}
+
+/*
+ * Description :
+ * Scan the table for a user id (administration only, the door path never scans),
+ * return its slot index, CRED_NOT_FOUND or CRED_READ_FAILED.
+ */
+static uint8 CRED_findUser(uint8 userId, CRED_SlotType *slot)
+{
+	uint8 index;
+
+	for (index = 0; index < g_credConfig.slots; index++)
+	{
+		switch (CRED_readSlot(index, slot))
+		{
+		case CRED_READ_ERROR:
+			return CRED_READ_FAILED;
+		case CRED_READ_USED:
+			if (slot->userId == userId)
+				return index;
+			break;
+		default:
+			break;
+		}
+	}
+	return CRED_NOT_FOUND;
+}
+
+/*
+ * Description :
+ * Store a slot at the first free position of the probe sequence of its digest.
+ */
+static CRED_StatusType CRED_insert(CRED_SlotType *slot)
+{
+	CRED_SlotType probed;
+	uint8 index, probe;
+	uint8 freeIndex = CRED_NOT_FOUND;
+	uint16 address;
+
+	/* Walk the whole sequence: the code must not be stored already, even after a tombstone */
+	index = CRED_homeSlot(slot->digest);
+	for (probe = 0; probe < g_credConfig.slots; probe++)
+	{
+		/* An unreadable slot is not free, it may hold a user that would be overwritten */
+		if (CRED_readSlot(index, &probed) == CRED_READ_ERROR)
+			return CRED_EEPROM_ERROR;
+		if ((probed.state == CRED_SLOT_USED) && PWHASH_isEqual(probed.digest, slot->digest, CRED_DIGEST_SIZE))
+			return CRED_CODE_IN_USE;
+		if ((probed.state != CRED_SLOT_USED) && (freeIndex == CRED_NOT_FOUND))
+		{
+			freeIndex = index;
+		}
+		if (probed.state == CRED_SLOT_EMPTY)
+			break;
+
+		index = (index + 1) % g_credConfig.slots;
+	}
+	if (freeIndex == CRED_NOT_FOUND)
+		return CRED_TABLE_FULL;
+
+	/* The page holding the state byte is written last, it commits the slot */
+	slot->state = CRED_SLOT_USED;
+	address = CRED_slotAddress(freeIndex);
+	if (EEPROM_writeBlock(address, (const uint8 *)slot, CRED_SLOT_SIZE) == ERROR)
+		return CRED_EEPROM_ERROR;
+	return CRED_OK;
+}
+
+/*
+ * Description :
+ * A user held by two slots means a code change was interrupted between writing the new
+ * slot and deleting the old one: the slot of the older generation is deleted now.
+ */
+static void CRED_finishChanges(void)
+{
+	uint8 users[CRED_MAX_SLOTS];
+	uint8 generations[CRED_MAX_SLOTS];
+	CRED_SlotType slot;
+	uint8 state = CRED_SLOT_DELETED;
+	uint8 index, other;
+
+	for (index = 0; (index < g_credConfig.slots) && (index < CRED_MAX_SLOTS); index++)
+	{
+		users[index] = CRED_NOT_FOUND;
+		if (CRED_readSlot(index, &slot) != CRED_READ_USED)
+			continue;
+
+		for (other = 0; other < index; other++)
+		{
+			if (users[other] != slot.userId)
+				continue;
+
+			if ((sint8)(slot.generation - generations[other]) > 0)
+			{
+				EEPROM_writeBlock(CRED_slotAddress(other), &state, 1);
+				users[other] = CRED_NOT_FOUND;
+			}
+			else
+			{
+				EEPROM_writeBlock(CRED_slotAddress(index), &state, 1);
+				slot.userId = CRED_NOT_FOUND;
+			}
+			break;
+		}
+		users[index] = slot.userId;
+		generations[index] = slot.generation;
+	}
+}
+
+/*
+ * Description :
+ * Home slot of a digest (its first two bytes are uniformly distributed).
+ */
+static uint8 CRED_homeSlot(const uint8 *digest)
+{
+	return (uint8)((((uint16)digest[0] << 8) | digest[1]) % g_credConfig.slots);
+}
+
+static uint16 CRED_slotAddress(uint8 index)
+{
+	return g_credConfig.eepromAddress + CRED_HEADER_SIZE + ((uint16)index * CRED_SLOT_SIZE);
+}
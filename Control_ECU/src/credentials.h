@@ -0,0 +1,160 @@
+ /******************************************************************************
+ *
+ * Module: CREDENTIALS
+ *
+ * File Name: credentials.h
+ *
+ * Description: Header file for the multi-user credentials table hashed on the entered code
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef CREDENTIALS_H_
+#define CREDENTIALS_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * EEPROM layout: a 16-byte header followed by the 32-byte slots, the header is a BANK record
+ * whose second bank is kept apart (headerCopyAddress).
+ * The table is open addressed: a code is hashed with the table salt (PBKDF2), the digest
+ * gives the home slot and the following slots are probed until an empty one.
+ */
+#define CRED_MAGIC                 0x4352      /* Marks a formatted table, an erased EEPROM reads 0xFFFF */
+#define CRED_HEADER_SIZE           16
+#define CRED_SLOT_SIZE             32
+#define CRED_DIGEST_SIZE           16          /* Stored part of the PBKDF2 digest */
+
+#define CRED_NOT_FOUND             0xFF        /* Returned instead of a slot index */
+#define CRED_READ_FAILED           0xFE        /* Returned instead of a slot index when a slot could not be read */
+#define CRED_MAX_SLOTS             32          /* Slots checked for an interrupted code change at init */
+#define CRED_ALWAYS_VALID_FROM     0x00000000UL
+#define CRED_ALWAYS_VALID_UNTIL    0xFFFFFFFFUL
+
+/* Slot flags */
+#define CRED_FLAG_ADMIN            0x01        /* May change the users table */
+
+typedef enum {
+	CRED_SLOT_DELETED = 0x00,  /* Revoked: skipped by the lookups but does not end a probe sequence */
+	CRED_SLOT_USED    = 0xA5,
+	CRED_SLOT_EMPTY   = 0xFF   /* Never used (erased EEPROM), ends a probe sequence */
+} CRED_SlotStateType;
+
+typedef enum {
+	CRED_OK,
+	CRED_TABLE_FULL,
+	CRED_CODE_IN_USE,          /* The code is the lookup key, two users cannot share it */
+	CRED_ID_IN_USE,
+	CRED_UNKNOWN_USER,
+	CRED_EEPROM_ERROR
+} CRED_StatusType;
+
+typedef enum {
+	CRED_READ_FREE,            /* Empty or deleted */
+	CRED_READ_USED,
+	CRED_READ_ERROR            /* The EEPROM did not answer, the slot may hold a user */
+} CRED_ReadType;
+
+typedef struct {
+	uint8 state;               /* CRED_SlotStateType, written last so a torn write leaves the slot unused */
+	uint8 userId;
+	uint8 flags;
+	uint8 generation;          /* Incremented by every code change, the newest slot of a user wins */
+	uint32 validFrom;          /* RTC time, CRED_ALWAYS_VALID_FROM for no start      */
+	uint32 validUntil;         /* RTC time, CRED_ALWAYS_VALID_UNTIL for no end       */
+	uint8 digest[CRED_DIGEST_SIZE];
+	uint8 reserved2[4];
+} CRED_SlotType;
+
+typedef struct {
+	uint16 magic;
+	uint16 iterations;         /* PBKDF2 iterations of every code of the table */
+	uint8 salt[8];             /* Table salt (the index needs the same salt for every code) */
+	uint8 reserved[2];         /* Up to BANK_MAX_PAYLOAD bytes, a header of older firmwares ends with 0xFF 0xFF */
+} CRED_HeaderType;
+
+typedef struct {
+	uint16 eepromAddress;      /* Header address, 16-byte aligned */
+	uint8 slots;               /* Table size, a prime keeps the probe sequences short */
+	uint16 headerCopyAddress;  /* Second bank of the header, 16-byte aligned */
+} CRED_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Load the newest valid bank of the table header from EEPROM, then finish a code change
+ * interrupted by a reset.
+ */
+void CRED_init(const CRED_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Return TRUE if the table was formatted.
+ */
+uint8 CRED_isFormatted(void);
+
+/*
+ * Description :
+ * Create an empty table with a new salt and the given PBKDF2 iteration count.
+ */
+CRED_StatusType CRED_format(uint16 iterations);
+
+/*
+ * Description :
+ * Find the user of a code, return its slot index (and the slot), CRED_NOT_FOUND or CRED_READ_FAILED.
+ * One PBKDF2 derivation and usually one or two slot reads, whatever the number of users.
+ */
+uint8 CRED_lookup(const uint8 *code, uint8 length, CRED_SlotType *slot);
+
+/*
+ * Description :
+ * Add a user with its code, flags and validity window.
+ */
+CRED_StatusType CRED_add(uint8 userId, const uint8 *code, uint8 length, uint8 flags, uint32 validFrom, uint32 validUntil);
+
+/*
+ * Description :
+ * Give the user of a slot a new code (the slot follows the new digest).
+ */
+CRED_StatusType CRED_changeCode(uint8 index, const uint8 *code, uint8 length);
+
+/*
+ * Description :
+ * Revoke every code of a user.
+ */
+CRED_StatusType CRED_revoke(uint8 userId);
+
+/*
+ * Description :
+ * Read a slot by index (0 to slots - 1), return whether it holds a user. Used to list the users.
+ */
+CRED_ReadType CRED_readSlot(uint8 index, CRED_SlotType *slot);
+
+/*
+ * Description :
+ * Return the number of slots of the table.
+ */
+uint8 CRED_getSlotCount(void);
+
+/*
+ * Description :
+ * Return TRUE if at least one administrator is stored.
+ */
+uint8 CRED_hasAdmin(void);
+
+/*
+ * Description :
+ * Return TRUE if the user may enter at the given time. A user with a validity window
+ * is refused while the time is not known (clock not set).
+ */
+uint8 CRED_isValidAt(const CRED_SlotType *slot, uint32 time, uint8 timeKnown);
+
+#endif /* CREDENTIALS_H_ */
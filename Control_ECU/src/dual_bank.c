@@ -0,0 +1,85 @@
+ /******************************************************************************
+ *
+ * Module: BANK
+ *
+ * File Name: dual_bank.c
+ *
+ * Description: Source file for the records kept in two EEPROM banks and updated atomically
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include "dual_bank.h"
+#include "external_eeprom.h"   /* To use SUCCESS and ERROR */
+#include "crc.h"
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint16 BANK_address(const BANK_RecordType *record, uint8 bank);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read both banks (one block read each) and copy the payload of the newest valid one.
+ * Return FALSE if none is valid, the data is then left unchanged.
+ */
+uint8 BANK_load(BANK_RecordType *record, uint8 *data)
+{
+	uint8 page[BANK_PAGE_SIZE];
+	uint8 bank;
+	uint8 found = FALSE;
+
+	record->active = 1;               /* With nothing valid, the first store goes to bank A */
+	record->sequence = 0xFF;
+
+	for (bank = 0; bank < 2; bank++)
+	{
+		if ((record->backend->readBlock(BANK_address(record, bank), page, BANK_PAGE_SIZE) == ERROR) ||
+			(page[BANK_CRC_OFFSET] != CRC_block8(CRC8_INIT, page, BANK_CRC_OFFSET)))
+			continue;       /* Erased, or the page write was interrupted by a reset */
+
+		/* Bank B only wins if it is newer, the two sequences are never equal */
+		if (!found || ((sint8)(page[BANK_SEQUENCE_OFFSET] - record->sequence) > 0))
+		{
+			found = TRUE;
+			record->active = bank;
+			record->sequence = page[BANK_SEQUENCE_OFFSET];
+			memcpy(data, page, record->size);
+		}
+	}
+	return found;
+}
+
+/*
+ * Description :
+ * Write a new payload to the inactive bank in one page write, then make it the active one.
+ */
+uint8 BANK_store(BANK_RecordType *record, const uint8 *data)
+{
+	uint8 page[BANK_PAGE_SIZE];
+	uint8 inactive = record->active ^ 1;
+
+	memset(page, 0xFF, BANK_PAGE_SIZE);
+	memcpy(page, data, record->size);
+	page[BANK_SEQUENCE_OFFSET] = record->sequence + 1;
+	page[BANK_CRC_OFFSET] = CRC_block8(CRC8_INIT, page, BANK_CRC_OFFSET);
+
+	if (record->backend->writeBlock(BANK_address(record, inactive), page, BANK_PAGE_SIZE) == ERROR)
+		return ERROR;
+
+	record->active = inactive;
+	record->sequence++;
+	return SUCCESS;
+}
+
+static uint16 BANK_address(const BANK_RecordType *record, uint8 bank)
+{
+	return (bank == 0) ? record->addressA : record->addressB;
+}
@@ -0,0 +1,61 @@
+ /******************************************************************************
+ *
+ * Module: BANK
+ *
+ * File Name: dual_bank.h
+ *
+ * Description: Header file for the records kept in two EEPROM banks and updated atomically
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef DUAL_BANK_H_
+#define DUAL_BANK_H_
+
+#include "std_types.h"
+#include "storage.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Every bank is one 16-byte EEPROM page: payload (up to 14 bytes, padded with 0xFF)
+ * sequence crc. A new value is written to the inactive bank with a single page write
+ * (two on the 8-byte page parts, the CRC still covers both), the banks flip once it is
+ * complete: a reset during the write leaves the previous value.
+ */
+#define BANK_PAGE_SIZE             16
+#define BANK_MAX_PAYLOAD           (BANK_PAGE_SIZE - 2)
+#define BANK_SEQUENCE_OFFSET       (BANK_PAGE_SIZE - 2)
+#define BANK_CRC_OFFSET            (BANK_PAGE_SIZE - 1)
+
+/* One per record, owned by the module storing it */
+typedef struct {
+	const STORAGE_BackendType *backend;
+	uint16 addressA;               /* Page aligned */
+	uint16 addressB;               /* Page aligned */
+	uint8 size;                    /* Payload bytes, up to BANK_MAX_PAYLOAD */
+	uint8 active;                  /* Bank holding the current value: 0 (A) or 1 (B) */
+	uint8 sequence;                /* Sequence of the active bank */
+} BANK_RecordType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read both banks (one block read each) and copy the payload of the newest valid one.
+ * Return FALSE if none is valid, the data is then left unchanged.
+ */
+uint8 BANK_load(BANK_RecordType *record, uint8 *data);
+
+/*
+ * Description :
+ * Write a new payload to the inactive bank in one page write, then make it the active one.
+ */
+uint8 BANK_store(BANK_RecordType *record, const uint8 *data);
+
+#endif /* DUAL_BANK_H_ */
@@ -10,74 +10,251 @@
  *
  *******************************************************************************/
 
+#include <util/delay.h>
 #include "external_eeprom.h"
 #include "twi.h"
+#include "trace.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define EEPROM_POLL_PERIOD_US      100     /* Between two acknowledge polls of a write cycle */
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static EEPROM_ConfigType g_eepromConfig = EEPROM_PROFILE_24C16;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint8 EEPROM_deviceAddress(uint16 u16addr);
+static uint8 EEPROM_sendAddress(uint16 u16addr);
+static uint8 EEPROM_isInRange(uint16 u16addr, uint16 u16length);
+static void EEPROM_waitWriteCycle(uint16 u16addr);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void EEPROM_init(const EEPROM_ConfigType *configPtr)
+{
+	g_eepromConfig = *configPtr;
+}
+
+uint32 EEPROM_getCapacity(void)
+{
+	return g_eepromConfig.capacity;
+}
+
+uint8 EEPROM_getPageSize(void)
+{
+	return g_eepromConfig.pageSize;
+}
 
 uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data)
 {
-	/* Send the Start Bit */
+	return EEPROM_writePage(u16addr, &u8data, 1);
+}
+
+uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
+{
+	return EEPROM_readBlock(u16addr, u8data, 1);
+}
+
+/* Sequential read: one addressing phase, then the EEPROM increments the address itself */
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *u8data, uint16 u16length)
+{
+	TRACE_record(TRACE_EVT_EEPROM_READ, u16addr);
+
+	if (u16length == 0)
+		return SUCCESS;
+	if (!EEPROM_isInRange(u16addr, u16length))
+		return ERROR;
+
+	/* Send the Start Bit, the device address with R/W=0 (write) and the memory location address */
+	if (EEPROM_sendAddress(u16addr) == ERROR)
+		return ERROR;
+
+    /* Send the Repeated Start Bit */
     TWI_start();
-    if (TWI_getStatus() != TWI_START)
+    if (TWI_getStatus() != TWI_REP_START)
+    {
+        TWI_stop();
         return ERROR;
+    }
 
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+    /* Send the device address with R/W=1 (Read) */
+    TWI_writeByte((uint8)(EEPROM_deviceAddress(u16addr) | 1));
+    if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
+    {
+        TWI_stop();
         return ERROR;
+    }
 
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
+    /* ACK every byte but the last one, the NACK ends the read */
+    while (u16length > 1)
+    {
+        *u8data = TWI_readByteWithACK();
+        if (TWI_getStatus() != TWI_MR_DATA_ACK)
+        {
+            TWI_stop();
+            return ERROR;
+        }
+        u8data++;
+        u16length--;
+    }
+    *u8data = TWI_readByteWithNACK();
+    if (TWI_getStatus() != TWI_MR_DATA_NACK)
+    {
+        TWI_stop();
         return ERROR;
+    }
 
-    /* write byte to eeprom */
-    TWI_writeByte(u8data);
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
+    /* Send the Stop Bit */
+    TWI_stop();
+
+    return SUCCESS;
+}
+
+/* Page write: up to one page of bytes in a single write cycle, within one page */
+uint8 EEPROM_writePage(uint16 u16addr, const uint8 *u8data, uint8 u8length)
+{
+	if ((u8length == 0) || (((u16addr & (g_eepromConfig.pageSize - 1)) + u8length) > g_eepromConfig.pageSize) ||
+		!EEPROM_isInRange(u16addr, u8length))
+		return ERROR;
+
+	TRACE_record(TRACE_EVT_EEPROM_WRITE, u16addr);
+
+	/* Send the Start Bit, the device address with R/W=0 (write) and the memory location address */
+	if (EEPROM_sendAddress(u16addr) == ERROR)
+		return ERROR;
+
+    /* write the bytes, the EEPROM latches them and programs the page after the stop */
+    while (u8length != 0)
+    {
+        TWI_writeByte(*u8data);
+        if (TWI_getStatus() != TWI_MT_DATA_ACK)
+        {
+            TWI_stop();
+            return ERROR;
+        }
+        u8data++;
+        u8length--;
+    }
 
     /* Send the Stop Bit */
     TWI_stop();
 
+    EEPROM_waitWriteCycle(u16addr);
     return SUCCESS;
 }
 
-uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
+/* Block write: split on the page boundaries, the first page is written last */
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *u8data, uint16 u16length)
+{
+	uint16 pageStart, offset;
+
+	if (!EEPROM_isInRange(u16addr, u16length))
+		return ERROR;
+
+	while (u16length != 0)
+	{
+		/* Start of the last page touched by what is left of the block */
+		pageStart = (u16addr + u16length - 1) & ~(uint16)(g_eepromConfig.pageSize - 1);
+		offset = (pageStart > u16addr) ? (pageStart - u16addr) : 0;
+
+		if (EEPROM_writePage(u16addr + offset, u8data + offset, (uint8)(u16length - offset)) == ERROR)
+			return ERROR;
+		u16length = offset;
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * 24C01..24C16 take the address bits above A7 in the device address, the larger parts the chip select pins only.
+ */
+static uint8 EEPROM_deviceAddress(uint16 u16addr)
+{
+	if (g_eepromConfig.addressing == EEPROM_BLOCK_SELECT_ADDRESS)
+	{
+		return (uint8)(EEPROM_DEVICE_ADDRESS | (g_eepromConfig.chipSelect << 1) | ((u16addr >> 7) & 0x0E));
+	}
+	return (uint8)(EEPROM_DEVICE_ADDRESS | ((g_eepromConfig.chipSelect & 0x07) << 1));
+}
+
+/*
+ * Description :
+ * Start, device address with R/W=0 (write), then one or two memory location address bytes.
+ * Every failure after the start sends a stop, or the next TWI_start() gets a repeated start
+ * (TWI_REP_START) instead of TWI_START and every later access fails; the callers do the same.
+ */
+static uint8 EEPROM_sendAddress(uint16 u16addr)
 {
 	/* Send the Start Bit */
     TWI_start();
     if (TWI_getStatus() != TWI_START)
+    {
+        TWI_stop();
         return ERROR;
+    }
 
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7)));
+    TWI_writeByte(EEPROM_deviceAddress(u16addr));
     if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+    {
+        TWI_stop();
         return ERROR;
+    }
+
+    if (g_eepromConfig.addressing == EEPROM_TWO_BYTES_ADDRESS)
+    {
+        TWI_writeByte((uint8)(u16addr >> 8));
+        if (TWI_getStatus() != TWI_MT_DATA_ACK)
+        {
+            TWI_stop();
+            return ERROR;
+        }
+    }
 
-    /* Send the required memory location address */
     TWI_writeByte((uint8)(u16addr));
     if (TWI_getStatus() != TWI_MT_DATA_ACK)
+    {
+        TWI_stop();
         return ERROR;
+    }
 
-    /* Send the Repeated Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_REP_START)
-        return ERROR;
-
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=1 (Read) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7) | 1));
-    if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
-        return ERROR;
+    return SUCCESS;
+}
 
-    /* Read Byte from Memory without send ACK */
-    *u8data = TWI_readByteWithNACK();
-    if (TWI_getStatus() != TWI_MR_DATA_NACK)
-        return ERROR;
+static uint8 EEPROM_isInRange(uint16 u16addr, uint16 u16length)
+{
+	return ((uint32)u16addr + u16length) <= g_eepromConfig.capacity;
+}
 
-    /* Send the Stop Bit */
-    TWI_stop();
+/*
+ * Description :
+ * Acknowledge polling: the device ignores its address until the write cycle is over,
+ * usually well before the datasheet time which only bounds the wait.
+ */
+static void EEPROM_waitWriteCycle(uint16 u16addr)
+{
+	uint16 polls = (uint16)g_eepromConfig.writeCycleMs * (1000 / EEPROM_POLL_PERIOD_US);
 
-    return SUCCESS;
+	while (polls != 0)
+	{
+		TWI_start();
+		TWI_writeByte(EEPROM_deviceAddress(u16addr));
+		if (TWI_getStatus() == TWI_MT_SLA_W_ACK)
+		{
+			TWI_stop();
+			return;
+		}
+		TWI_stop();
+		_delay_us(EEPROM_POLL_PERIOD_US);
+		polls--;
+	}
 }
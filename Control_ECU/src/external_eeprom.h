@@ -22,11 +22,68 @@
 #define ERROR 0
 #define SUCCESS 1
 
+#define EEPROM_DEVICE_ADDRESS      0xA0    /* 1010 A2 A1 A0 R/W */
+
+/*
+ * Device profiles: { addressing, pageSize, capacity, writeCycleMs, chipSelect }
+ * chipSelect is the A2 A1 A0 pins value, the block select parts use the pins that
+ * are not taken by the address bits only (none on the 24C16).
+ */
+#define EEPROM_PROFILE_24C02       { EEPROM_BLOCK_SELECT_ADDRESS, 8,   256UL,   5,  0 }
+#define EEPROM_PROFILE_24C04       { EEPROM_BLOCK_SELECT_ADDRESS, 16,  512UL,   5,  0 }
+#define EEPROM_PROFILE_24C08       { EEPROM_BLOCK_SELECT_ADDRESS, 16,  1024UL,  5,  0 }
+#define EEPROM_PROFILE_24C16       { EEPROM_BLOCK_SELECT_ADDRESS, 16,  2048UL,  5,  0 }
+#define EEPROM_PROFILE_24C32       { EEPROM_TWO_BYTES_ADDRESS,    32,  4096UL,  5,  0 }
+#define EEPROM_PROFILE_24C64       { EEPROM_TWO_BYTES_ADDRESS,    32,  8192UL,  5,  0 }
+#define EEPROM_PROFILE_24C128      { EEPROM_TWO_BYTES_ADDRESS,    64,  16384UL, 5,  0 }
+#define EEPROM_PROFILE_24C256      { EEPROM_TWO_BYTES_ADDRESS,    64,  32768UL, 5,  0 }
+#define EEPROM_PROFILE_24C512      { EEPROM_TWO_BYTES_ADDRESS,    128, 65536UL, 5,  0 }
+
+typedef enum {
+	EEPROM_BLOCK_SELECT_ADDRESS,   /* 24C01..24C16: A8..A10 in the device address, then one address byte */
+	EEPROM_TWO_BYTES_ADDRESS       /* 24C32..24C512: two address bytes (high first) */
+} EEPROM_AddressingType;
+
+typedef struct {
+	EEPROM_AddressingType addressing;
+	uint8 pageSize;                /* Power of 2, a page write must not cross a page boundary */
+	uint32 capacity;               /* Bytes, up to 64 KB */
+	uint8 writeCycleMs;            /* Longest write cycle of the datasheet */
+	uint8 chipSelect;              /* A2 A1 A0 pins */
+} EEPROM_ConfigType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
+/*
+ * Description :
+ * Select the device profile, the 24C16 one is used until this is called.
+ */
+void EEPROM_init(const EEPROM_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Return the capacity and the page size of the selected device.
+ */
+uint32 EEPROM_getCapacity(void);
+uint8 EEPROM_getPageSize(void);
+
+/*
+ * Description :
+ * Byte and page accesses. The writes return once the write cycle is over (or after
+ * the profile write cycle time if the device never acknowledges again).
+ */
 uint8 EEPROM_writeByte(uint16 u16addr,uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr,uint8 *u8data);
+uint8 EEPROM_readBlock(uint16 u16addr,uint8 *u8data,uint16 u16length);
+uint8 EEPROM_writePage(uint16 u16addr,const uint8 *u8data,uint8 u8length);
+
+/*
+ * Description :
+ * Write any block as page writes, from the last page to the first one: the page
+ * holding u16addr is written last, so a state byte at the start of a record commits it.
+ */
+uint8 EEPROM_writeBlock(uint16 u16addr,const uint8 *u8data,uint16 u16length);
 
 #endif /* EXTERNAL_EEPROM_H_ */
@@ -0,0 +1,288 @@
+ /******************************************************************************
+ *
+ * Module: FLASHLOG
+ *
+ * File Name: flash_log.c
+ *
+ * Description: Source file for the append-only record log kept in unused application flash
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include <avr/boot.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "flash_log.h"
+#include "uart.h"
+#include "gpio.h"     /* To use PIN7_ID (I-bit of SREG) */
+#include "Macros.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static FLASHLOG_ConfigType g_flashLogConfig;
+
+/* Head page being filled, programmed when full or on FLASHLOG_flush */
+static uint8 g_flashLogBuffer[FLASHLOG_PAGE_SIZE];
+static uint8 g_flashLogHead = 0;
+static uint16 g_flashLogSequence = 0;
+static uint8 g_flashLogUsed = 0;             /* Records in the head page */
+static uint8 g_flashLogFullPages = 0;        /* Full pages before the head page */
+static uint8 g_flashLogStarted = FALSE;      /* FALSE while the log is empty */
+static uint8 g_flashLogPending = FALSE;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void FLASHLOG_startPage(void);
+static uint8 FLASHLOG_isErased(const uint8 *record);
+static uint16 FLASHLOG_pageAddress(uint8 page);
+static void FLASHLOG_programPage(uint16 address, const uint8 *data) BOOTLOADER_SECTION;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read the page headers once to find the head page, then copy it in the RAM buffer.
+ */
+void FLASHLOG_init(const FLASHLOG_ConfigType *configPtr)
+{
+	uint8 header[FLASHLOG_HEADER_SIZE];
+	uint16 sequence;
+	uint8 page;
+
+	g_flashLogConfig = *configPtr;
+	g_flashLogStarted = FALSE;
+	g_flashLogPending = FALSE;
+	g_flashLogFullPages = 0;
+
+	/* The head page is the valid page with the highest sequence (modulo 2^16) */
+	for (page = 0; page < g_flashLogConfig.pages; page++)
+	{
+		memcpy_P(header, (const void *)FLASHLOG_pageAddress(page), FLASHLOG_HEADER_SIZE);
+		if (header[2] != FLASHLOG_PAGE_MARKER)
+			continue;
+
+		sequence = header[0] | ((uint16)header[1] << 8);
+		if (!g_flashLogStarted || ((sint16)(sequence - g_flashLogSequence) > 0))
+		{
+			g_flashLogStarted = TRUE;
+			g_flashLogHead = page;
+			g_flashLogSequence = sequence;
+		}
+	}
+	if (!g_flashLogStarted)
+		return;
+
+	/* Every page of the current lap before the head one is full */
+	for (page = 1; page < g_flashLogConfig.pages; page++)
+	{
+		memcpy_P(header, (const void *)FLASHLOG_pageAddress((g_flashLogHead + g_flashLogConfig.pages - page) % g_flashLogConfig.pages),
+				 FLASHLOG_HEADER_SIZE);
+		sequence = header[0] | ((uint16)header[1] << 8);
+		if ((header[2] != FLASHLOG_PAGE_MARKER) || (sequence != (uint16)(g_flashLogSequence - page)))
+			break;
+		g_flashLogFullPages++;
+	}
+
+	memcpy_P(g_flashLogBuffer, (const void *)FLASHLOG_pageAddress(g_flashLogHead), FLASHLOG_PAGE_SIZE);
+	for (g_flashLogUsed = 0; g_flashLogUsed < FLASHLOG_RECORDS_PER_PAGE; g_flashLogUsed++)
+	{
+		if (FLASHLOG_isErased(&g_flashLogBuffer[FLASHLOG_HEADER_SIZE + (g_flashLogUsed * FLASHLOG_RECORD_SIZE)]))
+			break;
+	}
+}
+
+/*
+ * Description :
+ * Append a record to the RAM buffer, the page is programmed once it is full.
+ */
+void FLASHLOG_append(const uint8 *record)
+{
+	if (g_flashLogConfig.pages == 0)
+		return;
+
+	if (!g_flashLogStarted || (g_flashLogUsed == FLASHLOG_RECORDS_PER_PAGE))
+	{
+		FLASHLOG_startPage();
+	}
+
+	memcpy(&g_flashLogBuffer[FLASHLOG_HEADER_SIZE + (g_flashLogUsed * FLASHLOG_RECORD_SIZE)], record, FLASHLOG_RECORD_SIZE);
+	g_flashLogUsed++;
+	g_flashLogPending = TRUE;
+
+	if (g_flashLogUsed == FLASHLOG_RECORDS_PER_PAGE)
+	{
+		FLASHLOG_flush();
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE if the RAM buffer holds records that are not programmed yet.
+ */
+uint8 FLASHLOG_hasPending(void)
+{
+	return g_flashLogPending;
+}
+
+/*
+ * Description :
+ * Program the head page with the RAM buffer. The interrupts are disabled for the erase
+ * and the write (about 9 ms), call it while no UART byte is expected.
+ */
+void FLASHLOG_flush(void)
+{
+	if (!g_flashLogPending)
+		return;
+
+	FLASHLOG_programPage(FLASHLOG_pageAddress(g_flashLogHead), g_flashLogBuffer);
+	g_flashLogPending = FALSE;
+}
+
+uint16 FLASHLOG_getCount(void)
+{
+	return g_flashLogStarted ? (((uint16)g_flashLogFullPages * FLASHLOG_RECORDS_PER_PAGE) + g_flashLogUsed) : 0;
+}
+
+/*
+ * Description :
+ * Read the record at a position (0 = oldest) from flash, or from the RAM buffer for the head page.
+ */
+uint8 FLASHLOG_read(uint16 position, uint8 *record)
+{
+	uint8 page, slot;
+
+	if (position >= FLASHLOG_getCount())
+		return FALSE;
+
+	page = (uint8)((g_flashLogHead + g_flashLogConfig.pages - g_flashLogFullPages + (position / FLASHLOG_RECORDS_PER_PAGE))
+				   % g_flashLogConfig.pages);
+	slot = (uint8)(position % FLASHLOG_RECORDS_PER_PAGE);
+
+	if (page == g_flashLogHead)
+	{
+		memcpy(record, &g_flashLogBuffer[FLASHLOG_HEADER_SIZE + (slot * FLASHLOG_RECORD_SIZE)], FLASHLOG_RECORD_SIZE);
+	}
+	else
+	{
+		memcpy_P(record, (const void *)(FLASHLOG_pageAddress(page) + FLASHLOG_HEADER_SIZE + (slot * FLASHLOG_RECORD_SIZE)),
+				 FLASHLOG_RECORD_SIZE);
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Send up to FLASHLOG_QUERY_MAX records from a position through UART:
+ * 'F' 'L' total(2, low first) count record(8) ...
+ */
+void FLASHLOG_sendRecords(uint16 position)
+{
+	uint8 record[FLASHLOG_RECORD_SIZE];
+	uint16 total = FLASHLOG_getCount();
+	uint8 count = 0;
+	uint8 i;
+
+	if (position < total)
+	{
+		count = (total - position < FLASHLOG_QUERY_MAX) ? (uint8)(total - position) : FLASHLOG_QUERY_MAX;
+	}
+
+	UART_sendByte(FLASHLOG_REPORT_SYNC1);
+	UART_sendByte(FLASHLOG_REPORT_SYNC2);
+	UART_sendByte((uint8)total);
+	UART_sendByte((uint8)(total >> 8));
+	UART_sendByte(count);
+	while (count != 0)
+	{
+		FLASHLOG_read(position, record);
+		for (i = 0; i < FLASHLOG_RECORD_SIZE; i++)
+		{
+			UART_sendByte(record[i]);
+		}
+		position++;
+		count--;
+	}
+}
+
+/*
+ * Description :
+ * Move the head to the next page of the ring, its old records are dropped from the count
+ * now and erased when it is programmed.
+ */
+static void FLASHLOG_startPage(void)
+{
+	if (g_flashLogStarted)
+	{
+		FLASHLOG_flush();
+		g_flashLogHead = (g_flashLogHead + 1) % g_flashLogConfig.pages;
+		if (g_flashLogFullPages < (g_flashLogConfig.pages - 1))
+		{
+			g_flashLogFullPages++;
+		}
+	}
+	else
+	{
+		g_flashLogHead = 0;
+	}
+	g_flashLogSequence++;
+	g_flashLogStarted = TRUE;
+	g_flashLogUsed = 0;
+
+	memset(g_flashLogBuffer, 0xFF, FLASHLOG_PAGE_SIZE);
+	g_flashLogBuffer[0] = (uint8)g_flashLogSequence;
+	g_flashLogBuffer[1] = (uint8)(g_flashLogSequence >> 8);
+	g_flashLogBuffer[2] = FLASHLOG_PAGE_MARKER;
+}
+
+static uint8 FLASHLOG_isErased(const uint8 *record)
+{
+	uint8 i;
+
+	for (i = 0; i < FLASHLOG_RECORD_SIZE; i++)
+	{
+		if (record[i] != 0xFF)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static uint16 FLASHLOG_pageAddress(uint8 page)
+{
+	return (uint16)g_flashLogConfig.region + ((uint16)page * FLASHLOG_PAGE_SIZE);
+}
+
+/*
+ * Description :
+ * Erase and write one page. Runs from the boot loader section (linked at 0x7000, the
+ * 2048-word boot section of the default BOOTSZ fuses) with the interrupts disabled: the
+ * vectors and the rest of the code are in the RWW section, unreadable until the end.
+ * It must not call any function.
+ */
+static void FLASHLOG_programPage(uint16 address, const uint8 *data)
+{
+	uint8 sreg = SREG;
+	uint8 i;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	while (BIT_IS_SET(EECR, EEWE));       /* An EEPROM write blocks SPM */
+
+	boot_page_erase(address);
+	boot_spm_busy_wait();
+	for (i = 0; i < FLASHLOG_PAGE_SIZE; i += 2)
+	{
+		boot_page_fill(address + i, data[i] | ((uint16)data[i + 1] << 8));
+	}
+	boot_page_write(address);
+	boot_spm_busy_wait();
+	boot_rww_enable();
+
+	SREG = sreg;
+}
@@ -0,0 +1,95 @@
+ /******************************************************************************
+ *
+ * Module: FLASHLOG
+ *
+ * File Name: flash_log.h
+ *
+ * Description: Header file for the append-only record log kept in unused application flash
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef FLASH_LOG_H_
+#define FLASH_LOG_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * The log is a ring of 128-byte flash pages: header sequence(2) marker then 5 bytes 0xFF,
+ * and 15 records of 8 bytes. The head page is built in RAM and programmed with SPM
+ * (erase then write) by a helper placed in the boot loader section, which is the only
+ * one allowed to run SPM. A record must never be all 0xFF (erased flash).
+ */
+#define FLASHLOG_PAGE_SIZE         128       /* SPM_PAGESIZE of the ATmega32 */
+#define FLASHLOG_HEADER_SIZE       8
+#define FLASHLOG_RECORD_SIZE       8
+#define FLASHLOG_RECORDS_PER_PAGE  ((FLASHLOG_PAGE_SIZE - FLASHLOG_HEADER_SIZE) / FLASHLOG_RECORD_SIZE)
+#define FLASHLOG_PAGE_MARKER       0x4C
+#define FLASHLOG_QUERY_MAX         8         /* Records sent per FLASHLOG_sendRecords */
+
+/* Sync bytes that start the query answer sent over the UART */
+#define FLASHLOG_REPORT_SYNC1      'F'
+#define FLASHLOG_REPORT_SYNC2      'L'
+
+/*
+ * Reserve the region in the application image, so the linker fails instead of placing
+ * code over it: erased records, page aligned, read with the pgmspace functions.
+ */
+#define FLASHLOG_REGION(name, pages) \
+	const uint8 name[(pages) * FLASHLOG_PAGE_SIZE] PROGMEM __attribute__((aligned(FLASHLOG_PAGE_SIZE))) = \
+		{ [0 ... ((pages) * FLASHLOG_PAGE_SIZE) - 1] = 0xFF }
+
+typedef struct {
+	const uint8 *region;           /* FLASHLOG_REGION array */
+	uint8 pages;                   /* Region size in FLASHLOG_PAGE_SIZE pages */
+} FLASHLOG_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read the page headers once to find the head page, then copy it in the RAM buffer.
+ */
+void FLASHLOG_init(const FLASHLOG_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Append a record to the RAM buffer, the page is programmed once it is full.
+ */
+void FLASHLOG_append(const uint8 *record);
+
+/*
+ * Description :
+ * Return TRUE if the RAM buffer holds records that are not programmed yet.
+ */
+uint8 FLASHLOG_hasPending(void);
+
+/*
+ * Description :
+ * Program the head page with the RAM buffer. The interrupts are disabled for the erase
+ * and the write (about 9 ms), call it while no UART byte is expected.
+ */
+void FLASHLOG_flush(void);
+
+/*
+ * Description :
+ * Number of records in the log, and the record at a position (0 = oldest, FALSE if there is no such record).
+ */
+uint16 FLASHLOG_getCount(void);
+uint8 FLASHLOG_read(uint16 position, uint8 *record);
+
+/*
+ * Description :
+ * Send up to FLASHLOG_QUERY_MAX records from a position through UART:
+ * 'F' 'L' total(2, low first) count record(8) ...
+ */
+void FLASHLOG_sendRecords(uint16 position);
+
+#endif /* FLASH_LOG_H_ */
@@ -0,0 +1,229 @@
+ /******************************************************************************
+ *
+ * Module: HB
+ *
+ * File Name: heartbeat.c
+ *
+ * Description: Source file for the link heartbeat and its round-trip time statistics
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include "heartbeat.h"
+#include "link.h"
+#include "trace.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static HB_ConfigType g_hbConfig;
+
+static uint32 g_hbLastPing = 0;            /* Microseconds (TRACE_getMicroseconds) */
+static uint32 g_hbLastSeen = 0;
+static uint8 g_hbPeerUp = TRUE;
+static uint8 g_hbReportedUp = TRUE;        /* Peer state of the last HB_service event */
+
+/* Statistics in HB_RTT_UNIT_US, the average and the jitter are smoothed like TCP and RTP */
+static uint16 g_hbSamples = 0;
+static uint16 g_hbMinRtt = 0xFFFF;
+static uint16 g_hbMaxRtt = 0;
+static uint32 g_hbAverage8 = 0;            /* Average * 8, gain 1/8 */
+static uint32 g_hbJitter16 = 0;            /* Mean deviation * 16, gain 1/16 */
+static uint16 g_hbHistory[HB_HISTORY_SIZE];
+static uint8 g_hbHistoryIndex = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void HB_sendTimestamp(uint8 type, uint32 timestamp);
+static void HB_addSample(uint16 rtt);
+static void HB_sendWord(uint16 value);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Clear the statistics. The peer is taken as up for one timeout, so a peer that never
+ * answers after the boot is reported down like one that stopped answering.
+ */
+void HB_init(const HB_ConfigType *configPtr)
+{
+	g_hbConfig = *configPtr;
+
+	g_hbLastPing = TRACE_getMicroseconds();
+	g_hbLastSeen = g_hbLastPing;
+	g_hbPeerUp = TRUE;
+	g_hbReportedUp = TRUE;
+	g_hbSamples = 0;
+	g_hbMinRtt = 0xFFFF;
+	g_hbMaxRtt = 0;
+	g_hbAverage8 = 0;
+	g_hbJitter16 = 0;
+	g_hbHistoryIndex = 0;
+}
+
+/*
+ * Description :
+ * Send a ping once the period is over (while a session is established) and check the
+ * timeout. Return the change of the peer state since the last call, if any.
+ */
+HB_EventType HB_service(void)
+{
+	uint32 now = TRACE_getMicroseconds();
+
+	if (g_hbPeerUp && ((now - g_hbLastSeen) >= ((uint32)g_hbConfig.timeout * 1000)))
+	{
+		g_hbPeerUp = FALSE;
+	}
+
+	if ((now - g_hbLastPing) >= ((uint32)g_hbConfig.period * 1000))
+	{
+		g_hbLastPing = now;
+		if (LINK_isConnected())
+		{
+			HB_sendTimestamp(HB_PING_MESSAGE, now);
+		}
+	}
+
+	if (g_hbPeerUp != g_hbReportedUp)
+	{
+		g_hbReportedUp = g_hbPeerUp;
+		return g_hbPeerUp ? HB_EVENT_PEER_UP : HB_EVENT_PEER_DOWN;
+	}
+	return HB_EVENT_NONE;
+}
+
+/*
+ * Description :
+ * Called for every message received through the link: any of them shows the peer is
+ * alive. Answer a ping, measure a pong, return TRUE if the message was one of them.
+ */
+uint8 HB_handleMessage(const uint8 *message, uint8 length)
+{
+	uint32 now = TRACE_getMicroseconds();
+	uint32 timestamp;
+
+	g_hbLastSeen = now;
+	g_hbPeerUp = TRUE;
+
+	if ((length != HB_MESSAGE_LENGTH) || ((message[0] != HB_PING_MESSAGE) && (message[0] != HB_PONG_MESSAGE)))
+		return FALSE;
+
+	timestamp = message[1] | ((uint16)message[2] << 8) | ((uint32)message[3] << 16) | ((uint32)message[4] << 24);
+	if (message[0] == HB_PING_MESSAGE)
+	{
+		HB_sendTimestamp(HB_PONG_MESSAGE, timestamp);
+	}
+	else if ((now - timestamp) < ((uint32)g_hbConfig.timeout * 1000))
+	{
+		/* A pong older than the timeout (sent before a reset of this ECU) is not measured */
+		timestamp = (now - timestamp) / HB_RTT_UNIT_US;
+		HB_addSample((timestamp > 0xFFFF) ? 0xFFFF : (uint16)timestamp);
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * The peer is known not to read the link for now (door moving): no ping is sent and
+ * the timeout starts again, call it as long as it lasts.
+ */
+void HB_hold(void)
+{
+	g_hbLastPing = TRACE_getMicroseconds();
+	g_hbLastSeen = g_hbLastPing;
+}
+
+uint8 HB_isPeerUp(void)
+{
+	return g_hbPeerUp;
+}
+
+/*
+ * Description :
+ * Send the statistics through UART, all values little-endian, RTTs in HB_RTT_UNIT_US:
+ * 'H' 'T' peerUp samples(2) min(2) avg(2) max(2) jitter(2) count history(count*2, oldest first)
+ */
+void HB_sendReport(void)
+{
+	uint8 count = (g_hbSamples < HB_HISTORY_SIZE) ? (uint8)g_hbSamples : HB_HISTORY_SIZE;
+	uint8 i;
+
+	UART_sendByte(HB_REPORT_SYNC1);
+	UART_sendByte(HB_REPORT_SYNC2);
+	UART_sendByte(g_hbPeerUp);
+	HB_sendWord(g_hbSamples);
+	HB_sendWord((g_hbSamples != 0) ? g_hbMinRtt : 0);
+	HB_sendWord((uint16)(g_hbAverage8 / 8));
+	HB_sendWord(g_hbMaxRtt);
+	HB_sendWord((uint16)(g_hbJitter16 / 16));
+	UART_sendByte(count);
+	for (i = 0; i < count; i++)
+	{
+		HB_sendWord(g_hbHistory[(g_hbHistoryIndex + HB_HISTORY_SIZE - count + i) % HB_HISTORY_SIZE]);
+	}
+}
+
+static void HB_sendTimestamp(uint8 type, uint32 timestamp)
+{
+	uint8 message[HB_MESSAGE_LENGTH];
+
+	message[0] = type;
+	message[1] = (uint8)timestamp;
+	message[2] = (uint8)(timestamp >> 8);
+	message[3] = (uint8)(timestamp >> 16);
+	message[4] = (uint8)(timestamp >> 24);
+	(void)LINK_sendMessage(message, HB_MESSAGE_LENGTH);
+}
+
+/*
+ * Description :
+ * Add an RTT to the history and to the statistics, the first one seeds the average.
+ */
+static void HB_addSample(uint16 rtt)
+{
+	uint16 average;
+	uint16 deviation;
+
+	if (g_hbSamples == 0)
+	{
+		g_hbAverage8 = (uint32)rtt * 8;
+		g_hbJitter16 = 0;
+	}
+	else
+	{
+		/* Deviation from the average before this sample (RFC 3550 interarrival jitter) */
+		average = (uint16)(g_hbAverage8 / 8);
+		deviation = (rtt > average) ? (rtt - average) : (average - rtt);
+		g_hbJitter16 = g_hbJitter16 + deviation - (g_hbJitter16 / 16);
+		g_hbAverage8 = g_hbAverage8 + rtt - (g_hbAverage8 / 8);
+	}
+
+	if (g_hbSamples != 0xFFFF)
+	{
+		g_hbSamples++;
+	}
+	if (rtt < g_hbMinRtt)
+	{
+		g_hbMinRtt = rtt;
+	}
+	if (rtt > g_hbMaxRtt)
+	{
+		g_hbMaxRtt = rtt;
+	}
+
+	g_hbHistory[g_hbHistoryIndex] = rtt;
+	g_hbHistoryIndex = (g_hbHistoryIndex + 1) % HB_HISTORY_SIZE;
+}
+
+static void HB_sendWord(uint16 value)
+{
+	UART_sendByte((uint8)value);
+	UART_sendByte((uint8)(value >> 8));
+}
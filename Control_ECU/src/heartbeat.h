@@ -0,0 +1,93 @@
+ /******************************************************************************
+ *
+ * Module: HB
+ *
+ * File Name: heartbeat.h
+ *
+ * Description: Header file for the link heartbeat and its round-trip time statistics
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef HEARTBEAT_H_
+#define HEARTBEAT_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Link messages (first byte) of the heartbeat, both ECUs ping and answer:
+ * PING timestamp(4, low first), PONG echoes it, so the RTT needs no state per ping.
+ */
+#define HB_PING_MESSAGE            0x13
+#define HB_PONG_MESSAGE            0x14
+#define HB_MESSAGE_LENGTH          5
+
+#define HB_RTT_UNIT_US             100       /* RTT values are kept and reported in 0.1 ms */
+#define HB_HISTORY_SIZE            16        /* Last RTTs reported to the diagnostics tool */
+
+/* Sync bytes that start the report sent over the UART */
+#define HB_REPORT_SYNC1            'H'
+#define HB_REPORT_SYNC2            'T'
+
+typedef enum {
+	HB_EVENT_NONE,
+	HB_EVENT_PEER_UP,          /* A message arrived after the peer was down */
+	HB_EVENT_PEER_DOWN         /* Nothing arrived for the timeout           */
+} HB_EventType;
+
+typedef struct {
+	uint16 period;             /* Milliseconds between two pings                  */
+	uint16 timeout;            /* Milliseconds without any message before it is down */
+} HB_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Clear the statistics. The peer is taken as up for one timeout, so a peer that never
+ * answers after the boot is reported down like one that stopped answering.
+ */
+void HB_init(const HB_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Send a ping once the period is over (while a session is established) and check the
+ * timeout. Return the change of the peer state since the last call, if any.
+ */
+HB_EventType HB_service(void);
+
+/*
+ * Description :
+ * Called for every message received through the link: any of them shows the peer is
+ * alive. Answer a ping, measure a pong, return TRUE if the message was one of them.
+ */
+uint8 HB_handleMessage(const uint8 *message, uint8 length);
+
+/*
+ * Description :
+ * The peer is known not to read the link for now (door moving): no ping is sent and
+ * the timeout starts again, call it as long as it lasts.
+ */
+void HB_hold(void);
+
+/*
+ * Description :
+ * Return TRUE while the peer is up.
+ */
+uint8 HB_isPeerUp(void);
+
+/*
+ * Description :
+ * Send the statistics through UART, all values little-endian, RTTs in HB_RTT_UNIT_US:
+ * 'H' 'T' peerUp samples(2) min(2) avg(2) max(2) jitter(2) count history(count*2, oldest first)
+ */
+void HB_sendReport(void);
+
+#endif /* HEARTBEAT_H_ */
@@ -0,0 +1,171 @@
+ /******************************************************************************
+ *
+ * Module: Internal EEPROM
+ *
+ * File Name: internal_eeprom.c
+ *
+ * Description: Source file for the ATmega32 internal EEPROM with interrupt driven writes
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include "internal_eeprom.h"
+#include "external_eeprom.h"   /* To use SUCCESS and ERROR */
+#include "gpio.h"              /* To use PIN7_ID (I-bit of SREG) */
+#include "Macros.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+/* Write queue: contiguous bytes from g_ieepromAddress, emptied by the EE_RDY ISR */
+static volatile uint8 g_ieepromQueue[IEEPROM_QUEUE_SIZE];
+static volatile uint16 g_ieepromAddress = 0;
+static volatile uint8 g_ieepromHead = 0;
+static volatile uint8 g_ieepromCount = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint8 IEEPROM_isQueued(uint16 u16addr, uint16 u16length);
+
+/*******************************************************************************
+ *                           INTERRUPT SERVICE ROUTINE                         *
+ *******************************************************************************/
+
+/*
+ * Runs every time the EEPROM is ready: start the next byte that differs from the
+ * EEPROM content, or disable the interrupt once the queue is empty.
+ */
+ISR(EE_RDY_vect)
+{
+	uint16 address;
+	uint8 data;
+
+	while (g_ieepromCount != 0)
+	{
+		address = g_ieepromAddress;
+		data = g_ieepromQueue[g_ieepromHead];
+		EEAR = address;
+		SET_BIT(EECR, EERE);
+
+		g_ieepromAddress++;
+		g_ieepromHead++;
+		g_ieepromCount--;
+
+		if (EEDR != data)
+		{
+			/* EEWE must follow EEMWE within 4 cycles: avr-libc starts the write with a fixed
+			 * sbi/sbi sequence, two SET_BIT read-modify-writes miss it when not optimized */
+			eeprom_write_byte((uint8_t *)address, data);
+			return;
+		}
+	}
+	CLEAR_BIT(EECR, EERIE);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read a block, a few cycles per byte without any bus transaction. Waits only for the
+ * queued writes of the same bytes, so a read always returns the last written data.
+ */
+uint8 IEEPROM_readBlock(uint16 u16addr, uint8 *u8data, uint16 u16length)
+{
+	uint8 sreg;
+
+	if (((uint32)u16addr + u16length) > IEEPROM_SIZE)
+		return ERROR;
+
+	while (IEEPROM_isQueued(u16addr, u16length));
+
+	while (u16length != 0)
+	{
+		/* The ISR must not start a write between the wait and the read */
+		sreg = SREG;
+		CLEAR_BIT(SREG, PIN7_ID);
+		while (BIT_IS_SET(EECR, EEWE));
+		EEAR = u16addr;
+		SET_BIT(EECR, EERE);
+		*u8data = EEDR;
+		SREG = sreg;
+
+		u16addr++;
+		u8data++;
+		u16length--;
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Queue a block and return at once, the EE_RDY ISR writes one byte per write cycle (8.5 ms)
+ * and skips the bytes that already hold their value. Waits only while the queue is busy
+ * with another block. Needs the global interrupts enabled.
+ */
+uint8 IEEPROM_writeBlock(uint16 u16addr, const uint8 *u8data, uint16 u16length)
+{
+	uint8 chunk, i;
+
+	if (((uint32)u16addr + u16length) > IEEPROM_SIZE)
+		return ERROR;
+
+	while (u16length != 0)
+	{
+		while (IEEPROM_isBusy());
+
+		chunk = (u16length > IEEPROM_QUEUE_SIZE) ? IEEPROM_QUEUE_SIZE : (uint8)u16length;
+		for (i = 0; i < chunk; i++)
+		{
+			g_ieepromQueue[i] = u8data[i];
+		}
+		g_ieepromAddress = u16addr;
+		g_ieepromHead = 0;
+		g_ieepromCount = chunk;
+		SET_BIT(EECR, EERIE);
+
+		u16addr += chunk;
+		u8data += chunk;
+		u16length -= chunk;
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Return TRUE while queued bytes are not written yet.
+ */
+uint8 IEEPROM_isBusy(void)
+{
+	return (g_ieepromCount != 0) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Return once every queued byte is written, for a record that must survive a reset.
+ */
+void IEEPROM_waitWrites(void)
+{
+	while (IEEPROM_isBusy());
+	while (BIT_IS_SET(EECR, EEWE));     /* The last byte is dequeued when its write starts */
+}
+
+static uint8 IEEPROM_isQueued(uint16 u16addr, uint16 u16length)
+{
+	uint8 sreg = SREG;
+	uint8 queued;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	queued = (g_ieepromCount != 0) && (u16addr < (g_ieepromAddress + g_ieepromCount)) &&
+			 (g_ieepromAddress < (u16addr + u16length));
+	SREG = sreg;
+	return queued;
+}
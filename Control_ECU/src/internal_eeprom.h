@@ -0,0 +1,56 @@
+ /******************************************************************************
+ *
+ * Module: Internal EEPROM
+ *
+ * File Name: internal_eeprom.h
+ *
+ * Description: Header file for the ATmega32 internal EEPROM with interrupt driven writes
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef INTERNAL_EEPROM_H_
+#define INTERNAL_EEPROM_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define IEEPROM_SIZE               1024      /* ATmega32 */
+#define IEEPROM_QUEUE_SIZE         32        /* Bytes waiting for the EE_RDY interrupt, a larger block waits for room */
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read a block, a few cycles per byte without any bus transaction. Waits only for the
+ * queued writes of the same bytes, so a read always returns the last written data.
+ */
+uint8 IEEPROM_readBlock(uint16 u16addr, uint8 *u8data, uint16 u16length);
+
+/*
+ * Description :
+ * Queue a block and return at once, the EE_RDY ISR writes one byte per write cycle (8.5 ms)
+ * and skips the bytes that already hold their value. Waits only while the queue is busy
+ * with another block. Needs the global interrupts enabled.
+ */
+uint8 IEEPROM_writeBlock(uint16 u16addr, const uint8 *u8data, uint16 u16length);
+
+/*
+ * Description :
+ * Return TRUE while queued bytes are not written yet.
+ */
+uint8 IEEPROM_isBusy(void);
+
+/*
+ * Description :
+ * Return once every queued byte is written, for a record that must survive a reset.
+ */
+void IEEPROM_waitWrites(void);
+
+#endif /* INTERNAL_EEPROM_H_ */
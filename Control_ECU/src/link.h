@@ -0,0 +1,143 @@
+ /******************************************************************************
+ *
+ * Module: LINK
+ *
+ * File Name: link.h
+ *
+ * Description: Header file for the authenticated and encrypted HMI <-> Control session layer
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef LINK_H_
+#define LINK_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Key shared by the two ECUs, only used to authenticate the nonce exchange and to
+ * derive the session keys. Every product build must provision its own key with
+ * -DLINK_MASTER_KEY="{ 0x.., ... }", this one is for development boards only.
+ */
+#ifndef LINK_MASTER_KEY
+#define LINK_MASTER_KEY            { 0x4D, 0x6F, 0x73, 0x74, 0x61, 0x66, 0x61, 0x2D, \
+                                     0x44, 0x6F, 0x6F, 0x72, 0x4C, 0x6F, 0x63, 0x6B }
+#endif
+
+/* Frame: SOF length type counter(2, low first) payload(length) tag(4) */
+#define LINK_SOF                   0x7E
+#define LINK_HEADER_SIZE           4
+#define LINK_TAG_SIZE              4         /* Truncated CMAC, a forgery has a 1 in 2^32 chance */
+#define LINK_MAX_PAYLOAD           24
+#define LINK_NONCE_SIZE            8
+
+/* Sync bytes that start the benchmark report sent over the UART */
+#define LINK_REPORT_SYNC1          'L'
+#define LINK_REPORT_SYNC2          'B'
+
+/* Sync bytes that start the challenge sent to the provisioning tool, followed by LINK_NONCE_SIZE bytes */
+#define LINK_CHALLENGE_SYNC1       'L'
+#define LINK_CHALLENGE_SYNC2       'C'
+#define LINK_TOOL_DATA_MAX         8         /* Longest data authenticated by LINK_isToolTagValid */
+
+typedef enum {
+	LINK_FRAME_DATA = 1,       /* Encrypted and authenticated with the session keys            */
+	LINK_FRAME_HELLO,          /* Initiator nonce, authenticated with the master key           */
+	LINK_FRAME_HELLO_ACK,      /* Responder nonce, authenticated with the master key           */
+	LINK_FRAME_REKEY           /* Responder nonce, it was reset: asks for a new HELLO          */
+} LINK_FrameType;
+
+typedef enum {
+	LINK_ROLE_INITIATOR,       /* Starts the nonce exchange (HMI ECU)     */
+	LINK_ROLE_RESPONDER        /* Answers the nonce exchange (Control ECU) */
+} LINK_RoleType;
+
+typedef enum {
+	LINK_RX_NONE,              /* Byte consumed, nothing to report                   */
+	LINK_RX_RAW,               /* Byte received outside any frame (diagnostics tool) */
+	LINK_RX_MESSAGE,           /* A valid message is available from LINK_getMessage  */
+	LINK_RX_CONNECTED          /* A new session was established                      */
+} LINK_RxEventType;
+
+typedef struct {
+	LINK_RoleType role;
+	uint16 nonceEepromAddress;         /* 4 bytes of the internal EEPROM holding the boot counter */
+} LINK_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Increment the boot counter kept in the internal EEPROM (it makes every nonce of
+ * this boot unique) and reset the session.
+ */
+void LINK_init(const LINK_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Initiator: send a HELLO with a new nonce. Responder: send a REKEY so that the
+ * initiator starts a new session (used at boot).
+ */
+void LINK_connect(void);
+
+/*
+ * Description :
+ * Return TRUE while a session is established.
+ */
+uint8 LINK_isConnected(void);
+
+/*
+ * Description :
+ * Feed one byte received by the UART, frames are checked and decrypted once complete.
+ * Old, replayed, reflected or forged frames are dropped.
+ */
+LINK_RxEventType LINK_receiveByte(uint8 data);
+
+/*
+ * Description :
+ * Drop the frame being received after a line error, the next byte hunts for a SOF again.
+ */
+void LINK_resync(void);
+
+/*
+ * Description :
+ * Return the payload of the last message (valid until the next LINK_receiveByte) and its length.
+ */
+const uint8* LINK_getMessage(uint8 *length);
+
+/*
+ * Description :
+ * Encrypt, authenticate and send a message, return FALSE if there is no session.
+ */
+uint8 LINK_sendMessage(const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Send a fresh challenge in clear through UART for a provisioning tool request that
+ * arrives outside the session: 'L' 'C' challenge(8).
+ */
+void LINK_sendToolChallenge(void);
+
+/*
+ * Description :
+ * Check the answer of the provisioning tool: tag = CMAC(master key, 2 || challenge || data)
+ * truncated to LINK_TAG_SIZE. The challenge is used once, so an answer cannot be replayed.
+ */
+uint8 LINK_isToolTagValid(const uint8 *data, uint8 length, const uint8 *tag);
+
+/*
+ * Description :
+ * Measure the cipher and send the report through UART, all values are little-endian
+ * microseconds: 'L' 'B' blockTime(2) sealTime(2) openTime(2)
+ * where seal/open is the cost of a frame with the largest payload.
+ */
+void LINK_sendBenchmark(void);
+
+#endif /* LINK_H_ */
@@ -0,0 +1,207 @@
+ /******************************************************************************
+ *
+ * Module: LOCKOUT
+ *
+ * File Name: lockout.c
+ *
+ * Description: Source file for the wrong password lockout policy with exponential backoff
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include "lockout.h"
+#include "external_eeprom.h"   /* To use SUCCESS and ERROR */
+#include "gpio.h"
+#include "crc.h"
+#include "Macros.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static LOCKOUT_ConfigType g_lockoutConfig;
+static uint8 g_lockoutFailures = 0;              /* Consecutive wrong attempts */
+static uint8 g_lockoutSlot = LOCKOUT_SLOTS - 1;  /* Slot holding the latest counter value */
+static uint16 g_lockoutSequence = 0;             /* Sequence number of that slot */
+static volatile uint16 g_lockoutRemaining = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void LOCKOUT_save(void);
+static uint16 LOCKOUT_period(void);
+static void LOCKOUT_setRemaining(uint16 seconds);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Load the consecutive failures counter from EEPROM. If the ECU was reset while
+ * locked out, the lockout of the current level starts over, so a power cycle
+ * can never shorten it.
+ */
+void LOCKOUT_init(const LOCKOUT_ConfigType *configPtr)
+{
+	uint8 slotData[LOCKOUT_SLOT_SIZE];
+	uint8 slot;
+	uint16 sequence;
+	uint8 found = FALSE;
+
+	g_lockoutConfig = *configPtr;
+
+	/* The latest value is the valid slot with the highest sequence number (modulo 2^16) */
+	for (slot = 0; slot < LOCKOUT_SLOTS; slot++)
+	{
+		if (g_lockoutConfig.backend->readBlock(g_lockoutConfig.eepromAddress + (slot * LOCKOUT_SLOT_SIZE),
+											   slotData, LOCKOUT_SLOT_SIZE) == ERROR)
+		{
+			continue;
+		}
+
+		/* The CRC-8 of an erased (0xFF) slot is 0x0F, so an erased slot never validates */
+		if (slotData[3] != CRC_block8(CRC8_INIT, slotData, 3))
+			continue;       /* Erased, or the write was interrupted by a reset */
+
+		sequence = ((uint16)slotData[1] << 8) | slotData[0];
+
+		if (!found || ((sint16)(sequence - g_lockoutSequence) > 0))
+		{
+			found = TRUE;
+			g_lockoutSlot = slot;
+			g_lockoutSequence = sequence;
+			g_lockoutFailures = slotData[2];
+		}
+	}
+
+	LOCKOUT_setRemaining(LOCKOUT_period());
+}
+
+/*
+ * Description :
+ * Change the policy (attempts, period, doublings) at runtime, the failures counter
+ * and a running lockout are kept. The EEPROM address cannot change.
+ */
+void LOCKOUT_setPolicy(uint8 freeAttempts, uint16 basePeriod, uint8 maxDoublings)
+{
+	g_lockoutConfig.freeAttempts = freeAttempts;
+	g_lockoutConfig.basePeriod = basePeriod;
+	g_lockoutConfig.maxDoublings = maxDoublings;
+}
+
+/*
+ * Description :
+ * Count a wrong password and persist it, return the lockout period started by
+ * this failure in seconds (0 if the user may try again at once).
+ */
+uint16 LOCKOUT_registerFailure(void)
+{
+	uint16 period;
+
+	if (g_lockoutFailures < 0xFF)
+	{
+		g_lockoutFailures++;
+	}
+	LOCKOUT_save();
+	g_lockoutConfig.backend->waitWrites();    /* Stored before the answer, cutting the power then cannot undo it */
+
+	period = LOCKOUT_period();
+	LOCKOUT_setRemaining(period);
+	return period;
+}
+
+/*
+ * Description :
+ * Clear the failures counter after a correct password (only written if it was not already 0).
+ */
+void LOCKOUT_registerSuccess(void)
+{
+	if (g_lockoutFailures != 0)
+	{
+		g_lockoutFailures = 0;
+		LOCKOUT_save();
+	}
+}
+
+/*
+ * Description :
+ * Return the seconds left in the current lockout, 0 if not locked out.
+ */
+uint16 LOCKOUT_getRemaining(void)
+{
+	uint8 sreg = SREG;
+	uint16 remaining;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	remaining = g_lockoutRemaining;
+	SREG = sreg;
+
+	return remaining;
+}
+
+/*
+ * Description :
+ * Count down the current lockout, must be called every second from the timer ISR.
+ */
+void LOCKOUT_tick(void)
+{
+	if (g_lockoutRemaining != 0)
+	{
+		g_lockoutRemaining--;
+	}
+}
+
+/*
+ * Description :
+ * Write the counter to the slot after the latest one, the previous slot stays
+ * valid until the new one is completely written.
+ */
+static void LOCKOUT_save(void)
+{
+	uint8 slotData[LOCKOUT_SLOT_SIZE];
+	uint16 address;
+
+	g_lockoutSlot = (g_lockoutSlot + 1) % LOCKOUT_SLOTS;
+	g_lockoutSequence++;
+
+	slotData[0] = (uint8)g_lockoutSequence;
+	slotData[1] = (uint8)(g_lockoutSequence >> 8);
+	slotData[2] = g_lockoutFailures;
+	slotData[3] = CRC_block8(CRC8_INIT, slotData, 3);
+
+	address = g_lockoutConfig.eepromAddress + (g_lockoutSlot * LOCKOUT_SLOT_SIZE);
+	g_lockoutConfig.backend->writeBlock(address, slotData, LOCKOUT_SLOT_SIZE);
+}
+
+/*
+ * Description :
+ * Lockout period of the current failures count: none before freeAttempts failures,
+ * then basePeriod doubled for every failure after it up to maxDoublings times.
+ */
+static uint16 LOCKOUT_period(void)
+{
+	uint8 doublings;
+
+	if (g_lockoutFailures < g_lockoutConfig.freeAttempts)
+		return 0;
+
+	doublings = g_lockoutFailures - g_lockoutConfig.freeAttempts;
+	if (doublings > g_lockoutConfig.maxDoublings)
+	{
+		doublings = g_lockoutConfig.maxDoublings;
+	}
+	return g_lockoutConfig.basePeriod << doublings;
+}
+
+static void LOCKOUT_setRemaining(uint16 seconds)
+{
+	uint8 sreg = SREG;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	g_lockoutRemaining = seconds;
+	SREG = sreg;
+}
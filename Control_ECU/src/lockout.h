@@ -0,0 +1,79 @@
+ /******************************************************************************
+ *
+ * Module: LOCKOUT
+ *
+ * File Name: lockout.h
+ *
+ * Description: Header file for the wrong password lockout policy with exponential backoff
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef LOCKOUT_H_
+#define LOCKOUT_H_
+
+#include "std_types.h"
+#include "storage.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Number of EEPROM slots the failures counter rotates over (each write goes to the next slot) */
+#define LOCKOUT_SLOTS              8
+#define LOCKOUT_SLOT_SIZE          4         /* sequence(2) failures check */
+
+typedef struct {
+	uint8 freeAttempts;        /* Consecutive wrong attempts allowed before the first lockout */
+	uint16 basePeriod;         /* Seconds of the first lockout, doubled by every wrong attempt after it */
+	uint8 maxDoublings;        /* Cap of the backoff: longest lockout = basePeriod << maxDoublings */
+	const STORAGE_BackendType *backend;   /* EEPROM holding the slots */
+	uint16 eepromAddress;      /* First byte of the LOCKOUT_SLOTS * LOCKOUT_SLOT_SIZE bytes used */
+} LOCKOUT_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Load the consecutive failures counter from EEPROM. If the ECU was reset while
+ * locked out, the lockout of the current level starts over, so a power cycle
+ * can never shorten it.
+ */
+void LOCKOUT_init(const LOCKOUT_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Change the policy (attempts, period, doublings) at runtime, the failures counter
+ * and a running lockout are kept. The EEPROM address cannot change.
+ */
+void LOCKOUT_setPolicy(uint8 freeAttempts, uint16 basePeriod, uint8 maxDoublings);
+
+/*
+ * Description :
+ * Count a wrong password and persist it, return the lockout period started by
+ * this failure in seconds (0 if the user may try again at once).
+ */
+uint16 LOCKOUT_registerFailure(void);
+
+/*
+ * Description :
+ * Clear the failures counter after a correct password (only written if it was not already 0).
+ */
+void LOCKOUT_registerSuccess(void);
+
+/*
+ * Description :
+ * Return the seconds left in the current lockout, 0 if not locked out.
+ */
+uint16 LOCKOUT_getRemaining(void);
+
+/*
+ * Description :
+ * Count down the current lockout, must be called every second from the timer ISR.
+ */
+void LOCKOUT_tick(void);
+
+#endif /* LOCKOUT_H_ */
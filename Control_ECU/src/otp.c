@@ -0,0 +1,321 @@
+ /******************************************************************************
+ *
+ * Module: OTP
+ *
+ * File Name: otp.c
+ *
+ * Description: Source file for the HOTP (RFC 4226) and TOTP (RFC 6238) one-time access codes
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "otp.h"
+#include "sha1.h"
+#include "crc.h"
+#include "rtc.h"
+#include "trace.h"
+#include "uart.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define OTP_IPAD                   0x36
+#define OTP_OPAD                   0x5C
+#define OTP_BENCHMARK_CODES        8
+
+/* Message bit lengths after the 64-byte HMAC key block: 8-byte counter (inner), 20-byte digest (outer) */
+#define OTP_INNER_BIT_LENGTH       ((SHA1_BLOCK_SIZE + 8) * 8)
+#define OTP_OUTER_BIT_LENGTH       ((SHA1_BLOCK_SIZE + SHA1_DIGEST_SIZE) * 8)
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static const uint8 g_otpSecret[OTP_SECRET_SIZE] PROGMEM = OTP_SECRET;
+
+static OTP_ConfigType g_otpConfig;
+static uint32 g_otpInnerState[5];        /* SHA-1 state after the (secret ^ ipad) block */
+static uint32 g_otpOuterState[5];        /* SHA-1 state after the (secret ^ opad) block */
+static uint32 g_otpNextCounter = 0;      /* Lowest counter still accepted, all the ones before were used or skipped */
+static uint8 g_otpSlot = 0;              /* Slot holding g_otpNextCounter */
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint32 OTP_hmacTruncate(uint32 counter);
+static uint8 OTP_search(uint32 first, uint32 last, uint32 code, uint32 *matched);
+static void OTP_save(void);
+static void OTP_storeState(const uint32 *state, uint8 *digest);
+static void OTP_sendWord(uint16 data);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Precompute the HMAC key states of the secret and load the moving factor from EEPROM.
+ */
+void OTP_init(const OTP_ConfigType *configPtr)
+{
+	SHA1_ContextType context;
+	uint8 slotData[OTP_SLOT_SIZE];
+	uint32 counter;
+	uint8 slot, i;
+	uint8 found = FALSE;
+
+	g_otpConfig = *configPtr;
+
+	/* Only the two key states are kept, a code then costs 2 compressions instead of 4 */
+	memset(context.block, 0, SHA1_BLOCK_SIZE);
+	memcpy_P(context.block, g_otpSecret, OTP_SECRET_SIZE);
+	for (i = 0; i < SHA1_BLOCK_SIZE; i++)
+	{
+		context.block[i] ^= OTP_IPAD;
+	}
+	SHA1_init(&context);
+	SHA1_compress(context.state, context.block);
+	memcpy(g_otpInnerState, context.state, sizeof(g_otpInnerState));
+
+	for (i = 0; i < SHA1_BLOCK_SIZE; i++)
+	{
+		context.block[i] ^= OTP_IPAD ^ OTP_OPAD;
+	}
+	SHA1_init(&context);
+	SHA1_compress(context.state, context.block);
+	memcpy(g_otpOuterState, context.state, sizeof(g_otpOuterState));
+	memset(context.block, 0, SHA1_BLOCK_SIZE);
+
+	/* The counter only moves forward, so the latest value is the valid slot with the highest one */
+	g_otpNextCounter = 0;
+	for (slot = 0; slot < OTP_SLOTS; slot++)
+	{
+		for (i = 0; i < OTP_SLOT_SIZE; i++)
+		{
+			if (EEPROM_readByte(g_otpConfig.eepromAddress + (slot * OTP_SLOT_SIZE) + i, &slotData[i]) == ERROR)
+				break;
+		}
+		/* The CRC-8 of an erased (0xFF) slot is 0xDE, so an erased slot never validates */
+		if ((i != OTP_SLOT_SIZE) || (slotData[OTP_SLOT_SIZE - 1] != CRC_block8(CRC8_INIT, slotData, OTP_SLOT_SIZE - 1)))
+			continue;       /* Erased, or the write was interrupted by a reset */
+
+		counter = ((uint32)slotData[3] << 24) | ((uint32)slotData[2] << 16) | ((uint16)slotData[1] << 8) | slotData[0];
+		if (!found || (counter > g_otpNextCounter))
+		{
+			found = TRUE;
+			g_otpSlot = slot;
+			g_otpNextCounter = counter;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Check a code given as digits (0..9). Every counter of the window is computed whatever
+ * the result, so the time taken does not tell which one matched. An accepted code and
+ * all the codes before it can never be used again.
+ */
+OTP_ResultType OTP_verify(const uint8 *digits)
+{
+	uint32 code = 0;
+	uint32 first, last, step, matched;
+	uint8 i;
+
+	for (i = 0; i < g_otpConfig.digits; i++)
+	{
+		if (digits[i] > 9)
+			return OTP_REJECTED;
+		code = (code * 10) + digits[i];
+	}
+
+	if (g_otpConfig.mode == OTP_MODE_TOTP)
+	{
+		if (!RTC_isSet())
+			return OTP_NO_CLOCK;
+
+		step = RTC_getTime() / g_otpConfig.timeStep;
+		first = (step > g_otpConfig.window) ? (step - g_otpConfig.window) : 0;
+		last = step + g_otpConfig.window;
+	}
+	else
+	{
+		first = g_otpNextCounter;
+		last = g_otpNextCounter + g_otpConfig.window;
+	}
+
+	/* Replay protection: a used code (or an older one) is never in the searched range */
+	if (first < g_otpNextCounter)
+	{
+		first = g_otpNextCounter;
+	}
+	if ((first > last) || !OTP_search(first, last, code, &matched))
+		return OTP_REJECTED;
+
+	g_otpNextCounter = matched + 1;     /* HOTP: resynchronized with the token */
+	OTP_save();
+	return OTP_ACCEPTED;
+}
+
+/*
+ * Description :
+ * Compute the code of a counter as a number (RFC 4226 dynamic truncation).
+ */
+uint32 OTP_generate(uint32 counter)
+{
+	uint32 modulo = 1;
+	uint8 i;
+
+	for (i = 0; i < g_otpConfig.digits; i++)
+	{
+		modulo *= 10;
+	}
+	return OTP_hmacTruncate(counter) % modulo;
+}
+
+/*
+ * Description :
+ * Measure the worst case verification and send the report through UART, values are
+ * little-endian microseconds: 'O' 'B' hmacTime(2) verifyTime(4)
+ * where verifyTime covers every counter of the window.
+ */
+void OTP_sendBenchmark(void)
+{
+	uint32 start, hmacTime, verifyTime, matched;
+	uint8 count = (g_otpConfig.mode == OTP_MODE_TOTP) ? ((2 * g_otpConfig.window) + 1) : (g_otpConfig.window + 1);
+	uint8 i;
+
+	start = TRACE_getMicroseconds();
+	for (i = 0; i < OTP_BENCHMARK_CODES; i++)
+	{
+		(void)OTP_generate(i);
+	}
+	hmacTime = (TRACE_getMicroseconds() - start) / OTP_BENCHMARK_CODES;
+
+	/* A truncated value never has the top bit set, so nothing matches and the whole window is computed */
+	start = TRACE_getMicroseconds();
+	(void)OTP_search(0, count - 1, 0xFFFFFFFF, &matched);
+	verifyTime = TRACE_getMicroseconds() - start;
+
+	UART_sendByte(OTP_REPORT_SYNC1);
+	UART_sendByte(OTP_REPORT_SYNC2);
+	OTP_sendWord((uint16)hmacTime);
+	OTP_sendWord((uint16)verifyTime);
+	OTP_sendWord((uint16)(verifyTime >> 16));
+}
+
+/*
+ * Description :
+ * HMAC-SHA1 of the 8-byte big-endian counter followed by the dynamic truncation to 31 bits.
+ * Both messages fit in a single padded block, so it is exactly 2 compressions.
+ */
+static uint32 OTP_hmacTruncate(uint32 counter)
+{
+	uint32 state[5];
+	uint8 block[SHA1_BLOCK_SIZE];
+	uint8 offset;
+
+	/* Inner hash: counter (the high 32 bits are always 0 here), padding, length */
+	memset(block, 0, SHA1_BLOCK_SIZE);
+	block[4] = (uint8)(counter >> 24);
+	block[5] = (uint8)(counter >> 16);
+	block[6] = (uint8)(counter >> 8);
+	block[7] = (uint8)counter;
+	block[8] = 0x80;
+	block[SHA1_BLOCK_SIZE - 2] = (uint8)(OTP_INNER_BIT_LENGTH >> 8);
+	block[SHA1_BLOCK_SIZE - 1] = (uint8)OTP_INNER_BIT_LENGTH;
+	memcpy(state, g_otpInnerState, sizeof(state));
+	SHA1_compress(state, block);
+
+	/* Outer hash: inner digest, padding, length */
+	OTP_storeState(state, block);
+	memset(&block[SHA1_DIGEST_SIZE], 0, SHA1_BLOCK_SIZE - SHA1_DIGEST_SIZE);
+	block[SHA1_DIGEST_SIZE] = 0x80;
+	block[SHA1_BLOCK_SIZE - 2] = (uint8)(OTP_OUTER_BIT_LENGTH >> 8);
+	block[SHA1_BLOCK_SIZE - 1] = (uint8)OTP_OUTER_BIT_LENGTH;
+	memcpy(state, g_otpOuterState, sizeof(state));
+	SHA1_compress(state, block);
+	OTP_storeState(state, block);
+
+	offset = block[SHA1_DIGEST_SIZE - 1] & 0x0F;
+	return ((uint32)(block[offset] & 0x7F) << 24) | ((uint32)block[offset + 1] << 16) |
+		   ((uint16)block[offset + 2] << 8) | block[offset + 3];
+}
+
+/*
+ * Description :
+ * Compute the code of every counter from first to last, return TRUE and the first
+ * matching counter if the code is found.
+ */
+static uint8 OTP_search(uint32 first, uint32 last, uint32 code, uint32 *matched)
+{
+	uint32 counter = first;
+	uint8 found = FALSE;
+
+	while (1)
+	{
+		if ((OTP_generate(counter) == code) && !found)
+		{
+			found = TRUE;
+			*matched = counter;
+		}
+		if (counter == last)
+			break;
+		counter++;
+	}
+	return found;
+}
+
+/*
+ * Description :
+ * Write the counter to the other slot, the previous value stays valid until the
+ * new one is completely written.
+ */
+static void OTP_save(void)
+{
+	uint8 slotData[OTP_SLOT_SIZE];
+	uint16 address;
+
+	g_otpSlot = (g_otpSlot + 1) % OTP_SLOTS;
+
+	slotData[0] = (uint8)g_otpNextCounter;
+	slotData[1] = (uint8)(g_otpNextCounter >> 8);
+	slotData[2] = (uint8)(g_otpNextCounter >> 16);
+	slotData[3] = (uint8)(g_otpNextCounter >> 24);
+	slotData[4] = CRC_block8(CRC8_INIT, slotData, OTP_SLOT_SIZE - 1);
+
+	address = g_otpConfig.eepromAddress + (g_otpSlot * OTP_SLOT_SIZE);
+	EEPROM_writeBlock(address, slotData, OTP_SLOT_SIZE);
+}
+
+/*
+ * Description :
+ * Serialize a SHA-1 state as a big-endian digest.
+ */
+static void OTP_storeState(const uint32 *state, uint8 *digest)
+{
+	uint8 i;
+
+	for (i = 0; i < 5; i++)
+	{
+		digest[4 * i]     = (uint8)(state[i] >> 24);
+		digest[4 * i + 1] = (uint8)(state[i] >> 16);
+		digest[4 * i + 2] = (uint8)(state[i] >> 8);
+		digest[4 * i + 3] = (uint8)state[i];
+	}
+}
+
+/*
+ * Description :
+ * Send a 16-bit value through UART, low byte first.
+ */
+static void OTP_sendWord(uint16 data)
+{
+	UART_sendByte((uint8)data);
+	UART_sendByte((uint8)(data >> 8));
+}
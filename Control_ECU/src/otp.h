@@ -0,0 +1,95 @@
+ /******************************************************************************
+ *
+ * Module: OTP
+ *
+ * File Name: otp.h
+ *
+ * Description: Header file for the HOTP (RFC 4226) and TOTP (RFC 6238) one-time access codes
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef OTP_H_
+#define OTP_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Secret shared with the tokens (or authenticator apps) of the contractors. Every site
+ * must provision its own with -DOTP_SECRET="{ 0x.., ... }", this one is the secret of
+ * the RFC 4226/6238 test vectors, for development boards only.
+ */
+#ifndef OTP_SECRET
+#define OTP_SECRET                 { '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', \
+                                     '1', '2', '3', '4', '5', '6', '7', '8', '9', '0' }
+#endif
+#define OTP_SECRET_SIZE            20
+
+#define OTP_MAX_DIGITS             8
+
+/* The moving factor is kept in 2 EEPROM slots written in turn: value(4, low first) check */
+#define OTP_SLOTS                  2
+#define OTP_SLOT_SIZE              5
+
+/* Sync bytes that start the benchmark report sent over the UART */
+#define OTP_REPORT_SYNC1           'O'
+#define OTP_REPORT_SYNC2           'B'
+
+typedef enum {
+	OTP_MODE_HOTP,             /* Event based: counter incremented by every code generated on the token */
+	OTP_MODE_TOTP              /* Time based: counter = RTC time / timeStep */
+} OTP_ModeType;
+
+typedef enum {
+	OTP_REJECTED,
+	OTP_ACCEPTED,
+	OTP_NO_CLOCK               /* TOTP code while the RTC was not set, nothing was checked */
+} OTP_ResultType;
+
+typedef struct {
+	OTP_ModeType mode;
+	uint8 digits;              /* Code length, 6 to OTP_MAX_DIGITS */
+	uint16 timeStep;           /* TOTP: seconds per code */
+	uint8 window;              /* TOTP: steps accepted before and after the current one (clock skew)
+	                              HOTP: counters accepted after the expected one (look-ahead)       */
+	uint16 eepromAddress;      /* First byte of the OTP_SLOTS * OTP_SLOT_SIZE bytes used */
+} OTP_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Precompute the HMAC key states of the secret and load the moving factor from EEPROM.
+ */
+void OTP_init(const OTP_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Check a code given as digits (0..9). Every counter of the window is computed whatever
+ * the result, so the time taken does not tell which one matched. An accepted code and
+ * all the codes before it can never be used again.
+ */
+OTP_ResultType OTP_verify(const uint8 *digits);
+
+/*
+ * Description :
+ * Compute the code of a counter as a number (RFC 4226 dynamic truncation).
+ */
+uint32 OTP_generate(uint32 counter);
+
+/*
+ * Description :
+ * Measure the worst case verification and send the report through UART, values are
+ * little-endian microseconds: 'O' 'B' hmacTime(2) verifyTime(4)
+ * where verifyTime covers every counter of the window.
+ */
+void OTP_sendBenchmark(void);
+
+#endif /* OTP_H_ */
@@ -0,0 +1,307 @@
+ /******************************************************************************
+ *
+ * Module: PASSWORD HASH
+ *
+ * File Name: password_hash.c
+ *
+ * Description: Source file for the salted PBKDF2-HMAC-SHA256 password records
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include "password_hash.h"
+#include "trace.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define PWHASH_IPAD                0x36
+#define PWHASH_OPAD                0x5C
+#define PWHASH_POOL_SIZE           16
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static uint8 g_pwhashPool[PWHASH_POOL_SIZE];
+static uint8 g_pwhashPoolIndex = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void PWHASH_storeState(const uint32 *state, uint8 *digest);
+static void PWHASH_sendWord(uint16 data);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Mix an unpredictable byte (e.g. a timer count sampled when a byte arrives from
+ * the user side) into the pool the salts are drawn from.
+ */
+void PWHASH_addEntropy(uint8 sample)
+{
+	uint8 old = g_pwhashPool[g_pwhashPoolIndex];
+
+	g_pwhashPool[g_pwhashPoolIndex] = (uint8)((old << 1) | (old >> 7)) ^ sample;
+	g_pwhashPoolIndex = (g_pwhashPoolIndex + 1) % PWHASH_POOL_SIZE;
+}
+
+/*
+ * Description :
+ * Compute the first 32-byte block of PBKDF2-HMAC-SHA256 (password up to 64 bytes).
+ * The HMAC inner and outer states are computed once, then every iteration after the
+ * first one is exactly two compressions of the same padded block: a 32-byte message
+ * after a 64-byte key block is always followed by the same padding.
+ */
+void PWHASH_derive(const uint8 *password, uint8 length, const uint8 *salt, uint16 iterations, uint8 *digest)
+{
+	static const uint8 blockIndex[4] = { 0, 0, 0, 1 };     /* INT(1), big-endian */
+	SHA256_ContextType context;
+	uint32 innerState[8], outerState[8];
+	uint8 block[SHA256_BLOCK_SIZE];
+	uint8 i;
+
+	/* HMAC key blocks: the password padded with zeros, XOR ipad then opad */
+	memset(block, 0, SHA256_BLOCK_SIZE);
+	memcpy(block, password, length);
+	for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+	{
+		block[i] ^= PWHASH_IPAD;
+	}
+	SHA256_init(&context);
+	SHA256_compress(context.state, block);
+	memcpy(innerState, context.state, sizeof(innerState));
+
+	for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+	{
+		block[i] ^= PWHASH_IPAD ^ PWHASH_OPAD;
+	}
+	SHA256_init(&context);
+	SHA256_compress(context.state, block);
+	memcpy(outerState, context.state, sizeof(outerState));
+
+	/* U1 = HMAC(password, salt || INT(1)) */
+	memcpy(context.state, innerState, sizeof(innerState));
+	context.blockLength = 0;
+	context.totalLength = SHA256_BLOCK_SIZE;
+	SHA256_update(&context, salt, PWHASH_SALT_SIZE);
+	SHA256_update(&context, blockIndex, sizeof(blockIndex));
+	SHA256_final(&context, block);
+
+	memcpy(context.state, outerState, sizeof(outerState));
+	context.blockLength = 0;
+	context.totalLength = SHA256_BLOCK_SIZE;
+	SHA256_update(&context, block, SHA256_DIGEST_SIZE);
+	SHA256_final(&context, block);
+	memcpy(digest, block, PWHASH_DIGEST_SIZE);
+
+	/* Padding of a 96-byte message: 0x80, zeros, length = 768 bits */
+	memset(&block[SHA256_DIGEST_SIZE], 0, SHA256_BLOCK_SIZE - SHA256_DIGEST_SIZE);
+	block[SHA256_DIGEST_SIZE] = 0x80;
+	block[SHA256_BLOCK_SIZE - 2] = 0x03;
+
+	/* Un = HMAC(password, Un-1), result = U1 ^ U2 ^ ... ^ Un */
+	while (iterations > 1)
+	{
+		memcpy(context.state, innerState, sizeof(innerState));
+		SHA256_compress(context.state, block);
+		PWHASH_storeState(context.state, block);
+
+		memcpy(context.state, outerState, sizeof(outerState));
+		SHA256_compress(context.state, block);
+		PWHASH_storeState(context.state, block);
+
+		for (i = 0; i < PWHASH_DIGEST_SIZE; i++)
+		{
+			digest[i] ^= block[i];
+		}
+		iterations--;
+	}
+}
+
+/*
+ * Description :
+ * Draw a new salt from the entropy pool, the given bytes (e.g. the data being replaced)
+ * are mixed in so a salt is never reused even with a weak pool.
+ */
+void PWHASH_newSalt(uint8 *salt, const uint8 *mix, uint8 mixLength)
+{
+	SHA256_ContextType context;
+	uint8 seed[SHA256_DIGEST_SIZE];
+	uint32 now = TRACE_getMicroseconds();
+
+	/* salt = SHA-256(pool || mix || time) truncated */
+	SHA256_init(&context);
+	SHA256_update(&context, g_pwhashPool, PWHASH_POOL_SIZE);
+	SHA256_update(&context, mix, mixLength);
+	SHA256_update(&context, (const uint8 *)&now, sizeof(now));
+	SHA256_final(&context, seed);
+	memcpy(salt, seed, PWHASH_SALT_SIZE);
+}
+
+/*
+ * Description :
+ * Fill the record for a new password with a fresh salt, the given iteration count and the digest.
+ * The old content of the record is mixed into the new salt.
+ */
+void PWHASH_create(PWHASH_RecordType *record, const uint8 *password, uint8 length, uint16 iterations)
+{
+	PWHASH_newSalt(record->salt, (const uint8 *)record, sizeof(PWHASH_RecordType));
+	record->magic = PWHASH_MAGIC;
+	record->iterations = iterations;
+	PWHASH_derive(password, length, record->salt, iterations, record->digest);
+}
+
+/*
+ * Description :
+ * Return TRUE if the record was written by PWHASH_create (and not erased or corrupted).
+ */
+uint8 PWHASH_isValid(const PWHASH_RecordType *record)
+{
+	return (record->magic == PWHASH_MAGIC) &&
+		   (record->iterations >= 1) && (record->iterations <= PWHASH_MAX_ITERATIONS);
+}
+
+/*
+ * Description :
+ * Check a password against a record, return TRUE if it matches. The time taken
+ * does not depend on which byte of the digest differs.
+ */
+uint8 PWHASH_verify(const PWHASH_RecordType *record, const uint8 *password, uint8 length)
+{
+	uint8 digest[PWHASH_DIGEST_SIZE];
+
+	if (!PWHASH_isValid(record))
+		return FALSE;
+
+	PWHASH_derive(password, length, record->salt, record->iterations, digest);
+	return PWHASH_isEqual(digest, record->digest, PWHASH_DIGEST_SIZE);
+}
+
+/*
+ * Description :
+ * Compare two buffers in constant time, return TRUE if they are equal.
+ */
+uint8 PWHASH_isEqual(const uint8 *a, const uint8 *b, uint8 length)
+{
+	volatile uint8 difference = 0;     /* volatile: keep the compiler from adding an early exit */
+	uint8 i;
+
+	for (i = 0; i < length; i++)
+	{
+		difference |= a[i] ^ b[i];
+	}
+	return (difference == 0) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Measure one SHA-256 compression in microseconds (average of PWHASH_BENCHMARK_BLOCKS).
+ */
+uint16 PWHASH_benchmarkBlock(void)
+{
+	uint32 state[8] = { 0 };
+	uint8 block[SHA256_BLOCK_SIZE] = { 0 };
+	uint32 start;
+	uint8 i;
+
+	start = TRACE_getMicroseconds();
+	for (i = 0; i < PWHASH_BENCHMARK_BLOCKS; i++)
+	{
+		SHA256_compress(state, block);
+	}
+	return (uint16)((TRACE_getMicroseconds() - start) / PWHASH_BENCHMARK_BLOCKS);
+}
+
+/*
+ * Description :
+ * Return the iteration count whose verification fits in the given time budget,
+ * each iteration costs two compressions.
+ */
+uint16 PWHASH_calibrate(uint16 budgetMs)
+{
+	uint16 blockTime = PWHASH_benchmarkBlock();
+	uint32 iterations;
+
+	if (blockTime == 0)
+	{
+		blockTime = 1;
+	}
+
+	/* The key blocks and the first iteration cost about 2 more iterations */
+	iterations = ((uint32)budgetMs * 1000) / (2 * (uint32)blockTime);
+	iterations = (iterations > 2) ? (iterations - 2) : 0;
+
+	if (iterations < PWHASH_MIN_ITERATIONS)
+	{
+		iterations = PWHASH_MIN_ITERATIONS;
+	}
+	else if (iterations > PWHASH_MAX_ITERATIONS)
+	{
+		iterations = PWHASH_MAX_ITERATIONS;
+	}
+	return (uint16)iterations;
+}
+
+/*
+ * Description :
+ * Run the benchmark and send the report through UART, 16/32-bit values are little-endian:
+ * 'H' 'B' blockTimeUs(2) iterations(2) verifyTimeUs(4)
+ * where iterations is the count calibrated for the given budget and verifyTimeUs the measured
+ * time of a full verification with it.
+ */
+void PWHASH_sendBenchmark(uint16 budgetMs)
+{
+	static const uint8 password[] = { 1, 2, 3, 4, 5 };
+	uint8 digest[PWHASH_DIGEST_SIZE];
+	uint16 blockTime = PWHASH_benchmarkBlock();
+	uint16 iterations = PWHASH_calibrate(budgetMs);
+	uint32 start, verifyTime;
+
+	start = TRACE_getMicroseconds();
+	PWHASH_derive(password, sizeof(password), g_pwhashPool, iterations, digest);
+	(void)PWHASH_isEqual(digest, digest, PWHASH_DIGEST_SIZE);
+	verifyTime = TRACE_getMicroseconds() - start;
+
+	UART_sendByte(PWHASH_REPORT_SYNC1);
+	UART_sendByte(PWHASH_REPORT_SYNC2);
+	PWHASH_sendWord(blockTime);
+	PWHASH_sendWord(iterations);
+	PWHASH_sendWord((uint16)verifyTime);
+	PWHASH_sendWord((uint16)(verifyTime >> 16));
+}
+
+/*
+ * Description :
+ * Serialize a SHA-256 state as a big-endian digest.
+ */
+static void PWHASH_storeState(const uint32 *state, uint8 *digest)
+{
+	uint8 i;
+
+	for (i = 0; i < 8; i++)
+	{
+		digest[4 * i]     = (uint8)(state[i] >> 24);
+		digest[4 * i + 1] = (uint8)(state[i] >> 16);
+		digest[4 * i + 2] = (uint8)(state[i] >> 8);
+		digest[4 * i + 3] = (uint8)state[i];
+	}
+}
+
+/*
+ * Description :
+ * Send a 16-bit value through UART, low byte first.
+ */
+static void PWHASH_sendWord(uint16 data)
+{
+	UART_sendByte((uint8)data);
+	UART_sendByte((uint8)(data >> 8));
+}
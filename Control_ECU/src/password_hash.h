@@ -0,0 +1,117 @@
+ /******************************************************************************
+ *
+ * Module: PASSWORD HASH
+ *
+ * File Name: password_hash.h
+ *
+ * Description: Header file for the salted PBKDF2-HMAC-SHA256 password records
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef PASSWORD_HASH_H_
+#define PASSWORD_HASH_H_
+
+#include "std_types.h"
+#include "sha256.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define PWHASH_MAGIC               0x5048      /* Marks a stored record, an erased EEPROM reads 0xFFFF */
+#define PWHASH_SALT_SIZE           8
+#define PWHASH_DIGEST_SIZE         SHA256_DIGEST_SIZE
+
+/* Bounds of the calibrated iteration count */
+#define PWHASH_MIN_ITERATIONS      16
+#define PWHASH_MAX_ITERATIONS      4096
+
+/* Compressions timed by the benchmark to get the cost of one block */
+#define PWHASH_BENCHMARK_BLOCKS    16
+
+/* Sync bytes that start the benchmark report sent over the UART */
+#define PWHASH_REPORT_SYNC1        'H'
+#define PWHASH_REPORT_SYNC2        'B'
+
+typedef struct {
+	uint16 magic;
+	uint16 iterations;                  /* Chosen by PWHASH_calibrate when the record was created */
+	uint8 salt[PWHASH_SALT_SIZE];
+	uint8 digest[PWHASH_DIGEST_SIZE];   /* PBKDF2-HMAC-SHA256(password, salt, iterations), first block */
+} PWHASH_RecordType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Mix an unpredictable byte (e.g. a timer count sampled when a byte arrives from
+ * the user side) into the pool the salts are drawn from.
+ */
+void PWHASH_addEntropy(uint8 sample);
+
+/*
+ * Description :
+ * Compute the first 32-byte block of PBKDF2-HMAC-SHA256 (password up to 64 bytes).
+ */
+void PWHASH_derive(const uint8 *password, uint8 length, const uint8 *salt, uint16 iterations, uint8 *digest);
+
+/*
+ * Description :
+ * Draw a new salt from the entropy pool, the given bytes (e.g. the data being replaced)
+ * are mixed in so a salt is never reused even with a weak pool.
+ */
+void PWHASH_newSalt(uint8 *salt, const uint8 *mix, uint8 mixLength);
+
+/*
+ * Description :
+ * Fill the record for a new password with a fresh salt, the given iteration count and the digest.
+ * The old content of the record is mixed into the new salt.
+ */
+void PWHASH_create(PWHASH_RecordType *record, const uint8 *password, uint8 length, uint16 iterations);
+
+/*
+ * Description :
+ * Return TRUE if the record was written by PWHASH_create (and not erased or corrupted).
+ */
+uint8 PWHASH_isValid(const PWHASH_RecordType *record);
+
+/*
+ * Description :
+ * Check a password against a record, return TRUE if it matches. The time taken
+ * does not depend on which byte of the digest differs.
+ */
+uint8 PWHASH_verify(const PWHASH_RecordType *record, const uint8 *password, uint8 length);
+
+/*
+ * Description :
+ * Compare two buffers in constant time, return TRUE if they are equal.
+ */
+uint8 PWHASH_isEqual(const uint8 *a, const uint8 *b, uint8 length);
+
+/*
+ * Description :
+ * Measure one SHA-256 compression in microseconds (average of PWHASH_BENCHMARK_BLOCKS).
+ */
+uint16 PWHASH_benchmarkBlock(void);
+
+/*
+ * Description :
+ * Return the iteration count whose verification fits in the given time budget,
+ * each iteration costs two compressions.
+ */
+uint16 PWHASH_calibrate(uint16 budgetMs);
+
+/*
+ * Description :
+ * Run the benchmark and send the report through UART, 16/32-bit values are little-endian:
+ * 'H' 'B' blockTimeUs(2) iterations(2) verifyTimeUs(4)
+ * where iterations is the count calibrated for the given budget and verifyTimeUs the measured
+ * time of a full verification with it.
+ */
+void PWHASH_sendBenchmark(uint16 budgetMs);
+
+#endif /* PASSWORD_HASH_H_ */
@@ -0,0 +1,158 @@
+ /******************************************************************************
+ *
+ * Module: RAM MONITOR
+ *
+ * File Name: ram_monitor.c
+ *
+ * Description: Source file for the stack painting and RAM high-water-mark monitor
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include "ram_monitor.h"
+#include "trace.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+/* First RAM address after .data, .bss and .noinit (provided by the linker) */
+extern uint8 __heap_start;
+
+/* Lowest stack address reached while in each application state (RAMEND+1 = never sampled) */
+static uint16 g_rammonStateLowestSp[RAMMON_MAX_STATES];
+
+/* Lowest painted byte overwritten by the stack so far */
+static uint8 *g_rammonBoundary = (uint8 *)(RAMEND + 1);
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/*
+ * Fill the free RAM with RAMMON_PAINT_BYTE, it runs inline in the startup code
+ * after the stack pointer is set (.init2) and before .data/.bss are initialized
+ * (.init4), so it has no stack frame and must not touch the stack.
+ */
+void RAMMON_paintStack(void) __attribute__((naked, used, section(".init3")));
+
+static void RAMMON_sendWord(uint16 data);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void RAMMON_paintStack(void)
+{
+	__asm__ volatile (
+		"    ldi r30, lo8(__heap_start)  \n"
+		"    ldi r31, hi8(__heap_start)  \n"
+		"    ldi r24, %0                 \n"
+		"    ldi r25, hi8(%1)            \n"
+		"1:  st  Z+, r24                 \n"
+		"    cpi r30, lo8(%1)            \n"
+		"    cpc r31, r25                \n"
+		"    brne 1b                     \n"
+		:
+		: "i" (RAMMON_PAINT_BYTE), "i" (RAMEND + 1)
+	);
+}
+
+/*
+ * Description :
+ * Clear the per-state statistics, the stack itself is painted before main
+ * by RAMMON_paintStack which is placed in the .init3 section.
+ */
+void RAMMON_init(void)
+{
+	uint8 state;
+
+	for (state = 0; state < RAMMON_MAX_STATES; state++)
+	{
+		g_rammonStateLowestSp[state] = RAMEND + 1;
+	}
+
+	/* Start from the current stack depth, the paint below it is still intact */
+	g_rammonBoundary = (uint8 *)SP;
+	RAMMON_sample();
+}
+
+/*
+ * Description :
+ * Sample the stack pointer and the painted area and charge any new stack depth
+ * to the current application state, meant to be called periodically from the timer ISR.
+ */
+void RAMMON_sample(void)
+{
+	uint16 lowest = SP;
+	uint8 state = TRACE_getState();
+
+	/* The stack only overwrites the paint downwards, so continue the scan from the last boundary */
+	while ((g_rammonBoundary > &__heap_start) && (*(g_rammonBoundary - 1) != RAMMON_PAINT_BYTE))
+	{
+		g_rammonBoundary--;
+	}
+
+	if ((uint16)g_rammonBoundary < lowest)
+	{
+		lowest = (uint16)g_rammonBoundary;
+	}
+
+	if ((state < RAMMON_MAX_STATES) && (lowest < g_rammonStateLowestSp[state]))
+	{
+		g_rammonStateLowestSp[state] = lowest;
+	}
+}
+
+/*
+ * Description :
+ * Return the number of RAM bytes that the stack never reached since boot.
+ */
+uint16 RAMMON_getFreeRam(void)
+{
+	return (uint16)(g_rammonBoundary - &__heap_start);
+}
+
+/*
+ * Description :
+ * Return the deepest stack usage in bytes since boot.
+ */
+uint16 RAMMON_getStackHighWaterMark(void)
+{
+	return (uint16)(RAMEND + 1 - (uint16)g_rammonBoundary);
+}
+
+/*
+ * Description :
+ * Send the report through UART, all 16-bit values are little-endian:
+ * 'R' 'M' staticRam(2) stackHighWaterMark(2) freeRam(2) numberOfStates stateStackUsage(2*numberOfStates)
+ * A state that was never sampled reports a stack usage of 0.
+ */
+void RAMMON_sendReport(void)
+{
+	uint8 state;
+
+	UART_sendByte(RAMMON_REPORT_SYNC1);
+	UART_sendByte(RAMMON_REPORT_SYNC2);
+	RAMMON_sendWord((uint16)&__heap_start - RAMSTART);
+	RAMMON_sendWord(RAMMON_getStackHighWaterMark());
+	RAMMON_sendWord(RAMMON_getFreeRam());
+	UART_sendByte(RAMMON_MAX_STATES);
+	for (state = 0; state < RAMMON_MAX_STATES; state++)
+	{
+		RAMMON_sendWord(RAMEND + 1 - g_rammonStateLowestSp[state]);
+	}
+}
+
+/*
+ * Description :
+ * Send a 16-bit value through UART, low byte first.
+ */
+static void RAMMON_sendWord(uint16 data)
+{
+	UART_sendByte((uint8)data);
+	UART_sendByte((uint8)(data >> 8));
+}
@@ -0,0 +1,97 @@
+ /******************************************************************************
+ *
+ * Module: RTC
+ *
+ * File Name: rtc.c
+ *
+ * Description: Source file for the software real time clock driven by the timer tick
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include "rtc.h"
+#include "gpio.h"
+#include "Macros.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static RTC_ConfigType g_rtcConfig;
+static volatile uint32 g_rtcSeconds = 0;
+static volatile uint32 g_rtcMicroseconds = 0;       /* Fraction of the current second */
+static volatile uint8 g_rtcSet = FALSE;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start the clock, the time is unknown until RTC_setTime (there is no backup battery).
+ */
+void RTC_init(const RTC_ConfigType *configPtr)
+{
+	g_rtcConfig = *configPtr;
+	g_rtcSeconds = 0;
+	g_rtcMicroseconds = 0;
+	g_rtcSet = FALSE;
+}
+
+/*
+ * Description :
+ * Advance the clock by one tick, must be called from the timer ISR.
+ * The tick is accumulated in microseconds, so a tick that is not exactly one second
+ * (e.g. 7814 counts of 128us = 1.000192s) does not drift.
+ */
+void RTC_tick(void)
+{
+	g_rtcMicroseconds += g_rtcConfig.tickMicroseconds;
+	while (g_rtcMicroseconds >= RTC_MICROSECONDS_PER_SECOND)
+	{
+		g_rtcMicroseconds -= RTC_MICROSECONDS_PER_SECOND;
+		g_rtcSeconds++;
+	}
+}
+
+/*
+ * Description :
+ * Set the time in seconds since 1970-01-01 00:00 UTC.
+ */
+void RTC_setTime(uint32 unixTime)
+{
+	uint8 sreg = SREG;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	g_rtcSeconds = unixTime;
+	g_rtcMicroseconds = 0;
+	g_rtcSet = TRUE;
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Return the time in seconds since 1970-01-01 00:00 UTC, only meaningful if RTC_isSet.
+ */
+uint32 RTC_getTime(void)
+{
+	uint8 sreg = SREG;
+	uint32 seconds;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	seconds = g_rtcSeconds;
+	SREG = sreg;
+
+	return seconds;
+}
+
+/*
+ * Description :
+ * Return TRUE once the time was set after the last reset.
+ */
+uint8 RTC_isSet(void)
+{
+	return g_rtcSet;
+}
@@ -0,0 +1,62 @@
+ /******************************************************************************
+ *
+ * Module: RTC
+ *
+ * File Name: rtc.h
+ *
+ * Description: Header file for the software real time clock driven by the timer tick
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef RTC_H_
+#define RTC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define RTC_MICROSECONDS_PER_SECOND    1000000UL
+
+typedef struct {
+	uint32 tickMicroseconds;   /* Exact period of the tick calling RTC_tick, the error of a rounded compare value is compensated */
+} RTC_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start the clock, the time is unknown until RTC_setTime (there is no backup battery).
+ */
+void RTC_init(const RTC_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Advance the clock by one tick, must be called from the timer ISR.
+ */
+void RTC_tick(void);
+
+/*
+ * Description :
+ * Set the time in seconds since 1970-01-01 00:00 UTC.
+ */
+void RTC_setTime(uint32 unixTime);
+
+/*
+ * Description :
+ * Return the time in seconds since 1970-01-01 00:00 UTC, only meaningful if RTC_isSet.
+ */
+uint32 RTC_getTime(void);
+
+/*
+ * Description :
+ * Return TRUE once the time was set after the last reset.
+ */
+uint8 RTC_isSet(void);
+
+#endif /* RTC_H_ */
@@ -0,0 +1,184 @@
+ /******************************************************************************
+ *
+ * Module: SHA1
+ *
+ * File Name: sha1.c
+ *
+ * Description: Source file for the SHA-1 hash tuned for the 8-bit AVR
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "sha1.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * As for SHA-256, rotations by multiples of 8 are only register moves for avr-gcc:
+ * ROTL5 is done as ROTL8 then 3 single bit right rotations and ROTL30 as 2 right rotations.
+ */
+#define ROTL8(x)      (((x) << 8) | ((x) >> 24))
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static const uint32 g_sha1InitialState[5] PROGMEM = {
+	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static inline uint32 SHA1_rotr1(uint32 x);
+static inline uint32 SHA1_rotl1(uint32 x);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start a new hash.
+ */
+void SHA1_init(SHA1_ContextType *context)
+{
+	memcpy_P(context->state, g_sha1InitialState, sizeof(context->state));
+	context->blockLength = 0;
+	context->totalLength = 0;
+}
+
+/*
+ * Description :
+ * Hash the given bytes, may be called any number of times.
+ */
+void SHA1_update(SHA1_ContextType *context, const uint8 *data, uint16 length)
+{
+	context->totalLength += length;
+
+	while (length != 0)
+	{
+		context->block[context->blockLength] = *data;
+		context->blockLength++;
+		data++;
+		length--;
+
+		if (context->blockLength == SHA1_BLOCK_SIZE)
+		{
+			SHA1_compress(context->state, context->block);
+			context->blockLength = 0;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Pad the message, write the 20-byte digest and leave the context unusable until SHA1_init.
+ */
+void SHA1_final(SHA1_ContextType *context, uint8 *digest)
+{
+	uint32 bitLengthLow = context->totalLength << 3;
+	uint8 bitLengthHigh = (uint8)(context->totalLength >> 29);
+	uint8 i;
+
+	context->block[context->blockLength++] = 0x80;
+	if (context->blockLength > (SHA1_BLOCK_SIZE - 8))
+	{
+		memset(&context->block[context->blockLength], 0, SHA1_BLOCK_SIZE - context->blockLength);
+		SHA1_compress(context->state, context->block);
+		context->blockLength = 0;
+	}
+	memset(&context->block[context->blockLength], 0, SHA1_BLOCK_SIZE - 8 - context->blockLength);
+
+	/* 64-bit big-endian message length in bits */
+	context->block[56] = 0;
+	context->block[57] = 0;
+	context->block[58] = 0;
+	context->block[59] = bitLengthHigh;
+	context->block[60] = (uint8)(bitLengthLow >> 24);
+	context->block[61] = (uint8)(bitLengthLow >> 16);
+	context->block[62] = (uint8)(bitLengthLow >> 8);
+	context->block[63] = (uint8)bitLengthLow;
+	SHA1_compress(context->state, context->block);
+
+	for (i = 0; i < 5; i++)
+	{
+		digest[4 * i]     = (uint8)(context->state[i] >> 24);
+		digest[4 * i + 1] = (uint8)(context->state[i] >> 16);
+		digest[4 * i + 2] = (uint8)(context->state[i] >> 8);
+		digest[4 * i + 3] = (uint8)context->state[i];
+	}
+}
+
+/*
+ * Description :
+ * Process one 64-byte block on the given state (the compression function), exposed
+ * for the HMAC fast path of the one-time codes and for benchmarking.
+ * The message schedule is kept as a rolling window of 16 words (64 bytes of stack
+ * instead of 320).
+ */
+void SHA1_compress(uint32 *state, const uint8 *block)
+{
+	uint32 w[16];
+	uint32 a, b, c, d, e, f, k, t;
+	uint8 i;
+
+	for (i = 0; i < 16; i++)
+	{
+		w[i] = ((uint32)block[4 * i] << 24) | ((uint32)block[4 * i + 1] << 16) |
+			   ((uint16)block[4 * i + 2] << 8) | block[4 * i + 3];
+	}
+
+	a = state[0]; b = state[1]; c = state[2]; d = state[3]; e = state[4];
+
+	for (i = 0; i < 80; i++)
+	{
+		if (i >= 16)
+		{
+			w[i & 15] = SHA1_rotl1(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^ w[(i - 14) & 15] ^ w[i & 15]);
+		}
+
+		if (i < 20)
+		{
+			f = d ^ (b & (c ^ d));
+			k = 0x5A827999;
+		}
+		else if (i < 40)
+		{
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		}
+		else if (i < 60)
+		{
+			f = (b & c) | (d & (b | c));
+			k = 0x8F1BBCDC;
+		}
+		else
+		{
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+
+		/* ROTL5(a) = ROTR3(ROTL8(a)), ROTL30(b) = ROTR2(b) */
+		t = SHA1_rotr1(SHA1_rotr1(SHA1_rotr1(ROTL8(a)))) + f + e + k + w[i & 15];
+		e = d; d = c; c = SHA1_rotr1(SHA1_rotr1(b)); b = a; a = t;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+}
+
+static inline uint32 SHA1_rotr1(uint32 x)
+{
+	return (x >> 1) | (x << 31);
+}
+
+static inline uint32 SHA1_rotl1(uint32 x)
+{
+	return (x << 1) | (x >> 31);
+}
@@ -0,0 +1,61 @@
+ /******************************************************************************
+ *
+ * Module: SHA1
+ *
+ * File Name: sha1.h
+ *
+ * Description: Header file for the SHA-1 hash tuned for the 8-bit AVR
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef SHA1_H_
+#define SHA1_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SHA1_BLOCK_SIZE            64
+#define SHA1_DIGEST_SIZE           20
+
+typedef struct {
+	uint32 state[5];
+	uint8 block[SHA1_BLOCK_SIZE];
+	uint8 blockLength;          /* Bytes waiting in block */
+	uint32 totalLength;         /* Bytes hashed so far (messages are far below 512 MB here) */
+} SHA1_ContextType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start a new hash.
+ */
+void SHA1_init(SHA1_ContextType *context);
+
+/*
+ * Description :
+ * Hash the given bytes, may be called any number of times.
+ */
+void SHA1_update(SHA1_ContextType *context, const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Pad the message, write the 20-byte digest and leave the context unusable until SHA1_init.
+ */
+void SHA1_final(SHA1_ContextType *context, uint8 *digest);
+
+/*
+ * Description :
+ * Process one 64-byte block on the given state (the compression function), exposed
+ * for the HMAC fast path of the one-time codes and for benchmarking.
+ */
+void SHA1_compress(uint32 *state, const uint8 *block);
+
+#endif /* SHA1_H_ */
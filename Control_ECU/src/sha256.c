@@ -0,0 +1,221 @@
+ /******************************************************************************
+ *
+ * Module: SHA256
+ *
+ * File Name: sha256.c
+ *
+ * Description: Source file for the SHA-256 hash tuned for the 8-bit AVR
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "sha256.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * The AVR has no barrel shifter, a 32-bit shift by n costs n passes over 4 registers.
+ * Rotations by multiples of 8 are only register moves for avr-gcc, so every rotation
+ * of SHA-256 is split into a byte rotation followed by at most 3 single bit rotations.
+ */
+#define ROTR8(x)      (((x) >> 8) | ((x) << 24))
+#define ROTR16(x)     (((x) >> 16) | ((x) << 16))
+#define ROTR24(x)     (((x) >> 24) | ((x) << 8))
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+/* Round constants, kept in flash (256 bytes of RAM saved) */
+static const uint32 g_sha256K[64] PROGMEM = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32 g_sha256InitialState[8] PROGMEM = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static inline uint32 SHA256_rotr1(uint32 x);
+static inline uint32 SHA256_rotl1(uint32 x);
+static inline uint32 SHA256_bigSigma0(uint32 x);
+static inline uint32 SHA256_bigSigma1(uint32 x);
+static inline uint32 SHA256_smallSigma0(uint32 x);
+static inline uint32 SHA256_smallSigma1(uint32 x);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start a new hash.
+ */
+void SHA256_init(SHA256_ContextType *context)
+{
+	memcpy_P(context->state, g_sha256InitialState, sizeof(context->state));
+	context->blockLength = 0;
+	context->totalLength = 0;
+}
+
+/*
+ * Description :
+ * Hash the given bytes, may be called any number of times.
+ */
+void SHA256_update(SHA256_ContextType *context, const uint8 *data, uint16 length)
+{
+	context->totalLength += length;
+
+	while (length != 0)
+	{
+		context->block[context->blockLength] = *data;
+		context->blockLength++;
+		data++;
+		length--;
+
+		if (context->blockLength == SHA256_BLOCK_SIZE)
+		{
+			SHA256_compress(context->state, context->block);
+			context->blockLength = 0;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Pad the message, write the 32-byte digest and leave the context unusable until SHA256_init.
+ */
+void SHA256_final(SHA256_ContextType *context, uint8 *digest)
+{
+	uint32 bitLengthLow = context->totalLength << 3;
+	uint8 bitLengthHigh = (uint8)(context->totalLength >> 29);
+	uint8 i;
+
+	context->block[context->blockLength++] = 0x80;
+	if (context->blockLength > (SHA256_BLOCK_SIZE - 8))
+	{
+		memset(&context->block[context->blockLength], 0, SHA256_BLOCK_SIZE - context->blockLength);
+		SHA256_compress(context->state, context->block);
+		context->blockLength = 0;
+	}
+	memset(&context->block[context->blockLength], 0, SHA256_BLOCK_SIZE - 8 - context->blockLength);
+
+	/* 64-bit big-endian message length in bits */
+	context->block[56] = 0;
+	context->block[57] = 0;
+	context->block[58] = 0;
+	context->block[59] = bitLengthHigh;
+	context->block[60] = (uint8)(bitLengthLow >> 24);
+	context->block[61] = (uint8)(bitLengthLow >> 16);
+	context->block[62] = (uint8)(bitLengthLow >> 8);
+	context->block[63] = (uint8)bitLengthLow;
+	SHA256_compress(context->state, context->block);
+
+	for (i = 0; i < 8; i++)
+	{
+		digest[4 * i]     = (uint8)(context->state[i] >> 24);
+		digest[4 * i + 1] = (uint8)(context->state[i] >> 16);
+		digest[4 * i + 2] = (uint8)(context->state[i] >> 8);
+		digest[4 * i + 3] = (uint8)context->state[i];
+	}
+}
+
+/*
+ * Description :
+ * Process one 64-byte block on the given state (the compression function), exposed
+ * for the HMAC/PBKDF2 fast path and for benchmarking.
+ * The message schedule is kept as a rolling window of 16 words (64 bytes of stack
+ * instead of 256) and the round constants are read from flash.
+ */
+void SHA256_compress(uint32 *state, const uint8 *block)
+{
+	uint32 w[16];
+	uint32 a, b, c, d, e, f, g, h, t1, t2;
+	uint8 i;
+
+	for (i = 0; i < 16; i++)
+	{
+		w[i] = ((uint32)block[4 * i] << 24) | ((uint32)block[4 * i + 1] << 16) |
+			   ((uint16)block[4 * i + 2] << 8) | block[4 * i + 3];
+	}
+
+	a = state[0]; b = state[1]; c = state[2]; d = state[3];
+	e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+	for (i = 0; i < 64; i++)
+	{
+		if (i >= 16)
+		{
+			w[i & 15] += SHA256_smallSigma1(w[(i - 2) & 15]) + w[(i - 7) & 15] + SHA256_smallSigma0(w[(i - 15) & 15]);
+		}
+
+		t1 = h + SHA256_bigSigma1(e) + (g ^ (e & (f ^ g))) + pgm_read_dword(&g_sha256K[i]) + w[i & 15];
+		t2 = SHA256_bigSigma0(a) + ((a & b) | (c & (a | b)));
+
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static inline uint32 SHA256_rotr1(uint32 x)
+{
+	return (x >> 1) | (x << 31);
+}
+
+static inline uint32 SHA256_rotl1(uint32 x)
+{
+	return (x << 1) | (x >> 31);
+}
+
+/* ROTR2 ^ ROTR13 ^ ROTR22 = ROTR2 ^ ROTL3(ROTR16) ^ ROTL2(ROTR24) */
+static inline uint32 SHA256_bigSigma0(uint32 x)
+{
+	uint32 r16 = ROTR16(x);
+	uint32 r24 = ROTR24(x);
+
+	return SHA256_rotr1(SHA256_rotr1(x)) ^
+		   SHA256_rotl1(SHA256_rotl1(SHA256_rotl1(r16))) ^
+		   SHA256_rotl1(SHA256_rotl1(r24));
+}
+
+/* ROTR6 ^ ROTR11 ^ ROTR25 = ROTL2(ROTR8) ^ ROTR3(ROTR8) ^ ROTR1(ROTR24) */
+static inline uint32 SHA256_bigSigma1(uint32 x)
+{
+	uint32 r8 = ROTR8(x);
+
+	return SHA256_rotl1(SHA256_rotl1(r8)) ^
+		   SHA256_rotr1(SHA256_rotr1(SHA256_rotr1(r8))) ^
+		   SHA256_rotr1(ROTR24(x));
+}
+
+/* ROTR7 ^ ROTR18 ^ SHR3 = ROTL1(ROTR8) ^ ROTR2(ROTR16) ^ SHR3 */
+static inline uint32 SHA256_smallSigma0(uint32 x)
+{
+	return SHA256_rotl1(ROTR8(x)) ^ SHA256_rotr1(SHA256_rotr1(ROTR16(x))) ^ (x >> 3);
+}
+
+/* ROTR17 ^ ROTR19 ^ SHR10 = ROTR1(ROTR16) ^ ROTR3(ROTR16) ^ SHR2(SHR8) */
+static inline uint32 SHA256_smallSigma1(uint32 x)
+{
+	uint32 r16 = ROTR16(x);
+
+	return SHA256_rotr1(r16) ^ SHA256_rotr1(SHA256_rotr1(SHA256_rotr1(r16))) ^ ((x >> 8) >> 2);
+}
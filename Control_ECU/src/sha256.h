@@ -0,0 +1,61 @@
+ /******************************************************************************
+ *
+ * Module: SHA256
+ *
+ * File Name: sha256.h
+ *
+ * Description: Header file for the SHA-256 hash tuned for the 8-bit AVR
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef SHA256_H_
+#define SHA256_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SHA256_BLOCK_SIZE          64
+#define SHA256_DIGEST_SIZE         32
+
+typedef struct {
+	uint32 state[8];
+	uint8 block[SHA256_BLOCK_SIZE];
+	uint8 blockLength;          /* Bytes waiting in block */
+	uint32 totalLength;         /* Bytes hashed so far (messages are far below 512 MB here) */
+} SHA256_ContextType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start a new hash.
+ */
+void SHA256_init(SHA256_ContextType *context);
+
+/*
+ * Description :
+ * Hash the given bytes, may be called any number of times.
+ */
+void SHA256_update(SHA256_ContextType *context, const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Pad the message, write the 32-byte digest and leave the context unusable until SHA256_init.
+ */
+void SHA256_final(SHA256_ContextType *context, uint8 *digest);
+
+/*
+ * Description :
+ * Process one 64-byte block on the given state (the compression function), exposed
+ * for the HMAC/PBKDF2 fast path and for benchmarking.
+ */
+void SHA256_compress(uint32 *state, const uint8 *block);
+
+#endif /* SHA256_H_ */
@@ -0,0 +1,74 @@
+ /******************************************************************************
+ *
+ * Module: SPECK
+ *
+ * File Name: speck.h
+ *
+ * Description: Header file for the Speck64/128 block cipher with CTR mode and CMAC
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef SPECK_H_
+#define SPECK_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SPECK_BLOCK_SIZE           8
+#define SPECK_KEY_SIZE             16
+#define SPECK_ROUNDS               27
+
+typedef struct {
+	uint32 roundKeys[SPECK_ROUNDS];
+} SPECK_KeyType;
+
+/* Expanded key and subkeys of CMAC (OMAC1) */
+typedef struct {
+	SPECK_KeyType key;
+	uint8 k1[SPECK_BLOCK_SIZE];
+	uint8 k2[SPECK_BLOCK_SIZE];
+} SPECK_CmacKeyType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Expand a 16-byte key (little-endian words, as in the Speck reference test vectors).
+ */
+void SPECK_setKey(SPECK_KeyType *key, const uint8 *keyBytes);
+
+/*
+ * Description :
+ * Encrypt one 8-byte block in place.
+ */
+void SPECK_encryptBlock(const SPECK_KeyType *key, uint8 *block);
+
+/*
+ * Description :
+ * Encrypt or decrypt (the same operation) data in CTR mode. The counter block is
+ * the 7-byte nonce followed by the block index, so up to 256 blocks per nonce.
+ */
+void SPECK_ctr(const SPECK_KeyType *key, const uint8 *nonce, uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Expand the key and compute the CMAC subkeys.
+ */
+void SPECK_cmacSetKey(SPECK_CmacKeyType *cmacKey, const uint8 *keyBytes);
+
+/*
+ * Description :
+ * Compute the CMAC of up to two concatenated buffers (the second may be NULL_PTR),
+ * the 8-byte tag is written to tag.
+ */
+void SPECK_cmac(const SPECK_CmacKeyType *cmacKey, const uint8 *data1, uint8 length1,
+		const uint8 *data2, uint8 length2, uint8 *tag);
+
+#endif /* SPECK_H_ */
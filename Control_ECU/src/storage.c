@@ -0,0 +1,40 @@
+ /******************************************************************************
+ *
+ * Module: STORAGE
+ *
+ * File Name: storage.c
+ *
+ * Description: Source file for the storage backends the persistent records are kept in
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include "storage.h"
+#include "internal_eeprom.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void STORAGE_noWait(void);
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+const STORAGE_BackendType STORAGE_internalEeprom = { IEEPROM_readBlock, IEEPROM_writeBlock, IEEPROM_waitWrites };
+const STORAGE_BackendType STORAGE_externalEeprom = { EEPROM_readBlock, EEPROM_writeBlock, STORAGE_noWait };
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * The external EEPROM writes return once the write cycle is over, nothing to wait for.
+ */
+static void STORAGE_noWait(void)
+{
+}
@@ -0,0 +1,41 @@
+ /******************************************************************************
+ *
+ * Module: STORAGE
+ *
+ * File Name: storage.h
+ *
+ * Description: Header file for the storage backends the persistent records are kept in
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef STORAGE_H_
+#define STORAGE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * A record module is configured with a backend and only calls it through these
+ * functions, so its data can be moved between the two EEPROMs with its configuration.
+ * The reads and the writes return SUCCESS or ERROR (address out of the device).
+ */
+typedef struct {
+	uint8 (*readBlock)(uint16 address, uint8 *data, uint16 length);
+	uint8 (*writeBlock)(uint16 address, const uint8 *data, uint16 length);
+	void (*waitWrites)(void);      /* Return once the written data survives a reset */
+} STORAGE_BackendType;
+
+/*
+ * Internal EEPROM: 1 KB, no bus transaction, the writes are queued and done by its ISR
+ *                  (a reset loses the queued bytes, a record must detect it like a torn write).
+ * External EEPROM: the 24Cxx over TWI, page writes that return once programmed.
+ */
+extern const STORAGE_BackendType STORAGE_internalEeprom;
+extern const STORAGE_BackendType STORAGE_externalEeprom;
+
+#endif /* STORAGE_H_ */
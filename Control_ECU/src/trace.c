@@ -0,0 +1,234 @@
+ /******************************************************************************
+ *
+ * Module: TRACE
+ *
+ * File Name: trace.c
+ *
+ * Description: Source file for the in-RAM event trace ring
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include "trace.h"
+#include "uart.h"
+#include "Macros.h"
+#include "gpio.h"     /* To use PIN7_ID (I-bit of SREG) */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+typedef struct {
+	uint16 magic;
+	uint16 bootCount;
+	uint8 head;                                      /* Index of the next free record */
+	uint8 count;                                     /* Number of valid records */
+	Trace_RecordType records[TRACE_BUFFER_SIZE];
+} Trace_BufferType;
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+/* The ring lives in .noinit so the C startup code leaves it untouched,
+ * that way a watchdog reset keeps the events that led to the hang.
+ */
+static Trace_BufferType g_traceBuffer __attribute__((section(".noinit")));
+
+static volatile uint32 g_traceTicks = 0;      /* Number of Timer1 compare matches since boot */
+static volatile uint8 g_traceState = 0;       /* Current application state */
+static Trace_ConfigType g_traceConfig;
+static volatile uint8 g_traceSuspended = FALSE;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static uint32 TRACE_getTimestamp(void);
+static uint8 TRACE_sendByte(uint8 data, uint8 checksum);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Validate the ring kept in the .noinit section, clear it if it holds garbage
+ * (power-on) and log a BOOT event so sessions can be told apart after a reset.
+ */
+void TRACE_init(const Trace_ConfigType *configPtr)
+{
+	g_traceConfig = *configPtr;
+
+	if ((g_traceBuffer.magic != TRACE_MAGIC) || (g_traceBuffer.head >= TRACE_BUFFER_SIZE)
+			|| (g_traceBuffer.count > TRACE_BUFFER_SIZE))
+	{
+		g_traceBuffer.magic = TRACE_MAGIC;
+		g_traceBuffer.bootCount = 0;
+		g_traceBuffer.head = 0;
+		g_traceBuffer.count = 0;
+	}
+
+	g_traceBuffer.bootCount++;
+	TRACE_record(TRACE_EVT_BOOT, g_traceBuffer.bootCount);
+}
+
+/*
+ * Description :
+ * Append one record to the ring, overwriting the oldest one when full.
+ * Safe to be called from an ISR.
+ */
+void TRACE_record(Trace_EventID event, uint16 arg)
+{
+	uint8 sreg = SREG;
+	uint8 last;
+	Trace_RecordType *record;
+
+	if (g_traceSuspended)
+		return;
+
+	CLEAR_BIT(SREG, PIN7_ID);      /* The ring is shared with the ISRs */
+
+	/* Fold periodic timer callbacks into one record so they do not flush the history */
+	last = (g_traceBuffer.head == 0) ? (TRACE_BUFFER_SIZE - 1) : (g_traceBuffer.head - 1);
+	record = &g_traceBuffer.records[last];
+	if ((event == TRACE_EVT_TIMER_CALLBACK) && (g_traceBuffer.count != 0)
+			&& (record->event == TRACE_EVT_TIMER_CALLBACK) && ((record->arg >> 8) == (arg >> 8)))
+	{
+		if ((record->arg & 0xFF) != 0xFF)
+		{
+			record->arg++;
+		}
+	}
+	else
+	{
+		record = &g_traceBuffer.records[g_traceBuffer.head];
+		record->timestamp = TRACE_getTimestamp();
+		record->event = event;
+		record->arg = arg;
+
+		g_traceBuffer.head = (g_traceBuffer.head + 1) % TRACE_BUFFER_SIZE;
+		if (g_traceBuffer.count < TRACE_BUFFER_SIZE)
+		{
+			g_traceBuffer.count++;
+		}
+	}
+
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Log a state transition and remember it as the current application state.
+ */
+void TRACE_setState(uint8 state)
+{
+	g_traceState = state;
+	TRACE_record(TRACE_EVT_STATE, state);
+}
+
+/*
+ * Description :
+ * Return the last state passed to TRACE_setState.
+ */
+uint8 TRACE_getState(void)
+{
+	return g_traceState;
+}
+
+/*
+ * Description :
+ * Return the time since boot in microseconds (wraps after about 71 minutes,
+ * so only differences of close timestamps are meaningful), used for benchmarks.
+ */
+uint32 TRACE_getMicroseconds(void)
+{
+	uint8 sreg = SREG;
+	uint32 timestamp;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	timestamp = TRACE_getTimestamp();
+	SREG = sreg;
+
+	return timestamp * g_traceConfig.usPerCount;
+}
+
+/*
+ * Description :
+ * Advance the trace time base, must be called from the Timer1 compare ISR.
+ */
+void TRACE_timerTick(void)
+{
+	g_traceTicks++;
+}
+
+/*
+ * Description :
+ * Send the whole ring (oldest record first) through UART as one dump frame:
+ * 'T' 'R' ecuId usPerCount bootCount(2) count records(count*7) checksum
+ */
+void TRACE_dump(void)
+{
+	uint8 i, j, index, checksum = 0;
+	const uint8 *bytePtr;
+
+	g_traceSuspended = TRUE;       /* Do not log the dump bytes themselves */
+
+	UART_sendByte(TRACE_FRAME_SYNC1);
+	UART_sendByte(TRACE_FRAME_SYNC2);
+	checksum = TRACE_sendByte(g_traceConfig.ecuId, checksum);
+	checksum = TRACE_sendByte(g_traceConfig.usPerCount, checksum);
+	checksum = TRACE_sendByte((uint8)g_traceBuffer.bootCount, checksum);
+	checksum = TRACE_sendByte((uint8)(g_traceBuffer.bootCount >> 8), checksum);
+	checksum = TRACE_sendByte(g_traceBuffer.count, checksum);
+
+	/* Oldest record is at head when the ring is full, and at index 0 otherwise */
+	index = (g_traceBuffer.count == TRACE_BUFFER_SIZE) ? g_traceBuffer.head : 0;
+	for (i = 0; i < g_traceBuffer.count; i++)
+	{
+		/* Records are packed (-fpack-struct) and little-endian, so send them as they are in RAM */
+		bytePtr = (const uint8 *)&g_traceBuffer.records[index];
+		for (j = 0; j < sizeof(Trace_RecordType); j++)
+		{
+			checksum = TRACE_sendByte(bytePtr[j], checksum);
+		}
+		index = (index + 1) % TRACE_BUFFER_SIZE;
+	}
+
+	UART_sendByte(checksum);
+
+	g_traceSuspended = FALSE;
+}
+
+/*
+ * Description :
+ * Return the number of Timer1 counts since boot.
+ */
+static uint32 TRACE_getTimestamp(void)
+{
+	uint32 ticks = g_traceTicks;
+	uint16 counts = TCNT1;
+
+	/* The counter may have wrapped while the interrupts are disabled and
+	 * the compare ISR did not run yet, so account for the pending tick
+	 */
+	if (BIT_IS_SET(TIFR, OCF1A))
+	{
+		ticks++;
+		counts = TCNT1;
+	}
+
+	return (ticks * g_traceConfig.countsPerTick) + counts;
+}
+
+/*
+ * Description :
+ * Send one byte of the dump frame and return the updated checksum.
+ */
+static uint8 TRACE_sendByte(uint8 data, uint8 checksum)
+{
+	UART_sendByte(data);
+	return (uint8)(checksum + data);
+}
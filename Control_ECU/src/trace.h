@@ -0,0 +1,118 @@
+ /******************************************************************************
+ *
+ * Module: TRACE
+ *
+ * File Name: trace.h
+ *
+ * Description: Header file for the in-RAM event trace ring
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Number of records kept in the ring (7 bytes each) */
+#define TRACE_BUFFER_SIZE              32
+
+/* 1 to also log every UART byte: a single link frame then fills the ring (off, frames are logged by the link) */
+#define TRACE_UART_BYTES               0
+
+/* Marker used to tell a valid ring from RAM garbage after power-on */
+#define TRACE_MAGIC                    0x7A5E
+
+/* Sync bytes that start every dump frame sent over the UART */
+#define TRACE_FRAME_SYNC1              'T'
+#define TRACE_FRAME_SYNC2              'R'
+
+/* ECU IDs carried in the dump frame header */
+#define TRACE_ECU_HMI                  0x01
+#define TRACE_ECU_CONTROL              0x02
+
+/* Event IDs */
+typedef enum {
+	TRACE_EVT_BOOT,             /* arg = boot counter                           */
+	TRACE_EVT_STATE,            /* arg = application state ID                   */
+	TRACE_EVT_UART_RX,          /* arg = received byte (TRACE_UART_BYTES only)  */
+	TRACE_EVT_UART_TX,          /* arg = sent byte (TRACE_UART_BYTES only)      */
+	TRACE_EVT_EEPROM_READ,      /* arg = EEPROM address                         */
+	TRACE_EVT_EEPROM_WRITE,     /* arg = EEPROM address                         */
+	TRACE_EVT_TIMER_CALLBACK,   /* arg = (timer ID << 8) | repeated call count  */
+	TRACE_EVT_RESET_CAUSE,      /* arg = (MCUCSR << 8) | stalled task           */
+	TRACE_EVT_WATCHDOG,         /* arg = (stalled task << 8) | stalled state    */
+	TRACE_EVT_UART_ERROR,       /* arg = (UART_RxStatusType << 8) | byte        */
+	TRACE_EVT_BAUD_CHANGE,      /* arg = UART_BaudType now in use               */
+	TRACE_EVT_LINK_TX,          /* arg = (frame type << 8) | payload length     */
+	TRACE_EVT_LINK_RX           /* arg = (LINK_RxEventType << 12) | (type << 8) | length */
+} Trace_EventID;
+
+typedef struct {
+	uint32 timestamp;           /* Timer1 counts since boot */
+	uint8 event;
+	uint16 arg;
+} Trace_RecordType;
+
+typedef struct {
+	uint8 ecuId;
+	uint8 usPerCount;           /* Timer1 count period in microseconds (depends on its prescaler) */
+	uint16 countsPerTick;       /* Timer1 counts between two compare interrupts */
+} Trace_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Validate the ring kept in the .noinit section, clear it if it holds garbage
+ * (power-on) and log a BOOT event so sessions can be told apart after a reset.
+ */
+void TRACE_init(const Trace_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Append one record to the ring, overwriting the oldest one when full.
+ * Safe to be called from an ISR.
+ */
+void TRACE_record(Trace_EventID event, uint16 arg);
+
+/*
+ * Description :
+ * Log a state transition and remember it as the current application state.
+ */
+void TRACE_setState(uint8 state);
+
+/*
+ * Description :
+ * Return the last state passed to TRACE_setState.
+ */
+uint8 TRACE_getState(void);
+
+/*
+ * Description :
+ * Return the time since boot in microseconds (wraps after about 71 minutes,
+ * so only differences of close timestamps are meaningful), used for benchmarks.
+ */
+uint32 TRACE_getMicroseconds(void);
+
+/*
+ * Description :
+ * Advance the trace time base, must be called from the Timer1 compare ISR.
+ */
+void TRACE_timerTick(void);
+
+/*
+ * Description :
+ * Send the whole ring (oldest record first) through UART as one dump frame:
+ * 'T' 'R' ecuId usPerCount bootCount(2) count records(count*7) checksum
+ */
+void TRACE_dump(void);
+
+#endif /* TRACE_H_ */
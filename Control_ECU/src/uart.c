@@ -12,7 +12,157 @@
 
 #include "uart.h"
 #include "avr/io.h" /* To use the UART Registers */
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "Macros.h" /* To use the macros like SET_BIT */
+#include "trace.h"  /* To log the line errors */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#if (UART_BAUD_ERROR(9600UL) > UART_BAUD_TOLERANCE)
+#error "UART: 9600 baud is out of tolerance at this F_CPU"
+#endif
+#if (UART_BAUD_ERROR(38400UL) > UART_BAUD_TOLERANCE)
+#error "UART: 38400 baud is out of tolerance at this F_CPU"
+#endif
+#if (UART_BAUD_ERROR(76800UL) > UART_BAUD_TOLERANCE)
+#error "UART: 76800 baud is out of tolerance at this F_CPU"
+#endif
+#if (UART_BAUD_ERROR(125000UL) > UART_BAUD_TOLERANCE)
+#error "UART: 125000 baud is out of tolerance at this F_CPU"
+#endif
+#if (UART_BAUD_ERROR(250000UL) > UART_BAUD_TOLERANCE)
+#error "UART: 250000 baud is out of tolerance at this F_CPU"
+#endif
+
+#if ((UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0) || (UART_RX_BUFFER_SIZE > 128)
+#error "UART: UART_RX_BUFFER_SIZE must be a power of two up to 128"
+#endif
+#define UART_RX_INDEX_MASK         (UART_RX_BUFFER_SIZE - 1)
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void UART_countError(uint16 *counter);
+static void UART_sendWord(uint16 value);
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static UART_ErrorCountersType g_uartErrors = { 0, 0, 0, 0 };
+static volatile uint8 g_uartTxStarted = FALSE;     /* A byte was written since the last baud rate change */
+
+/* Asynchronous transmission, shared with the UDRE and TXC interrupts */
+static UART_SegmentType g_uartTxSegments[UART_MAX_SEGMENTS];
+static volatile uint8 g_uartTxSegmentCount = 0;
+static volatile uint8 g_uartTxSegmentIndex = 0;
+static volatile uint8 g_uartTxIndex = 0;           /* Next byte of the current segment */
+static volatile uint8 g_uartTxBusy = FALSE;
+static void (*volatile g_uartTxCallBackPtr)(void) = NULL_PTR;
+
+/* Received bytes and their UART_RxStatusType, written by the RXC interrupt only (head) and read
+ * by UART_readByte only (tail): one byte indexes, no critical section is needed */
+static volatile uint8 g_uartRxData[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_uartRxStatus[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_uartRxHead = 0;
+static volatile uint8 g_uartRxTail = 0;
+static volatile uint8 g_uartRxDropped = FALSE;     /* The buffer was full, the next byte is an overrun */
+
+/* UBRR of every UART_BaudType, computed by the compiler */
+static const uint16 g_uartUbrr[UART_BAUD_COUNT] PROGMEM = {
+	UART_UBRR(9600UL), UART_UBRR(38400UL), UART_UBRR(76800UL), UART_UBRR(125000UL), UART_UBRR(250000UL)
+};
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/*
+ * A byte is received: keep it with the line status of its flags (read before UDR), the
+ * errors are counted by UART_readByte. A full buffer drops the byte, like a DOR.
+ */
+ISR(USART_RXC_vect)
+{
+	uint8 flags = UCSRA;
+	uint8 data = UDR;
+	uint8 head = (g_uartRxHead + 1) & UART_RX_INDEX_MASK;
+	UART_RxStatusType status = UART_RX_OK;
+
+	if (head == g_uartRxTail)
+	{
+		g_uartRxDropped = TRUE;
+		return;
+	}
+
+	if (BIT_IS_SET(flags,FE))
+	{
+		/* A break holds the line low: all data bits and the stop bit read 0 */
+		status = (data == 0) ? UART_RX_BREAK : UART_RX_FRAME_ERROR;
+	}
+	else if (BIT_IS_SET(flags,PE))
+	{
+		status = UART_RX_PARITY_ERROR;
+	}
+	else if (BIT_IS_SET(flags,DOR) || g_uartRxDropped)
+	{
+		status = UART_RX_OVERRUN;
+	}
+	g_uartRxDropped = FALSE;
+
+	g_uartRxData[g_uartRxHead] = data;
+	g_uartRxStatus[g_uartRxHead] = status;
+	g_uartRxHead = head;
+}
+
+/*
+ * UDR is empty: write the next byte of the asynchronous transmission, after the last one
+ * wait for the TXC interrupt instead.
+ */
+ISR(USART_UDRE_vect)
+{
+	uint8 data;
+
+	/* Zero-length segments are skipped */
+	while (g_uartTxIndex == g_uartTxSegments[g_uartTxSegmentIndex].length)
+	{
+		g_uartTxIndex = 0;
+		g_uartTxSegmentIndex++;
+		if (g_uartTxSegmentIndex == g_uartTxSegmentCount)
+		{
+			CLEAR_BIT(UCSRB,UDRIE);
+			SET_BIT(UCSRB,TXCIE);
+			return;
+		}
+	}
+
+	data = g_uartTxSegments[g_uartTxSegmentIndex].data[g_uartTxIndex];
+	g_uartTxIndex++;
+	UCSRA = (1 << U2X) | (1 << TXC);          /* TXC only rises after the last byte */
+	g_uartTxStarted = TRUE;
+	UDR = data;
+#if TRACE_UART_BYTES
+	TRACE_record(TRACE_EVT_UART_TX, data);
+#endif
+}
+
+/*
+ * The last stop bit is out (the TXC flag is cleared by the hardware here).
+ */
+ISR(USART_TXC_vect)
+{
+	CLEAR_BIT(UCSRB,TXCIE);
+	g_uartTxStarted = FALSE;
+	g_uartTxBusy = FALSE;
+
+	if (g_uartTxCallBackPtr != NULL_PTR)
+	{
+		(*g_uartTxCallBackPtr)();
+	}
+}
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -32,7 +182,7 @@ void UART_init(const UART_ConfigType *configPtr)
 	UCSRA = (1 << U2X);       /* U2X = 1 for double transmission speed */
 
 	/************************** UCSRB Description **************************
-	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
+	 * RXCIE = 1 Enable USART RX Complete Interrupt, the bytes are buffered
 	 * TXCIE = 0 Disable USART Tx Complete Interrupt Enable
 	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable
 	 * RXEN  = 1 Receiver Enable
@@ -41,7 +191,10 @@ void UART_init(const UART_ConfigType *configPtr)
 	 * RXB8 & TXB8 used for 9-bit data mode only
 	 ***********************************************************************/
 
-	UCSRB = (1 << RXEN) | (1 << TXEN);
+	g_uartRxHead = 0;
+	g_uartRxTail = 0;
+	g_uartRxDropped = FALSE;
+	UCSRB = (1 << RXCIE) | (1 << RXEN) | (1 << TXEN);
 
 	/************************** UCSRC Description **************************
 	 * URSEL   = 1 The URSEL must be one when writing the UCSRC
@@ -58,12 +211,47 @@ void UART_init(const UART_ConfigType *configPtr)
 	UCSRC |= (UCSRC & 0xF7) | (configPtr->stopBits << USBS);
 	UCSRC |= (UCSRC & 0xF9) | (configPtr->dataBits << UCSZ0);
 
-	/* Calculate the UBRR register value */
-	ubrr_value = (uint16)(((F_CPU/(8UL * configPtr->BaudRate)) - 1));
+	/* The UBRR register value comes from the table, no division at run time */
+	ubrr_value = pgm_read_word(&g_uartUbrr[configPtr->baud]);
 
 	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
 	UBRRL = ubrr_value;
 	UBRRH = ubrr_value >> 8;
+	g_uartTxStarted = FALSE;
+}
+
+/*
+ * Description :
+ * Change the baud rate once the bytes already written are shifted out, the bytes
+ * received at the previous rate are dropped.
+ */
+void UART_setBaud(UART_BaudType baud)
+{
+	uint16 ubrr_value = pgm_read_word(&g_uartUbrr[baud]);
+	uint8 data;
+
+	/* TXC is set once the last byte left the shift register with nothing more in UDR */
+	while(g_uartTxBusy);
+	if (g_uartTxStarted)
+	{
+		while(BIT_IS_CLEAR(UCSRA,UDRE));
+		while(BIT_IS_CLEAR(UCSRA,TXC));
+	}
+
+	/* UBRRH is written first, UBRRL updates the prescaler at once */
+	CLEAR_BIT(UCSRB,RXCIE);
+	UBRRH = ubrr_value >> 8;
+	UBRRL = ubrr_value;
+	g_uartTxStarted = FALSE;
+
+	while(BIT_IS_SET(UCSRA,RXC))
+	{
+		data = UDR;
+	}
+	(void)data;
+	g_uartRxTail = g_uartRxHead;
+	g_uartRxDropped = FALSE;
+	SET_BIT(UCSRB,RXCIE);
 }
 
 
@@ -73,16 +261,25 @@ void UART_init(const UART_ConfigType *configPtr)
  */
 void UART_sendByte(const uint8 data)
 {
+	while(g_uartTxBusy);
+
 	/* UDRE flag is set when the Tx buffer (UDR) is empty and ready for transmitting a new byte
 	 * So wait until this flag is set to one
 	 */
 	while(BIT_IS_CLEAR(UCSRA,UDRE));
 
+	/* Clear TXC (written one, FE DOR PE written zero) so UART_setBaud waits for this byte */
+	UCSRA = (1 << U2X) | (1 << TXC);
+	g_uartTxStarted = TRUE;
+
 	/* This Code:
 	 * Puts the required data in the UDR register
 	 * Clears the UDRE flag as the UDR register is not empty now
 	 */
 	UDR = data;
+#if TRACE_UART_BYTES
+	TRACE_record(TRACE_EVT_UART_TX, data);
+#endif
 
 	/************************* Another Method *************************
 	UDR = data;
@@ -91,20 +288,163 @@ void UART_sendByte(const uint8 data)
 	*******************************************************************/
 }
 
+/*
+ * Description :
+ * Send a buffer from the UDRE interrupt without copying it, the buffer must not change
+ * until the call back (may be NULL_PTR) runs from the TXC interrupt once the last stop bit
+ * is out. It waits for the end of the previous asynchronous transmission, if any.
+ */
+void UART_sendAsync(const uint8 *data, uint8 length, void (*a_ptr)(void))
+{
+	UART_SegmentType segment;
+
+	segment.data = data;
+	segment.length = length;
+	UART_sendGatherAsync(&segment, 1, a_ptr);
+}
+
+/*
+ * Description :
+ * Same as UART_sendAsync for up to UART_MAX_SEGMENTS buffers sent one after the other
+ * (a header, a payload and a tag kept apart), the descriptors are copied, not the data.
+ */
+void UART_sendGatherAsync(const UART_SegmentType *segments, uint8 count, void (*a_ptr)(void))
+{
+	uint16 total = 0;
+	uint8 i;
+
+	while(g_uartTxBusy);
+
+	if (count > UART_MAX_SEGMENTS)
+	{
+		count = UART_MAX_SEGMENTS;
+	}
+	for (i = 0; i < count; i++)
+	{
+		g_uartTxSegments[i] = segments[i];
+		total += segments[i].length;
+	}
+	g_uartTxSegmentCount = count;
+	g_uartTxSegmentIndex = 0;
+	g_uartTxIndex = 0;
+	g_uartTxCallBackPtr = a_ptr;
+
+	/* Without a byte to send there would be no TXC interrupt */
+	if (total == 0)
+	{
+		if (a_ptr != NULL_PTR)
+		{
+			(*a_ptr)();
+		}
+		return;
+	}
+
+	/* The UDRE interrupt fires at once, UDR is empty or becomes so after the current byte */
+	g_uartTxBusy = TRUE;
+	SET_BIT(UCSRB,UDRIE);
+}
+
+/*
+ * Description :
+ * Return TRUE until the last stop bit of the asynchronous transmission is out.
+ */
+uint8 UART_isTxBusy(void)
+{
+	return g_uartTxBusy;
+}
+
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * The corrupted bytes are dropped, it waits for the next valid one.
  */
 uint8 UART_recieveByte(void)
 {
-	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
-	while(BIT_IS_CLEAR(UCSRA,RXC));
+	uint8 data;
 
-	/*
-	 * Read the received data from the Rx buffer (UDR)
-	 * The RXC flag will be cleared after read the data
-	 */
-    return UDR;		
+	while(UART_readByte(&data) > UART_RX_OVERRUN);
+	return data;
+}
+
+/*
+ * Description :
+ * Wait for a byte of the receive buffer and check its line errors (read by the RXC
+ * interrupt before the byte itself), they are counted and traced. A caller parsing frames
+ * must restart its parser on any result other than UART_RX_OK, so a corrupted byte costs one frame.
+ */
+UART_RxStatusType UART_readByte(uint8 *data)
+{
+	UART_RxStatusType status;
+
+	/* The RXC interrupt moves the head once the byte and its status are stored */
+	while(g_uartRxTail == g_uartRxHead);
+
+	*data = g_uartRxData[g_uartRxTail];
+	status = (UART_RxStatusType)g_uartRxStatus[g_uartRxTail];
+	g_uartRxTail = (g_uartRxTail + 1) & UART_RX_INDEX_MASK;
+
+	switch (status)
+	{
+	case UART_RX_BREAK:
+		UART_countError(&g_uartErrors.breaks);
+		break;
+	case UART_RX_FRAME_ERROR:
+		UART_countError(&g_uartErrors.frameErrors);
+		break;
+	case UART_RX_PARITY_ERROR:
+		UART_countError(&g_uartErrors.parityErrors);
+		break;
+	case UART_RX_OVERRUN:
+		UART_countError(&g_uartErrors.overruns);
+		break;
+	default:
+		break;
+	}
+
+	if (status != UART_RX_OK)
+	{
+		TRACE_record(TRACE_EVT_UART_ERROR, ((uint16)status << 8) | *data);
+	}
+#if TRACE_UART_BYTES
+	else
+	{
+		TRACE_record(TRACE_EVT_UART_RX, *data);
+	}
+#endif
+	return status;
+}
+
+/*
+ * Description :
+ * Copy the line error counters.
+ */
+void UART_getErrorCounters(UART_ErrorCountersType *counters)
+{
+	*counters = g_uartErrors;
+}
+
+/*
+ * Description :
+ * Send the line error counters through UART, all values are little-endian:
+ * 'U' 'E' overruns(2) frameErrors(2) parityErrors(2) breaks(2)
+ */
+void UART_sendErrorReport(void)
+{
+	UART_sendByte(UART_REPORT_SYNC1);
+	UART_sendByte(UART_REPORT_SYNC2);
+	UART_sendWord(g_uartErrors.overruns);
+	UART_sendWord(g_uartErrors.frameErrors);
+	UART_sendWord(g_uartErrors.parityErrors);
+	UART_sendWord(g_uartErrors.breaks);
+}
+
+/*
+ * Description :
+ * Check without blocking if a received byte is waiting in the receive buffer.
+ */
+uint8 UART_isByteReceived(void)
+{
+	return (g_uartRxTail != g_uartRxHead) ? TRUE : FALSE;
 }
 
 /*
@@ -152,4 +492,16 @@ void UART_receiveString(uint8 *Str)
 	Str[i] = '\0';
 }
 
+static void UART_countError(uint16 *counter)
+{
+	if (*counter != 0xFFFF)
+	{
+		(*counter)++;
+	}
+}
 
+static void UART_sendWord(uint16 value)
+{
+	UART_sendByte((uint8)value);
+	UART_sendByte((uint8)(value >> 8));
+}
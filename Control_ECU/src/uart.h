@@ -18,6 +18,26 @@
  *                                Definitions                                  *
  *******************************************************************************/
 
+/*
+ * UBRR of a baud rate in double speed mode (U2X = 1), rounded to the nearest value, and
+ * its error in permille. Both are integer constant expressions, usable by #if: the
+ * supported rates are checked against UART_BAUD_TOLERANCE when uart.c is compiled.
+ */
+#define UART_UBRR(baud)            ((((F_CPU) / 8UL) + ((baud) / 2UL)) / (baud) - 1UL)
+#define UART_ACTUAL_BAUD(baud)     ((F_CPU) / (8UL * (UART_UBRR(baud) + 1UL)))
+#define UART_BAUD_ERROR(baud)      ((UART_ACTUAL_BAUD(baud) > (baud)) ? \
+                                    ((UART_ACTUAL_BAUD(baud) - (baud)) * 1000UL / (baud)) : \
+                                    (((baud) - UART_ACTUAL_BAUD(baud)) * 1000UL / (baud)))
+#define UART_BAUD_TOLERANCE        20        /* Permille, like the 2% default of <util/setbaud.h> */
+
+/*
+ * Supported baud rates, from the slowest. At 8 MHz 57600 (+2.1%) and 115200 (-3.5%) are
+ * out of tolerance, 76800, 125000 and 250000 are the fast rates with a low error.
+ */
+typedef enum {
+	UART_BAUD_9600, UART_BAUD_38400, UART_BAUD_76800, UART_BAUD_125000, UART_BAUD_250000, UART_BAUD_COUNT
+} UART_BaudType;
+
 typedef enum {
 	NO_PARITY, EVEN_PARITY = 2, ODD_PARITY
 } UART_ParityMode;
@@ -30,8 +50,43 @@ typedef enum {
 	DATA_FIVE, DATA_SIX, DATA_SEVEN, DATA_EIGHT
 } UART_CharacterSize;
 
+/* Result of a received byte, the byte is only valid with UART_RX_OK and UART_RX_OVERRUN */
+typedef enum {
+	UART_RX_OK,
+	UART_RX_OVERRUN,           /* Bytes were lost before this one (DOR or full buffer), it is valid */
+	UART_RX_FRAME_ERROR,       /* No stop bit (FE), the byte is dropped                            */
+	UART_RX_PARITY_ERROR,      /* Wrong parity bit (PE, only with a parity mode), the byte is dropped */
+	UART_RX_BREAK              /* Line held low for a whole character (FE with 0x00), dropped      */
+} UART_RxStatusType;
+
+/* Line errors counted since the reset, they stop at 0xFFFF */
+typedef struct {
+	uint16 overruns;
+	uint16 frameErrors;
+	uint16 parityErrors;
+	uint16 breaks;
+} UART_ErrorCountersType;
+
+/* Sync bytes that start the line errors report sent over the UART */
+#define UART_REPORT_SYNC1          'U'
+#define UART_REPORT_SYNC2          'E'
+
+/* One buffer of a scatter/gather transmission, sent in place (not copied) */
 typedef struct {
-	uint32 BaudRate;
+	const uint8 *data;
+	uint8 length;
+} UART_SegmentType;
+
+#define UART_MAX_SEGMENTS          4         /* Segments of one UART_sendGatherAsync */
+
+/*
+ * Bytes kept by the RXC interrupt until they are read (a power of two). At 250000 baud a
+ * byte arrives every 40us, two link frames of 33 bytes are held while one is checked.
+ */
+#define UART_RX_BUFFER_SIZE        64
+
+typedef struct {
+	UART_BaudType baud;
 	UART_CharacterSize dataBits;
 	UART_ParityMode parity;
 	UART_StopBitSelect stopBits;
@@ -50,18 +105,75 @@ typedef struct {
  */
 void UART_init(const UART_ConfigType *configPtr);
 
+/*
+ * Description :
+ * Change the baud rate once the bytes already written are shifted out, the bytes
+ * received at the previous rate (buffered or not) are dropped.
+ */
+void UART_setBaud(UART_BaudType baud);
+
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
+ * It waits for the end of an asynchronous transmission first, the bytes keep their order.
  */
 void UART_sendByte(const uint8 data);
 
+/*
+ * Description :
+ * Send a buffer from the UDRE interrupt without copying it, the buffer must not change
+ * until the call back (may be NULL_PTR) runs from the TXC interrupt once the last stop bit
+ * is out. It waits for the end of the previous asynchronous transmission, if any.
+ */
+void UART_sendAsync(const uint8 *data, uint8 length, void (*a_ptr)(void));
+
+/*
+ * Description :
+ * Same as UART_sendAsync for up to UART_MAX_SEGMENTS buffers sent one after the other
+ * (a header, a payload and a tag kept apart), the descriptors are copied, not the data.
+ */
+void UART_sendGatherAsync(const UART_SegmentType *segments, uint8 count, void (*a_ptr)(void));
+
+/*
+ * Description :
+ * Return TRUE until the last stop bit of the asynchronous transmission is out.
+ */
+uint8 UART_isTxBusy(void);
+
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * The corrupted bytes are dropped, it waits for the next valid one.
  */
 uint8 UART_recieveByte(void);
 
+/*
+ * Description :
+ * Wait for a byte of the receive buffer and check its line errors (read by the RXC
+ * interrupt before the byte itself), they are counted and traced. A caller parsing frames
+ * must restart its parser on any result other than UART_RX_OK, so a corrupted byte costs one frame.
+ */
+UART_RxStatusType UART_readByte(uint8 *data);
+
+/*
+ * Description :
+ * Copy the line error counters.
+ */
+void UART_getErrorCounters(UART_ErrorCountersType *counters);
+
+/*
+ * Description :
+ * Send the line error counters through UART, all values are little-endian:
+ * 'U' 'E' overruns(2) frameErrors(2) parityErrors(2) breaks(2)
+ */
+void UART_sendErrorReport(void);
+
+/*
+ * Description :
+ * Check without blocking if a received byte is waiting in the receive buffer.
+ */
+uint8 UART_isByteReceived(void);
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
@@ -0,0 +1,159 @@
+ /******************************************************************************
+ *
+ * Module: WATCHDOG
+ *
+ * File Name: watchdog.c
+ *
+ * Description: Source file for the watchdog supervision driver
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include "watchdog.h"
+#include "trace.h"
+#include "uart.h"
+#include "gpio.h"
+#include "Macros.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+typedef struct {
+	uint16 magic;
+	uint8 stalledTask;
+	uint8 stalledState;
+} WDG_StashType;
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+/* Written just before a forced reset, read back by WDG_init after the reboot */
+static WDG_StashType g_wdgStash __attribute__((section(".noinit")));
+
+static WDG_ResetReportType g_wdgReport;
+static WDG_ConfigType g_wdgConfig;
+static volatile uint8 g_wdgCheckedIn = 0;             /* One bit per task */
+static uint8 g_wdgMissedPeriods[WDG_MAX_TASKS];
+static volatile uint8 g_wdgResetPending = FALSE;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * 1. Capture the reset cause from MCUCSR and the hang location stashed before the reset.
+ * 2. Start the hardware watchdog.
+ */
+void WDG_init(const WDG_ConfigType *configPtr)
+{
+	uint8 task;
+
+	g_wdgReport.resetCause = MCUCSR;
+	MCUCSR = 0;                        /* Clear the flags so the next reset cause is not mixed with this one */
+
+	/* The stash is only meaningful if the watchdog did the reset (the RAM was kept) */
+	if (BIT_IS_SET(g_wdgReport.resetCause, WDRF) && (g_wdgStash.magic == WDG_MAGIC))
+	{
+		g_wdgReport.stalledTask = g_wdgStash.stalledTask;
+		g_wdgReport.stalledState = g_wdgStash.stalledState;
+	}
+	else
+	{
+		g_wdgReport.stalledTask = WDG_NO_TASK;
+		g_wdgReport.stalledState = 0;
+	}
+	g_wdgStash.magic = 0;
+
+	TRACE_record(TRACE_EVT_RESET_CAUSE,
+			((uint16)g_wdgReport.resetCause << 8) | g_wdgReport.stalledTask);
+
+	g_wdgConfig = *configPtr;
+	if (g_wdgConfig.numberOfTasks > WDG_MAX_TASKS)
+	{
+		g_wdgConfig.numberOfTasks = WDG_MAX_TASKS;
+	}
+	for (task = 0; task < WDG_MAX_TASKS; task++)
+	{
+		g_wdgMissedPeriods[task] = 0;
+	}
+
+	wdt_enable(WDG_HW_TIMEOUT);
+}
+
+/*
+ * Description :
+ * Report that the given task is still alive, must be called more often than its timeout.
+ */
+void WDG_checkIn(uint8 task)
+{
+	uint8 sreg = SREG;
+
+	CLEAR_BIT(SREG, PIN7_ID);      /* The mask is cleared by the supervisor ISR */
+	SET_BIT(g_wdgCheckedIn, task);
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Check the tasks, must be called every supervision period (1 second) from the timer ISR.
+ * The hardware watchdog is only kicked while all the tasks keep checking in, otherwise the
+ * stalled task and state are stashed in .noinit memory and the MCU is reset.
+ */
+void WDG_supervise(void)
+{
+	uint8 task;
+
+	if (g_wdgResetPending)
+		return;                    /* Stop kicking, the reset is on its way */
+
+	for (task = 0; task < g_wdgConfig.numberOfTasks; task++)
+	{
+		if (BIT_IS_SET(g_wdgCheckedIn, task))
+		{
+			g_wdgMissedPeriods[task] = 0;
+		}
+		else if (++g_wdgMissedPeriods[task] >= g_wdgConfig.taskTimeout[task])
+		{
+			/* Stash where the application got stuck, then let the watchdog reset the MCU quickly */
+			g_wdgStash.magic = WDG_MAGIC;
+			g_wdgStash.stalledTask = task;
+			g_wdgStash.stalledState = TRACE_getState();
+			TRACE_record(TRACE_EVT_WATCHDOG, ((uint16)task << 8) | g_wdgStash.stalledState);
+
+			g_wdgResetPending = TRUE;
+			wdt_enable(WDTO_15MS);
+			return;
+		}
+	}
+
+	g_wdgCheckedIn = 0;
+	wdt_reset();
+}
+
+/*
+ * Description :
+ * Return the reset cause and hang location captured at boot.
+ */
+const WDG_ResetReportType* WDG_getResetReport(void)
+{
+	return &g_wdgReport;
+}
+
+/*
+ * Description :
+ * Send the reset report through UART: 'W' 'D' resetCause stalledTask stalledState
+ */
+void WDG_sendResetReport(void)
+{
+	UART_sendByte(WDG_REPORT_SYNC1);
+	UART_sendByte(WDG_REPORT_SYNC2);
+	UART_sendByte(g_wdgReport.resetCause);
+	UART_sendByte(g_wdgReport.stalledTask);
+	UART_sendByte(g_wdgReport.stalledState);
+}
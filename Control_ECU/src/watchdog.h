@@ -0,0 +1,84 @@
+ /******************************************************************************
+ *
+ * Module: WATCHDOG
+ *
+ * File Name: watchdog.h
+ *
+ * Description: Header file for the watchdog supervision driver
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define WDG_MAX_TASKS              4
+
+/* Hardware watchdog period, it must be longer than the supervision period (1 second) */
+#define WDG_HW_TIMEOUT             WDTO_2S
+
+/* Marker of a valid hang report in the .noinit section */
+#define WDG_MAGIC                  0xD09E
+
+#define WDG_NO_TASK                0xFF
+
+/* Sync bytes that start the reset report sent over the UART */
+#define WDG_REPORT_SYNC1           'W'
+#define WDG_REPORT_SYNC2           'D'
+
+typedef struct {
+	uint8 numberOfTasks;
+	uint8 taskTimeout[WDG_MAX_TASKS];     /* Supervision periods allowed between two check-ins of each task */
+} WDG_ConfigType;
+
+typedef struct {
+	uint8 resetCause;      /* MCUCSR flags captured at boot (PORF, EXTRF, BORF, WDRF, JTRF) */
+	uint8 stalledTask;     /* WDG_NO_TASK unless the reset was forced because a task stopped checking in */
+	uint8 stalledState;    /* Application state (TRACE_getState) when the stall was detected */
+} WDG_ResetReportType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * 1. Capture the reset cause from MCUCSR and the hang location stashed before the reset.
+ * 2. Start the hardware watchdog.
+ */
+void WDG_init(const WDG_ConfigType *configPtr);
+
+/*
+ * Description :
+ * Report that the given task is still alive, must be called more often than its timeout.
+ */
+void WDG_checkIn(uint8 task);
+
+/*
+ * Description :
+ * Check the tasks, must be called every supervision period (1 second) from the timer ISR.
+ * The hardware watchdog is only kicked while all the tasks keep checking in, otherwise the
+ * stalled task and state are stashed in .noinit memory and the MCU is reset.
+ */
+void WDG_supervise(void);
+
+/*
+ * Description :
+ * Return the reset cause and hang location captured at boot.
+ */
+const WDG_ResetReportType* WDG_getResetReport(void);
+
+/*
+ * Description :
+ * Send the reset report through UART: 'W' 'D' resetCause stalledTask stalledState
+ */
+void WDG_sendResetReport(void);
+
+#endif /* WATCHDOG_H_ */
@@ -5,34 +5,58 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../src/HMI_Application.c \
+../src/baud.c \
 ../src/gpio.c \
+../src/heartbeat.c \
+../src/hmi_screens.c \
 ../src/keypad.c \
 ../src/lcd.c \
+../src/link.c \
+../src/ram_monitor.c \
+../src/speck.c \
 ../src/timer.c \
-../src/uart.c 
+../src/trace.c \
+../src/uart.c \
+../src/watchdog.c 
 
 OBJS += \
 ./src/HMI_Application.o \
+./src/baud.o \
 ./src/gpio.o \
+./src/heartbeat.o \
+./src/hmi_screens.o \
 ./src/keypad.o \
 ./src/lcd.o \
+./src/link.o \
+./src/ram_monitor.o \
+./src/speck.o \
 ./src/timer.o \
-./src/uart.o 
+./src/trace.o \
+./src/uart.o \
+./src/watchdog.o 
 
 C_DEPS += \
 ./src/HMI_Application.d \
+./src/baud.d \
 ./src/gpio.d \
+./src/heartbeat.d \
+./src/hmi_screens.d \
 ./src/keypad.d \
 ./src/lcd.d \
+./src/link.d \
+./src/ram_monitor.d \
+./src/speck.d \
 ./src/timer.d \
-./src/uart.d 
+./src/trace.d \
+./src/uart.d \
+./src/watchdog.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.c src/subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: AVR Compiler'
-	avr-gcc -Wall -g2 -gstabs -O0 -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
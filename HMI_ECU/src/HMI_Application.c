@@ -10,136 +10,324 @@
  *
  *******************************************************************************/
 
-#include <util/delay.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
 #include "HMI_Application.h"
 #include "keypad.h"
 #include "lcd.h"
+#include "hmi_screens.h"
 #include "timer.h"
 #include "uart.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "ram_monitor.h"
+#include "link.h"
+#include "heartbeat.h"
+#include "baud.h"
 #include "Macros.h"
 
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void HMI_resetPasswordInput(void);
+static void HMI_showResetReport(void);
+static uint8 HMI_selectOpenDoor(uint8 next);
+static uint8 HMI_selectChangePassword(uint8 next);
+static uint8 HMI_sendCommand(uint8 next);
+static uint8 HMI_sendAccessCode(uint8 next);
+static uint8 HMI_selectUserAdd(uint8 next);
+static uint8 HMI_selectUserRevoke(uint8 next);
+static uint8 HMI_selectUserList(uint8 next);
+static uint8 HMI_saveAdminPassword(uint8 next);
+static uint8 HMI_saveUserId(uint8 next);
+static uint8 HMI_sendUserRequest(uint8 next);
+static void HMI_showUserResult(void);
+static void HMI_showUserCount(void);
+static uint8 HMI_selectPasswordCreation(uint8 next);
+static uint8 HMI_saveNewPassword(uint8 next);
+static uint8 HMI_checkConfirmation(uint8 next);
+static uint8 HMI_sendReadyToSend(uint8 next);
+static uint8 HMI_sendReadyToReceive(uint8 next);
+static uint8 HMI_sendPassword(uint8 next);
+static void HMI_requestSystemStatus(void);
+static void HMI_showLockoutTime(void);
+static void HMI_loadDoorPeriod(void);
+static uint8 HMI_updateLockoutTime(uint8 next);
+static uint8 HMI_followDoor(uint8 next);
+static void HMI_showDoorProgress(void);
+static uint8 HMI_sendTraceDump(uint8 next);
+static uint8 HMI_sendResetReport(uint8 next);
+static uint8 HMI_sendRamReport(uint8 next);
+static uint8 HMI_sendLinkBenchmark(uint8 next);
+static uint8 HMI_sendLineErrors(uint8 next);
+static uint8 HMI_sendHeartbeatReport(uint8 next);
+
+/*******************************************************************************
+ *                           UI Tables                                         *
+ *******************************************************************************/
+
+/* Indexed by HMI_StateID, stored in flash and read with memcpy_P */
+static const HMI_StateConfigType g_hmiStates[HMI_STATE_COUNT] PROGMEM = {
+	/* screen                    flags                    timeout                                   timeoutNext               entryAction */
+	{ SCREEN_MAIN_MENU,          0,                       0,                                        0,                        NULL_PTR               },  /* MAIN_MENU          */
+	{ SCREEN_ENTER_PASSWORD,     HMI_FLAG_PASSWORD_INPUT, 0,                                        0,                        HMI_resetPasswordInput },  /* ENTER_PASSWORD     */
+	{ SCREEN_NEW_PASSWORD,       HMI_FLAG_PASSWORD_INPUT, 0,                                        0,                        HMI_resetPasswordInput },  /* NEW_PASSWORD       */
+	{ HMI_NO_SCREEN,             HMI_FLAG_PEER_WAIT,      0,                                        0,                        NULL_PTR               },  /* WAIT_NEW_READY     */
+	{ SCREEN_CONFIRM_PASSWORD,   HMI_FLAG_PASSWORD_INPUT, 0,                                        0,                        HMI_resetPasswordInput },  /* CONFIRM_PASSWORD   */
+	{ HMI_NO_SCREEN,             HMI_FLAG_PEER_WAIT,      0,                                        0,                        NULL_PTR               },  /* WAIT_CONFIRM_READY */
+	{ HMI_NO_SCREEN,             HMI_FLAG_PEER_WAIT,      0,                                        0,                        NULL_PTR               },  /* WAIT_MATCH_READY   */
+	{ HMI_NO_SCREEN,             HMI_FLAG_PEER_WAIT,      0,                                        0,                        NULL_PTR               },  /* WAIT_MATCH_STATUS  */
+	{ HMI_NO_SCREEN,             HMI_FLAG_PEER_WAIT,      0,                                        0,                        NULL_PTR               },  /* WAIT_RESPONSE      */
+	{ SCREEN_DOOR_UNLOCKING,     HMI_FLAG_PEER_BUSY,      0,                                        HMI_STATE_DOOR_OPEN,      HMI_loadDoorPeriod     },  /* DOOR_UNLOCKING     */
+	{ SCREEN_DOOR_OPEN,          HMI_FLAG_PEER_BUSY,      0,                                        HMI_STATE_DOOR_LOCKING,   HMI_loadDoorPeriod     },  /* DOOR_OPEN          */
+	{ SCREEN_DOOR_LOCKING,       HMI_FLAG_PEER_BUSY,      0,                                        HMI_STATE_MAIN_MENU,      HMI_loadDoorPeriod     },  /* DOOR_LOCKING       */
+	{ SCREEN_WRONG_PASSWORD,     0,                       HMI_MS_TO_TICKS(MESSAGE_DISPLAY_DELAY),   HMI_STATE_MAIN_MENU,      NULL_PTR               },  /* WRONG_PASSWORD     */
+	{ SCREEN_PASSWORD_MISMATCH,  0,                       HMI_MS_TO_TICKS(MESSAGE_DISPLAY_DELAY),   HMI_STATE_NEW_PASSWORD,   NULL_PTR               },  /* PASSWORD_MISMATCH  */
+	{ SCREEN_KEYPAD_LOCKED,      0,                       0,                                        0,                        HMI_showLockoutTime    },  /* KEYPAD_LOCKED      */
+	{ HMI_NO_SCREEN,             0,                       HMI_MS_TO_TICKS(MESSAGE_DISPLAY_DELAY),   HMI_STATE_WAIT_SYSTEM_STATUS, HMI_showResetReport },  /* RESET_REPORT       */
+	{ SCREEN_PLEASE_WAIT,        0,                       HMI_MS_TO_TICKS(SYSTEM_STATUS_RETRY_PERIOD), HMI_STATE_WAIT_SYSTEM_STATUS, HMI_requestSystemStatus },  /* WAIT_SYSTEM_STATUS */
+	{ SCREEN_ENTER_CODE,         HMI_FLAG_CODE_INPUT,     0,                                        0,                        HMI_resetPasswordInput },  /* ENTER_CODE         */
+	{ SCREEN_CODE_UNAVAILABLE,   0,                       HMI_MS_TO_TICKS(MESSAGE_DISPLAY_DELAY),   HMI_STATE_MAIN_MENU,      NULL_PTR               },  /* CODE_UNAVAILABLE   */
+	{ SCREEN_USER_MENU,          0,                       0,                                        0,                        NULL_PTR               },  /* USER_MENU          */
+	{ SCREEN_ADMIN_PASSWORD,     HMI_FLAG_PASSWORD_INPUT, 0,                                        0,                        HMI_resetPasswordInput },  /* ADMIN_PASSWORD     */
+	{ SCREEN_USER_ID,            HMI_FLAG_ID_INPUT,       0,                                        0,                        HMI_resetPasswordInput },  /* USER_ID            */
+	{ SCREEN_USER_CODE,          HMI_FLAG_PASSWORD_INPUT, 0,                                        0,                        HMI_resetPasswordInput },  /* USER_CODE          */
+	{ HMI_NO_SCREEN,             HMI_FLAG_PEER_WAIT,      0,                                        0,                        NULL_PTR               },  /* WAIT_USER_RESULT   */
+	{ HMI_NO_SCREEN,             0,                       HMI_MS_TO_TICKS(MESSAGE_DISPLAY_DELAY),   HMI_STATE_MAIN_MENU,      HMI_showUserResult     },  /* USER_RESULT        */
+	{ HMI_NO_SCREEN,             0,                       HMI_MS_TO_TICKS(MESSAGE_DISPLAY_DELAY),   HMI_STATE_MAIN_MENU,      HMI_showUserCount      },  /* USER_COUNT         */
+	{ SCREEN_CONTROLLER_OFFLINE, 0,                       HMI_MS_TO_TICKS(SYSTEM_STATUS_RETRY_PERIOD), HMI_STATE_CONTROLLER_OFFLINE, HMI_requestSystemStatus },  /* CONTROLLER_OFFLINE */
+};
+
+/*
+ * Searched in order, the first entry matching the current state (or HMI_ANY), the event
+ * and the value (or HMI_ANY) is applied. Events without any matching entry are ignored,
+ * so keys pressed while waiting on the Control ECU or while the keypad is locked are dropped.
+ */
+static const HMI_TransitionType g_hmiTransitions[] PROGMEM = {
+	/* Control ECU status at boot */
+	{ HMI_STATE_WAIT_SYSTEM_STATUS, HMI_EVENT_MESSAGE,    SYSTEM_READY,       HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_WAIT_SYSTEM_STATUS, HMI_EVENT_MESSAGE,    PASSWORD_NOT_SET,   HMI_STATE_NEW_PASSWORD,       HMI_selectPasswordCreation },
+
+	/* The status is asked every second while the Control ECU is offline, its answer leaves the screen */
+	{ HMI_STATE_CONTROLLER_OFFLINE, HMI_EVENT_MESSAGE,    SYSTEM_READY,       HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_CONTROLLER_OFFLINE, HMI_EVENT_MESSAGE,    PASSWORD_NOT_SET,   HMI_STATE_NEW_PASSWORD,       HMI_selectPasswordCreation },
+	{ HMI_ANY,                      HMI_EVENT_LINK_DOWN,  HMI_ANY,            HMI_STATE_CONTROLLER_OFFLINE, NULL_PTR                 },
+
+	/* A new session means the Control ECU was reset (REKEY) or this ECU was, its status is asked again */
+	{ HMI_STATE_RESET_REPORT,       HMI_EVENT_LINK_UP,    HMI_ANY,            HMI_STATE_SAME,               NULL_PTR                 },
+	{ HMI_ANY,                      HMI_EVENT_LINK_UP,    HMI_ANY,            HMI_STATE_WAIT_SYSTEM_STATUS, NULL_PTR                 },
+
+	/* Main menu options */
+	{ HMI_STATE_MAIN_MENU,          HMI_EVENT_KEY,        '+',                HMI_STATE_ENTER_PASSWORD,     HMI_selectOpenDoor       },
+	{ HMI_STATE_MAIN_MENU,          HMI_EVENT_KEY,        '-',                HMI_STATE_ENTER_PASSWORD,     HMI_selectChangePassword },
+	{ HMI_STATE_MAIN_MENU,          HMI_EVENT_KEY,        '*',                HMI_STATE_ENTER_CODE,         NULL_PTR                 },
+	{ HMI_STATE_ENTER_PASSWORD,     HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_WAIT_RESPONSE,      HMI_sendCommand          },
+	{ HMI_STATE_ENTER_CODE,         HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_WAIT_RESPONSE,      HMI_sendAccessCode       },
+	{ HMI_STATE_MAIN_MENU,          HMI_EVENT_KEY,        '=',                HMI_STATE_USER_MENU,          NULL_PTR                 },
+
+	/* Users menu: administrator password, then the user number and its password as needed */
+	{ HMI_STATE_USER_MENU,          HMI_EVENT_KEY,        1,                  HMI_STATE_ADMIN_PASSWORD,     HMI_selectUserAdd        },
+	{ HMI_STATE_USER_MENU,          HMI_EVENT_KEY,        2,                  HMI_STATE_ADMIN_PASSWORD,     HMI_selectUserRevoke     },
+	{ HMI_STATE_USER_MENU,          HMI_EVENT_KEY,        3,                  HMI_STATE_ADMIN_PASSWORD,     HMI_selectUserList       },
+	{ HMI_STATE_USER_MENU,          HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_ADMIN_PASSWORD,     HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_USER_ID,            HMI_saveAdminPassword    },
+	{ HMI_STATE_USER_ID,            HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_USER_CODE,          HMI_saveUserId           },
+	{ HMI_STATE_USER_CODE,          HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_WAIT_USER_RESULT,   HMI_sendUserRequest      },
+	{ HMI_STATE_WAIT_USER_RESULT,   HMI_EVENT_MESSAGE,    USER_RESULT,        HMI_STATE_USER_RESULT,        NULL_PTR                 },
+	{ HMI_STATE_WAIT_USER_RESULT,   HMI_EVENT_MESSAGE,    USER_LIST_END,      HMI_STATE_USER_COUNT,         NULL_PTR                 },
+	{ HMI_STATE_WAIT_USER_RESULT,   HMI_EVENT_MESSAGE,    WRONG_PASSWORD,     HMI_STATE_WRONG_PASSWORD,     NULL_PTR                 },
+
+	/* Control ECU response to the selected option */
+	{ HMI_STATE_WAIT_RESPONSE,      HMI_EVENT_MESSAGE,    UNLOCKING_DOOR,     HMI_STATE_DOOR_UNLOCKING,     NULL_PTR                 },
+	{ HMI_STATE_WAIT_RESPONSE,      HMI_EVENT_MESSAGE,    WRONG_PASSWORD,     HMI_STATE_WRONG_PASSWORD,     NULL_PTR                 },
+	{ HMI_STATE_WAIT_RESPONSE,      HMI_EVENT_MESSAGE,    ACCESS_CODE_UNAVAILABLE, HMI_STATE_CODE_UNAVAILABLE, NULL_PTR              },
+
+	/* Lockout owned by the Control ECU, which pushes the remaining time every second */
+	{ HMI_STATE_KEYPAD_LOCKED,      HMI_EVENT_LOCKOUT,    TRUE,               HMI_STATE_SAME,               HMI_updateLockoutTime    },
+	{ HMI_STATE_KEYPAD_LOCKED,      HMI_EVENT_LOCKOUT,    FALSE,              HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_ANY,                      HMI_EVENT_LOCKOUT,    TRUE,               HMI_STATE_KEYPAD_LOCKED,      NULL_PTR                 },
+
+	/* Door timeline driven by the Control ECU, the action picks the state of the phase */
+	{ HMI_ANY,                      HMI_EVENT_DOOR,       HMI_ANY,            HMI_STATE_SAME,               HMI_followDoor           },
+
+	/* System password creation: password, confirmation then the match status. A change is matched
+	 * here and sent at once with the current password (the actions skip the handshake states) */
+	{ HMI_STATE_NEW_PASSWORD,       HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_WAIT_NEW_READY,     HMI_saveNewPassword      },
+	{ HMI_STATE_WAIT_NEW_READY,     HMI_EVENT_MESSAGE,    READY_TO_RECEIVE,   HMI_STATE_CONFIRM_PASSWORD,   HMI_sendPassword         },
+	{ HMI_STATE_CONFIRM_PASSWORD,   HMI_EVENT_INPUT_DONE, HMI_ANY,            HMI_STATE_WAIT_CONFIRM_READY, HMI_checkConfirmation    },
+	{ HMI_STATE_WAIT_CONFIRM_READY, HMI_EVENT_MESSAGE,    READY_TO_RECEIVE,   HMI_STATE_WAIT_MATCH_READY,   HMI_sendPassword         },
+	{ HMI_STATE_WAIT_MATCH_READY,   HMI_EVENT_MESSAGE,    READY_TO_SEND,      HMI_STATE_WAIT_MATCH_STATUS,  HMI_sendReadyToReceive   },
+	{ HMI_STATE_WAIT_MATCH_STATUS,  HMI_EVENT_MESSAGE,    PASSWORD_MATCHED,   HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_WAIT_MATCH_STATUS,  HMI_EVENT_MESSAGE,    PASSWORD_UNMATCHED, HMI_STATE_PASSWORD_MISMATCH,  NULL_PTR                 },
+	{ HMI_STATE_WAIT_MATCH_STATUS,  HMI_EVENT_MESSAGE,    WRONG_PASSWORD,     HMI_STATE_WRONG_PASSWORD,     NULL_PTR                 },
+
+	/* Any key skips the messages */
+	{ HMI_STATE_WRONG_PASSWORD,     HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_PASSWORD_MISMATCH,  HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_NEW_PASSWORD,       NULL_PTR                 },
+	{ HMI_STATE_CODE_UNAVAILABLE,   HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_USER_RESULT,        HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_USER_COUNT,         HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_MAIN_MENU,          NULL_PTR                 },
+	{ HMI_STATE_RESET_REPORT,       HMI_EVENT_KEY,        HMI_ANY,            HMI_STATE_WAIT_SYSTEM_STATUS, NULL_PTR                 },
+
+	/* Diagnostics requests are served in every state */
+	{ HMI_ANY,                      HMI_EVENT_DIAG,       TRACE_DUMP_REQUEST,     HMI_STATE_SAME,           HMI_sendTraceDump        },
+	{ HMI_ANY,                      HMI_EVENT_DIAG,       RESET_REPORT_REQUEST,   HMI_STATE_SAME,           HMI_sendResetReport      },
+	{ HMI_ANY,                      HMI_EVENT_DIAG,       RAM_REPORT_REQUEST,     HMI_STATE_SAME,           HMI_sendRamReport        },
+	{ HMI_ANY,                      HMI_EVENT_DIAG,       LINK_BENCHMARK_REQUEST, HMI_STATE_SAME,           HMI_sendLinkBenchmark    },
+	{ HMI_ANY,                      HMI_EVENT_DIAG,       LINE_ERRORS_REQUEST,    HMI_STATE_SAME,           HMI_sendLineErrors       },
+	{ HMI_ANY,                      HMI_EVENT_DIAG,       HEARTBEAT_REPORT_REQUEST, HMI_STATE_SAME,         HMI_sendHeartbeatReport  },
+};
+
+#define HMI_TRANSITIONS_COUNT     (sizeof(g_hmiTransitions) / sizeof(g_hmiTransitions[0]))
+
 int main(void)
 {
-	uint8 key = 0, receivedByte = 0;
+	uint16 tick, lastTick = 0;
+	uint8 key, data;
+
+	/* Trace Configuration (must run before any driver logs an event):
+	 * Time base --> Timer1 counts of 8us, 1250 counts per compare interrupt (see Timer1 configuration)
+	 */
+	Trace_ConfigType traceConfig = { TRACE_ECU_HMI, 8, 1250 };
+	TRACE_init(&traceConfig);
+
+	/* Watchdog Configuration:
+	 * Tasks --> main task only, reset the MCU if it stops checking in for 4 seconds
+	 */
+	WDG_ConfigType wdgConfig = { 1, { HMI_WDG_MAIN_TIMEOUT } };
+	WDG_init(&wdgConfig);
+
+	RAMMON_init();              /* Sampled every second by HMI_timerCallBack */
 
 	SET_BIT(SREG, PIN7_ID);     /* Enable Global Interrupt (I-bit) */
 
 	LCD_init();
+	SCREEN_init();
 
 	/* UART Configuration:
-	 * BaudRate --> 9600 Bps
+	 * BaudRate --> 9600 Bps until a faster rate is negotiated with the Control ECU
 	 * CharacterSize --> 8 Data Bits
 	 * ParityMode --> No Parity
 	 * No. of Stop Bits --> One Stop Bit
 	 */
-	UART_ConfigType configPtr = { 9600, DATA_EIGHT, NO_PARITY, ONE_STOP_BIT };
+	UART_ConfigType configPtr = { LINK_BOOT_BAUD, DATA_EIGHT, NO_PARITY, ONE_STOP_BIT };
 	UART_init(&configPtr);
 
 	/* Timer Configuration:
 	 * Timer ID --> Timer 1
 	 * Timer Mode --> CTC Mode
 	 * Initial Value --> 0
-	 * Timer_Prescaler --> FCPU/1024
-	 * Compare Value --> 7813
-	 * AS FCPU = 8MHz so Ftimer = 8MHz/1024 = 128us & To force timer to produce interrupt every 1 second
-	 * SO Compare Value = 1/128us = 7813
+	 * Timer_Prescaler --> FCPU/64
+	 * Compare Value --> 1249
+	 * AS FCPU = 8MHz so Ftimer = 8MHz/64 = 8us & To force timer to produce interrupt every 10 ms (system tick)
+	 * SO Compare Value = 10ms/8us - 1 = 1249
 	 */
-	Timer_ConfigType config = { TIMER1, COMPARE_MODE, 0, 7813, FCPU_1024, DUMMY };
+	Timer_ConfigType config = { TIMER1, COMPARE_MODE, 0, 1249, FCPU_64, DUMMY };
 
 	/* Set the call back function of Timer1 as HMI_timerCallBack */
 	Timer_setCallBack(HMI_timerCallBack, TIMER1);
 	Timer_init(&config);
 
-	g_Password_Match_Status = PASSWORD_UNMATCHED;      /* Initial value of the password status as UNMATCHED */
+	/* Link Configuration:
+	 * Role --> initiator, a HELLO is sent by the WAIT_SYSTEM_STATUS state while there is no session
+	 * Boot counter of the nonces --> internal EEPROM
+	 */
+	LINK_ConfigType linkConfig = { LINK_ROLE_INITIATOR, LINK_NONCE_EEPROM_ADDRESS };
+	LINK_init(&linkConfig);
 
-	HMI_SystemPasswordInit(g_InputPassword);           /* Create System password for the first time */
+	/* Heartbeat Configuration:
+	 * Ping every 1 second, the Control ECU is offline after 3 seconds without any message
+	 */
+	HB_ConfigType heartbeatConfig = { HEARTBEAT_PERIOD, HEARTBEAT_TIMEOUT };
+	HB_init(&heartbeatConfig);
 
-	while(1)
-	{
-		HMI_AppMainOptions();           /* Displaying the main options to the user */
+	/* Baud Rate Configuration:
+	 * Proposed from 250000 Bps down after every new session, back to 9600 Bps when the Control ECU is offline
+	 */
+	BAUD_ConfigType baudConfig = { LINK_BOOT_BAUD, LINK_FASTEST_BAUD, LINK_BAUD_TIMEOUT, HMI_WDG_TASK_MAIN };
+	BAUD_init(&baudConfig);
 
-		key = KEYPAD_getPressedKey();   /* Taking input from the keypad */
+	/* Tell the user if the watchdog recovered a hang, then ask the Control ECU whether a password
+	 * must be created (first run) or a lockout is still running
+	 */
+	if (BIT_IS_SET(WDG_getResetReport()->resetCause, WDRF))
+	{
+		HMI_enterState(HMI_STATE_RESET_REPORT);
+	}
+	else
+	{
+		HMI_enterState(HMI_STATE_WAIT_SYSTEM_STATUS);
+	}
 
-		if (key == '+')
+	/* Nothing below blocks: the keypad, the UART and the timeouts are polled in turn */
+	while(1)
+	{
+		tick = HMI_getTicks();
+		if (tick != lastTick)
 		{
-			LCD_clearScreen();
-			LCD_displayString("Enter the pass: ");
-			LCD_moveCursor(1, 0);
-			HMI_getPassword(g_InputPassword);          /* Get password from user and store it in global array */
-			UART_sendByte(READY_TO_SEND);              /* inform Control ECU to start sending */
-			HMI_sendPasswordByUART(g_InputPassword);   /* Sending that password to Control ECU */
-
-			UART_sendByte(OPEN_DOOR_OPTION);           /* Inform Control ECU that User chose Open Door Option */
-
-			/* Control ECU responses [either the password is correct or wrong] */
-			receivedByte = UART_recieveByte();
-			if (receivedByte == UNLOCKING_DOOR)
+			lastTick = tick;
+
+			key = HMI_pollKey();
+			if (key != KEYPAD_NO_KEY_PRESSED)
 			{
-				HMI_OpenDoor();                /* Start displaying door status on LCD */
-				g_wrongPasswordCounter = 0;    /* Reset the counter */
+				HMI_handleKey(key);
 			}
-			else if (receivedByte == WRONG_PASSWORD)
-			{
-				LCD_clearScreen();
-				LCD_displayString("Wrong Password");
 
-				g_wrongPasswordCounter++;       /* Increment the counter */
+			if ((g_currentStateConfig.timeout != 0) && ((uint16)(tick - g_stateEntryTick) >= g_currentStateConfig.timeout))
+			{
+				HMI_enterState(g_currentStateConfig.timeoutNext);
+			}
 
-				if (g_wrongPasswordCounter == NUMBER_OF_WRONG_PASSWORD_ATTEMPTS)
-				{
-					/* System should be locked no inputs from Keypad will be accepted during this time period */
-					g_sec = 0;
-					while (g_sec < KEYPAD_LOCKED_PERIOD);
-				}
-				else
+			/* The Control ECU does not read the link while the door moves */
+			if (g_currentStateConfig.flags & HMI_FLAG_PEER_BUSY)
+			{
+				HB_hold();
+			}
+			else
+			{
+				switch (HB_service())
 				{
-					/* Small delay to see "Wrong Password" message on the LCD */
-					_delay_ms(MESSAGE_DISPLAY_DELAY);
+				case HB_EVENT_PEER_DOWN:
+					BAUD_fallback();
+					HMI_dispatchEvent(HMI_EVENT_LINK_DOWN, HMI_ANY);
+					break;
+				case HB_EVENT_PEER_UP:
+					/* Both ECUs fell back to the boot rate, the session may still be there */
+					if (LINK_isConnected())
+					{
+						BAUD_negotiate();
+					}
+					break;
+				default:
+					break;
 				}
 			}
 		}
 
-		else if(key == '-')
+		if (UART_isByteReceived())
 		{
-			LCD_clearScreen();
-			LCD_displayString("Enter the pass: ");
-			LCD_moveCursor(1, 0);
-			HMI_getPassword(g_InputPassword);          /* Get password from user and store it in global array */
-			UART_sendByte(READY_TO_SEND);              /* inform Control ECU to start sending */
-			HMI_sendPasswordByUART(g_InputPassword);   /* Sending that password to Control ECU */
-
-			UART_sendByte(CHANGE_PASSWORD_OPTION);     /* inform Control ECU that user chose Change Password Option */
-
-			/* Control ECU responses [either the password is correct or wrong] */
-			receivedByte = UART_recieveByte();
-
-			/* If user enters the old password right, then let user create a new system password*/
-			if (receivedByte == CHANGING_PASSWORD)
+			/* A line error drops the frame being received, a corrupted byte is not fed at all */
+			switch (UART_readByte(&data))
 			{
-				HMI_SystemPasswordInit(g_InputPassword);
-				LCD_clearScreen();
-				g_wrongPasswordCounter = 0;      /* reset the counter */
+			case UART_RX_OK:
+				HMI_handleByte(data);
+				break;
+			case UART_RX_OVERRUN:
+				LINK_resync();
+				HMI_handleByte(data);
+				break;
+			default:
+				LINK_resync();
+				break;
 			}
-			else if (receivedByte == WRONG_PASSWORD)
-			{
-				LCD_clearScreen();
-				LCD_displayString("Wrong Password");
-
-				g_wrongPasswordCounter++;       /* Increment the counter */
+		}
 
-				if (g_wrongPasswordCounter == NUMBER_OF_WRONG_PASSWORD_ATTEMPTS)
-				{
-					/* System should be locked no inputs from Keypad will be accepted during this time period */
-					g_sec = 0;
-					while (g_sec < KEYPAD_LOCKED_PERIOD);
-				}
-				else
-				{
-					/* Small delay to see "Wrong Password" message on the LCD */
-					_delay_ms(MESSAGE_DISPLAY_DELAY);
-				}
-			}
+		/* A lost answer from the Control ECU is left to the watchdog as before */
+		if (!(g_currentStateConfig.flags & HMI_FLAG_PEER_WAIT))
+		{
+			WDG_checkIn(HMI_WDG_TASK_MAIN);
 		}
 	}
 }
@@ -153,129 +341,596 @@ int main(void)
  */
 void HMI_timerCallBack(void)
 {
-	g_sec++;
+	static uint8 ticksPerSecond = 0;
+
+	g_ticks++;
+
+	/* The watchdog supervision and the RAM sampling keep their 1 second period */
+	ticksPerSecond++;
+	if (ticksPerSecond == HMI_SEC_TO_TICKS(1))
+	{
+		ticksPerSecond = 0;
+		WDG_supervise();
+		RAMMON_sample();
+	}
+}
+
+/*
+ * Description: Function to read the system tick counter atomically
+ */
+uint16 HMI_getTicks(void)
+{
+	uint8 sreg = SREG;
+	uint16 ticks;
+
+	CLEAR_BIT(SREG, PIN7_ID);
+	ticks = g_ticks;
+	SREG = sreg;
+
+	return ticks;
 }
 
 /*
- * Description: Function to display the application main options
+ * Description: Function to enter a new UI state, draw its screen and run its entry action
  */
-void HMI_AppMainOptions()
+void HMI_enterState(uint8 state)
 {
-	LCD_clearScreen();
-	LCD_displayStringRowColumn(0, 0, "+ : Open Door");
-	LCD_displayStringRowColumn(1, 0, "- : Change Pass");
+	if (state >= HMI_STATE_COUNT)
+		return;
+
+	memcpy_P(&g_currentStateConfig, &g_hmiStates[state], sizeof(HMI_StateConfigType));
+	g_currentState = state;
+	g_stateEntryTick = HMI_getTicks();
+	TRACE_setState(state);
+
+	if (g_currentStateConfig.screen != HMI_NO_SCREEN)
+	{
+		SCREEN_show(g_currentStateConfig.screen);
+	}
+	if (g_currentStateConfig.entryAction != NULL_PTR)
+	{
+		g_currentStateConfig.entryAction();
+	}
 }
 
 /*
- * Description: Function to Initialize System Password
+ * Description: Function to look up the event in the transitions table of the current state and apply it
  */
-void HMI_SystemPasswordInit(uint8 *password)
+void HMI_dispatchEvent(HMI_EventType event, uint8 value)
 {
-	while(g_Password_Match_Status == PASSWORD_UNMATCHED)
+	HMI_TransitionType transition;
+	uint8 i, next;
+
+	for (i = 0; i < HMI_TRANSITIONS_COUNT; i++)
 	{
-		/* Entering the password for the first time */
-		LCD_clearScreen();
-		LCD_displayStringRowColumn(0, 0, "Enter a Password: ");
-		LCD_moveCursor(1, 0);
-		HMI_getPassword(password);
-
-		/* Sending the password to the Control ECU By UART */
-		UART_sendByte(READY_TO_SEND);
-		while(UART_recieveByte() != READY_TO_RECEIVE);
-		HMI_sendPasswordByUART(g_InputPassword);
-
-		/* Entering the confirmation password */
-		LCD_clearScreen();
-		LCD_displayStringRowColumn(0, 0, "Re-Enter the same");
-		LCD_displayStringRowColumn(1, 0, "password: ");
-		LCD_moveCursor(1, 10);
-		HMI_getPassword(password);
-
-		/* Sending the Confirmation password to the Control ECU By UART */
-		UART_sendByte(READY_TO_SEND);
-		while(UART_recieveByte() != READY_TO_RECEIVE);
-		HMI_sendPasswordByUART(g_InputPassword);
-
-		/* Receiving Passwords Match Status from Control ECU By UART */
-		while(UART_recieveByte() != READY_TO_SEND);
-		UART_sendByte(READY_TO_RECEIVE);
-		g_Password_Match_Status = UART_recieveByte();
-
-		/* Checking on the Matching Status */
-		if (g_Password_Match_Status == PASSWORD_MATCHED)
-			break;
-		else
+		memcpy_P(&transition, &g_hmiTransitions[i], sizeof(HMI_TransitionType));
+
+		if (((transition.state == g_currentState) || (transition.state == HMI_ANY)) &&
+			(transition.event == event) &&
+			((transition.value == value) || (transition.value == HMI_ANY)))
 		{
-			LCD_clearScreen();
-			LCD_displayString("PASSWORD MISMATCH");
-			_delay_ms(MESSAGE_DISPLAY_DELAY);
+			next = transition.next;
+			if (transition.action != NULL_PTR)
+			{
+				next = transition.action(next);
+			}
+			if (next != HMI_STATE_SAME)
+			{
+				HMI_enterState(next);
+			}
+			return;
 		}
 	}
-	g_Password_Match_Status = PASSWORD_UNMATCHED;
 }
 
 /*
- * Description: Function to get password as an input from the keypad and store it in a global array
+ * Description: Function to scan the keypad once per tick and return a debounced key press or KEYPAD_NO_KEY_PRESSED
  */
-void HMI_getPassword(uint8 *password)
+uint8 HMI_pollKey(void)
 {
-	uint8 i = 0, key = 0;
+	static uint8 lastSample = KEYPAD_NO_KEY_PRESSED;
+	static uint8 stableKey = KEYPAD_NO_KEY_PRESSED;
+	static uint8 stableCount = 0;
+	uint8 sample = KEYPAD_scanKey();
 
-	/* Taking password of length = 5 from the keypad */
-	while(i != PASSWORD_LENGTH)
+	if (sample != lastSample)
 	{
-		key = KEYPAD_getPressedKey();
+		lastSample = sample;
+		stableCount = 0;
+	}
+	if (stableCount < KEYPAD_DEBOUNCE_TICKS)
+	{
+		stableCount++;
+		if ((stableCount == KEYPAD_DEBOUNCE_TICKS) && (sample != stableKey))
+		{
+			stableKey = sample;
+			return sample;     /* Reported once per press, KEYPAD_NO_KEY_PRESSED on release */
+		}
+	}
+
+	return KEYPAD_NO_KEY_PRESSED;
+}
+
+/*
+ * Description: Function to handle a key press, collecting the password digits in password input states
+ */
+void HMI_handleKey(uint8 key)
+{
+	uint8 inputLength = (g_currentStateConfig.flags & HMI_FLAG_CODE_INPUT) ? ACCESS_CODE_LENGTH :
+						(g_currentStateConfig.flags & HMI_FLAG_ID_INPUT) ? USER_ID_LENGTH : PASSWORD_LENGTH;
+	uint8 lowestDigit = (g_currentStateConfig.flags & (HMI_FLAG_CODE_INPUT | HMI_FLAG_ID_INPUT)) ? 0 : 1;
+
+	if (g_currentStateConfig.flags & (HMI_FLAG_PASSWORD_INPUT | HMI_FLAG_CODE_INPUT | HMI_FLAG_ID_INPUT))
+	{
+		if ((key >= lowestDigit) && (key <= 9) && (g_passwordLength < inputLength))
+		{
+			g_InputPassword[g_passwordLength] = key;
+			g_passwordLength++;
+			if (g_currentStateConfig.flags & HMI_FLAG_ID_INPUT)
+			{
+				LCD_integerToString(key);     /* A user number is not secret */
+			}
+			else
+			{
+				LCD_displayCharacter('*');    /* Display '*' on LCD for each number */
+			}
+		}
+		else if ((key == ENTER_KEY_PRESSED) && (g_passwordLength == inputLength))
+		{
+			HMI_dispatchEvent(HMI_EVENT_INPUT_DONE, HMI_ANY);
+		}
+	}
+	else
+	{
+		HMI_dispatchEvent(HMI_EVENT_KEY, key);
+	}
+}
+
+/*
+ * Description: Function to feed a byte received by UART to the link and dispatch the resulting event
+ */
+void HMI_handleByte(uint8 data)
+{
+	const uint8 *message;
+	uint8 length;
 
-		if ((key >= 1) && (key <= 9))
+	switch (LINK_receiveByte(data))
+	{
+	case LINK_RX_RAW:
+		HMI_dispatchEvent(HMI_EVENT_DIAG, data);
+		break;
+	case LINK_RX_CONNECTED:
+		BAUD_negotiate();
+		HMI_dispatchEvent(HMI_EVENT_LINK_UP, HMI_ANY);
+		break;
+	case LINK_RX_MESSAGE:
+		message = LINK_getMessage(&length);
+		if (HB_handleMessage(message, length) || BAUD_handleMessage(message, length))
+		{
+			/* Ping answered, pong measured or late check dropped, nothing for the UI */
+		}
+		else if ((message[0] == LOCKOUT_STATUS) && (length == 1 + LOCKOUT_STATUS_PAYLOAD))
+		{
+			/* Remaining seconds, low byte first */
+			g_lockoutRemaining = message[1] | ((uint16)message[2] << 8);
+			HMI_dispatchEvent(HMI_EVENT_LOCKOUT, (g_lockoutRemaining != 0) ? TRUE : FALSE);
+		}
+		else if ((message[0] == UNLOCKING_DOOR) && (length == 1 + DOOR_PERIODS_PAYLOAD))
+		{
+			memcpy(g_doorPeriods, &message[1], DOOR_PERIODS_PAYLOAD);
+			HMI_dispatchEvent(HMI_EVENT_MESSAGE, message[0]);
+		}
+		else if ((message[0] == DOOR_PROGRESS) && (length == 1 + DOOR_PROGRESS_PAYLOAD))
+		{
+			memcpy(g_doorProgress, &message[1], DOOR_PROGRESS_PAYLOAD);
+			HMI_dispatchEvent(HMI_EVENT_DOOR, g_doorProgress[0]);
+		}
+		else if (((message[0] == USER_RESULT) || (message[0] == USER_LIST_END)) && (length == 2))
+		{
+			g_userResult = message[1];
+			HMI_dispatchEvent(HMI_EVENT_MESSAGE, message[0]);
+		}
+		else if (length != 0)
 		{
-			password[i] = key;
-			LCD_displayCharacter('*');        /* Display '*' on LCD for each number */
-			i++;
+			HMI_dispatchEvent(HMI_EVENT_MESSAGE, message[0]);
 		}
-		/* Delay between each input taken from the keypad */
-		_delay_ms(KEYPAD_INPUT_DELAY);
+		break;
+	default:
+		break;
 	}
+}
+
+/*
+ * Description: Function to send a one byte message to the Control ECU through the link
+ */
+void HMI_sendRequest(uint8 request)
+{
+	(void)LINK_sendMessage(&request, 1);
+}
 
-	/* Loop until user presses the ENTER key from the keypad */
-	while(KEYPAD_getPressedKey() != ENTER_KEY_PRESSED);
+/*
+ * Description: Entry action of the password input states
+ */
+static void HMI_resetPasswordInput(void)
+{
+	g_passwordLength = 0;
 }
 
 /*
- * Description: Function to send the entered password Byte by Byte to the Control ECU By UART
+ * Description: Entry action to display the reset cause and the hang location after a watchdog reset
  */
-void HMI_sendPasswordByUART(uint8 *password)
+static void HMI_showResetReport(void)
 {
-	uint8 count = 0;
+	const WDG_ResetReportType *report = WDG_getResetReport();
 
-	while(count != PASSWORD_LENGTH)
+	if (report->stalledTask != WDG_NO_TASK)
+	{
+		SCREEN_show(SCREEN_WATCHDOG_HANG);
+		LCD_integerToString(report->stalledState);
+	}
+	else
 	{
-		UART_sendByte(password[count]);
-		count++;
-		_delay_ms(100);
+		SCREEN_show(SCREEN_WATCHDOG_RESET);
 	}
 }
 
+static uint8 HMI_selectOpenDoor(uint8 next)
+{
+	g_selectedOption = OPEN_DOOR_OPTION;
+	return next;
+}
+
+static uint8 HMI_selectChangePassword(uint8 next)
+{
+	g_selectedOption = CHANGE_PASSWORD_OPTION;
+	return next;
+}
+
+/*
+ * Description: Send the selected option and the password in a single message. The current password of a change
+ *              is kept instead, it goes with the new one once confirmed.
+ */
+static uint8 HMI_sendCommand(uint8 next)
+{
+	uint8 message[1 + PASSWORD_LENGTH];
+
+	if (g_selectedOption == CHANGE_PASSWORD_OPTION)
+	{
+		memcpy(g_oldPassword, g_InputPassword, PASSWORD_LENGTH);
+		return HMI_STATE_NEW_PASSWORD;
+	}
+
+	message[0] = g_selectedOption;
+	memcpy(&message[1], g_InputPassword, PASSWORD_LENGTH);
+	(void)LINK_sendMessage(message, sizeof(message));
+	return next;
+}
 
 /*
- * Description: A function that displays on LCD that door is opening or closing for a certain period of time
+ * Description: Send the one-time access code, checked by the Control ECU instead of the password
  */
-void HMI_OpenDoor(void)
-{
-	/* Hold the system for 15 seconds & display to user that door is unlocking */
-	g_sec = 0;
-	LCD_clearScreen();
-	LCD_displayStringRowColumn(0, 0, "Door is unlocking");
-	while (g_sec < DOOR_UNLOCKING_PERIOD);
-
-	/* Hold the door open for 3 seconds */
-	g_sec = 0;
-	LCD_clearScreen();
-	LCD_displayStringRowColumn(0, 0, "Door is now open");
-	while (g_sec < DOOR_LEFT_OPEN_PERIOD);
-
-	/* Hold the system for 15 seconds & display to user that door is locking */
-	g_sec = 0;
-	LCD_clearScreen();
-	LCD_displayStringRowColumn(0, 0, "Door is locking");
-	while (g_sec < DOOR_LOCKING_PERIOD);
+static uint8 HMI_sendAccessCode(uint8 next)
+{
+	uint8 message[1 + ACCESS_CODE_LENGTH];
+
+	message[0] = ACCESS_CODE_OPTION;
+	memcpy(&message[1], g_InputPassword, ACCESS_CODE_LENGTH);
+	(void)LINK_sendMessage(message, sizeof(message));
+	return next;
+}
+
+static uint8 HMI_selectUserAdd(uint8 next)
+{
+	g_userRequest = USER_ADD_REQUEST;
+	return next;
+}
+
+static uint8 HMI_selectUserRevoke(uint8 next)
+{
+	g_userRequest = USER_REVOKE_REQUEST;
+	return next;
+}
+
+static uint8 HMI_selectUserList(uint8 next)
+{
+	g_userRequest = USER_LIST_REQUEST;
+	return next;
+}
+
+/*
+ * Description: Keep the administrator password, a list request needs nothing else
+ */
+static uint8 HMI_saveAdminPassword(uint8 next)
+{
+	memcpy(g_adminPassword, g_InputPassword, PASSWORD_LENGTH);
+	if (g_userRequest == USER_LIST_REQUEST)
+	{
+		return HMI_sendUserRequest(HMI_STATE_WAIT_USER_RESULT);
+	}
+	return next;
+}
+
+/*
+ * Description: Keep the user number, a revoke request needs nothing else
+ */
+static uint8 HMI_saveUserId(uint8 next)
+{
+	g_userId = (uint8)(g_InputPassword[0] * 10 + g_InputPassword[1]);
+	if (g_userRequest == USER_REVOKE_REQUEST)
+	{
+		return HMI_sendUserRequest(HMI_STATE_WAIT_USER_RESULT);
+	}
+	return next;
+}
+
+/*
+ * Description: Send the selected users request. Users added from the keypad are always valid
+ *              and not administrators, the validity window is only set by a provisioning tool.
+ */
+static uint8 HMI_sendUserRequest(uint8 next)
+{
+	uint8 message[1 + PASSWORD_LENGTH + 2 + PASSWORD_LENGTH + 8];
+	uint8 length = 1 + PASSWORD_LENGTH;
+
+	message[0] = g_userRequest;
+	memcpy(&message[1], g_adminPassword, PASSWORD_LENGTH);
+
+	if (g_userRequest == USER_REVOKE_REQUEST)
+	{
+		message[length++] = g_userId;
+	}
+	else if (g_userRequest == USER_ADD_REQUEST)
+	{
+		message[length++] = g_userId;
+		message[length++] = 0;                                /* Flags */
+		memcpy(&message[length], g_InputPassword, PASSWORD_LENGTH);
+		length += PASSWORD_LENGTH;
+		memset(&message[length], 0x00, 4);                    /* Valid from the beginning */
+		memset(&message[length + 4], 0xFF, 4);                /* Valid forever */
+		length += 8;
+	}
+	(void)LINK_sendMessage(message, length);
+	return next;
+}
+
+/*
+ * Description: Entry action displaying the status of the last users request
+ */
+static void HMI_showUserResult(void)
+{
+	if (g_userResult == USER_RESULT_OK)
+	{
+		SCREEN_show(SCREEN_USER_DONE);
+	}
+	else if (g_userResult == USER_RESULT_TABLE_FULL)
+	{
+		SCREEN_show(SCREEN_USERS_FULL);
+	}
+	else
+	{
+		SCREEN_show(SCREEN_USER_REFUSED);
+	}
+}
+
+/*
+ * Description: Entry action displaying the number of users listed by the Control ECU
+ */
+static void HMI_showUserCount(void)
+{
+	SCREEN_show(SCREEN_USER_COUNT);
+	LCD_integerToString(g_userResult);
+}
+
+/*
+ * Description: The Control ECU has no password yet, it is created through the READY_TO_SEND handshakes
+ */
+static uint8 HMI_selectPasswordCreation(uint8 next)
+{
+	g_selectedOption = 0;
+	return next;
+}
+
+/*
+ * Description: Keep the new password until its confirmation, a creation announces it to the Control ECU at once
+ */
+static uint8 HMI_saveNewPassword(uint8 next)
+{
+	memcpy(g_newPassword, g_InputPassword, PASSWORD_LENGTH);
+	if (g_selectedOption == CHANGE_PASSWORD_OPTION)
+	{
+		return HMI_STATE_CONFIRM_PASSWORD;
+	}
+	return HMI_sendReadyToSend(next);
+}
+
+/*
+ * Description: Match the confirmation of a change here, then send the current and the new password in a single
+ *              message: the Control ECU answers once the new one is stored
+ */
+static uint8 HMI_checkConfirmation(uint8 next)
+{
+	uint8 message[1 + 2 * PASSWORD_LENGTH];
+
+	if (g_selectedOption != CHANGE_PASSWORD_OPTION)
+	{
+		return HMI_sendReadyToSend(next);
+	}
+	if (memcmp(g_newPassword, g_InputPassword, PASSWORD_LENGTH) != 0)
+	{
+		return HMI_STATE_PASSWORD_MISMATCH;
+	}
+
+	message[0] = CHANGE_PASSWORD_OPTION;
+	memcpy(&message[1], g_oldPassword, PASSWORD_LENGTH);
+	memcpy(&message[1 + PASSWORD_LENGTH], g_newPassword, PASSWORD_LENGTH);
+	(void)LINK_sendMessage(message, sizeof(message));
+	return HMI_STATE_WAIT_MATCH_STATUS;
+}
+
+static uint8 HMI_sendReadyToSend(uint8 next)
+{
+	HMI_sendRequest(READY_TO_SEND);
+	return next;
+}
+
+static uint8 HMI_sendReadyToReceive(uint8 next)
+{
+	HMI_sendRequest(READY_TO_RECEIVE);
+	return next;
+}
+
+/*
+ * Description: Send the entered password, the message is sealed from a copy so the next input can start at once
+ */
+static uint8 HMI_sendPassword(uint8 next)
+{
+	uint8 message[1 + PASSWORD_LENGTH];
+
+	message[0] = PASSWORD_DATA;
+	memcpy(&message[1], g_InputPassword, PASSWORD_LENGTH);
+	(void)LINK_sendMessage(message, sizeof(message));
+	return next;
+}
+
+/*
+ * Description: Entry action asking the Control ECU for its status, repeated on every retry timeout.
+ *              Without a session a HELLO is sent instead, the status is asked once the link is up.
+ */
+static void HMI_requestSystemStatus(void)
+{
+	if (LINK_isConnected())
+	{
+		HMI_sendRequest(SYSTEM_STATUS_REQUEST);
+	}
+	else
+	{
+		LINK_connect();
+	}
+}
+
+/*
+ * Description: Entry action displaying the lockout time left, in seconds
+ */
+static void HMI_showLockoutTime(void)
+{
+	SCREEN_show(SCREEN_KEYPAD_LOCKED);
+	LCD_integerToString(g_lockoutRemaining);
+	LCD_displayString_P(PSTR(" s"));
+}
+
+/*
+ * Description: Entry action of the door states. The Control ECU moves them on with DOOR_PROGRESS, the period it
+ *              sent (plus a margin) is only a fallback timeout if these messages are lost.
+ */
+static void HMI_loadDoorPeriod(void)
+{
+	uint8 phase = g_currentState - HMI_STATE_DOOR_UNLOCKING;
+
+	g_currentStateConfig.timeout = HMI_SEC_TO_TICKS(g_doorPeriods[phase] + DOOR_PROGRESS_MARGIN);
+
+	/* Entered on UNLOCKING_DOOR or on the fallback timeout: the phase starts */
+	if (g_doorProgress[0] != phase)
+	{
+		g_doorProgress[0] = phase;
+		g_doorProgress[1] = 0;
+		g_doorProgress[2] = g_doorPeriods[phase];
+	}
+
+	/* The screen was just cleared: icon, empty bar and the seconds are drawn once */
+	LCD_moveCursor(1, 0);
+	LCD_displayCharacter((phase == DOOR_PHASE_LOCKING) ? SCREEN_GLYPH_LOCKED : SCREEN_GLYPH_UNLOCKED);
+	LCD_progressInit(&g_doorBar, 1, SCREEN_PROGRESS_COLUMN, SCREEN_PROGRESS_WIDTH);
+	g_doorShownSeconds = g_doorProgress[2] + 1;
+	HMI_showDoorProgress();
+}
+
+/*
+ * Description: Follow a DOOR_PROGRESS while a door state is displayed, or while the answer to the password is
+ *              awaited (its UNLOCKING_DOOR was lost): enter the state of a new phase (the main menu once the door
+ *              is closed) or redraw the progress of the current one
+ */
+static uint8 HMI_followDoor(uint8 next)
+{
+	uint8 phase = g_doorProgress[0];
+
+	if (g_currentState == HMI_STATE_WAIT_RESPONSE)
+		return (phase >= DOOR_PHASE_CLOSED) ? HMI_STATE_MAIN_MENU : (HMI_STATE_DOOR_UNLOCKING + phase);
+
+	if ((g_currentState < HMI_STATE_DOOR_UNLOCKING) || (g_currentState > HMI_STATE_DOOR_LOCKING))
+		return next;
+
+	if (phase >= DOOR_PHASE_CLOSED)
+		return HMI_STATE_MAIN_MENU;
+
+	if (phase != (g_currentState - HMI_STATE_DOOR_UNLOCKING))
+		return HMI_STATE_DOOR_UNLOCKING + phase;
+
+	g_stateEntryTick = HMI_getTicks();         /* The fallback timeout restarts from the last push */
+	g_currentStateConfig.timeout = HMI_SEC_TO_TICKS(g_doorProgress[2] + DOOR_PROGRESS_MARGIN);
+	HMI_showDoorProgress();
+	return next;
+}
+
+/*
+ * Description: Update the progress of the door phase on the second line: only the cells of the bar that change,
+ *              and the remaining seconds when they change
+ */
+static void HMI_showDoorProgress(void)
+{
+	LCD_progressUpdate(&g_doorBar, g_doorProgress[1]);
+
+	if (g_doorProgress[2] != g_doorShownSeconds)
+	{
+		g_doorShownSeconds = g_doorProgress[2];
+		LCD_moveCursor(1, SCREEN_PROGRESS_TIME_COLUMN);
+		LCD_integerToString(g_doorShownSeconds);
+		LCD_displayString_P(PSTR("s "));       /* Also erases the digit of a longer previous value */
+	}
+}
+
+/*
+ * Description: Rewrite only the time on every push of the Control ECU so the screen does not flicker
+ */
+static uint8 HMI_updateLockoutTime(uint8 next)
+{
+	LCD_moveCursor(1, SCREEN_LOCKOUT_TIME_COLUMN);
+	LCD_integerToString(g_lockoutRemaining);
+	LCD_displayString_P(PSTR(" s   "));      /* Also erases the digits of a longer previous value */
+	return next;
+}
+
+static uint8 HMI_sendTraceDump(uint8 next)
+{
+	TRACE_dump();
+	return next;
+}
+
+static uint8 HMI_sendResetReport(uint8 next)
+{
+	WDG_sendResetReport();
+	return next;
+}
+
+static uint8 HMI_sendRamReport(uint8 next)
+{
+	RAMMON_sendReport();
+	return next;
+}
+
+static uint8 HMI_sendLinkBenchmark(uint8 next)
+{
+	LINK_sendBenchmark();
+	return next;
+}
+
+static uint8 HMI_sendLineErrors(uint8 next)
+{
+	UART_sendErrorReport();
+	return next;
+}
+
+static uint8 HMI_sendHeartbeatReport(uint8 next)
+{
+	HB_sendReport();
+	return next;
 }
@@ -15,86 +15,245 @@
 
 
 #include "gpio.h"
+#include "hmi_screens.h"
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 
+/* SYSTEM TICK MACROS (Timer1 compare interrupt) */
+#define HMI_TICK_MS                       10
+#define HMI_MS_TO_TICKS(ms)               ((ms) / HMI_TICK_MS)
+#define HMI_SEC_TO_TICKS(sec)             ((sec) * (1000 / HMI_TICK_MS))
+
 #define MESSAGE_DISPLAY_DELAY     2000
 
 /* KEYPAD MACROS */
 #define ENTER_KEY_PRESSED         13
-#define KEYPAD_INPUT_DELAY        500
+#define KEYPAD_DEBOUNCE_TICKS     2         /* A key must be read the same in 2 ticks in a row */
 
 /* PASSWORD MACROS */
 #define PASSWORD_LENGTH           5
 #define PASSWORD_MATCHED          TRUE
 #define PASSWORD_UNMATCHED        FALSE
 
-/* TIMING MACROS */
-#define DOOR_UNLOCKING_PERIOD	            15
-#define DOOR_LOCKING_PERIOD	                15
-#define DOOR_LEFT_OPEN_PERIOD	            3
-#define NUMBER_OF_WRONG_PASSWORD_ATTEMPTS 	3
-#define KEYPAD_LOCKED_PERIOD			    60
+/* ONE-TIME ACCESS CODES MACROS */
+#define ACCESS_CODE_LENGTH        6         /* Digits 0..9 of the TOTP codes verified by the Control ECU */
+
+/* USERS MACROS */
+#define USER_ID_LENGTH            2         /* Users are numbered 00..99, 00 is the administrator created at the first run */
+
+/* TIMING MACROS (the door periods are configured on the Control ECU and come with UNLOCKING_DOOR) */
+#define DOOR_PROGRESS_MARGIN                2         /* Seconds a door state waits past its period for the next DOOR_PROGRESS */
+#define SYSTEM_STATUS_RETRY_PERIOD          1000      /* ms between two status requests (or HELLOs) while the Control ECU does not answer */
+
+/* LINK MACROS */
+#define LINK_NONCE_EEPROM_ADDRESS           0x00      /* Internal EEPROM, boot counter of the link nonces (4 bytes) */
+#define LINK_BOOT_BAUD                      UART_BAUD_9600     /* Rate after a reset, the one of the diagnostics tool */
+#define LINK_FASTEST_BAUD                   UART_BAUD_250000   /* Fastest rate proposed, LINK_BOOT_BAUD keeps the boot rate */
+#define LINK_BAUD_TIMEOUT                   200       /* ms to wait for each answer of the Control ECU */
 
-/***** UART MACROS *****/
+/* HEARTBEAT MACROS (kept under the watchdog timeout, the offline screen comes first) */
+#define HEARTBEAT_PERIOD                    1000      /* ms between two pings to the Control ECU */
+#define HEARTBEAT_TIMEOUT                   3000      /* ms without any message before the Control ECU is offline */
+
+/***** LINK MESSAGES (first byte of every encrypted message) *****/
 //Send & Receive Handlers
 #define READY_TO_SEND               0x10
 #define READY_TO_RECEIVE            0x20
+#define PASSWORD_DATA               0x21      /* Followed by the PASSWORD_LENGTH digits */
 
 //Change Password Handlers
-#define CHANGE_PASSWORD_OPTION	    0x18
-#define CHANGING_PASSWORD		    0x30
+#define CHANGE_PASSWORD_OPTION	    0x18      /* Followed by the old then the new password (PASSWORD_LENGTH digits each), */
+                                              /* answered by PASSWORD_MATCHED once stored or PASSWORD_UNMATCHED        */
 
 //Open Door Handlers
-#define OPEN_DOOR_OPTION            0x19
-#define UNLOCKING_DOOR			    0x31
+#define OPEN_DOOR_OPTION            0x19      /* Followed by the PASSWORD_LENGTH digits */
+#define UNLOCKING_DOOR			    0x31      /* Followed by the unlocking, left open and locking periods (seconds, 1 byte each) */
+#define DOOR_PERIODS_PAYLOAD        3
+#define DOOR_PROGRESS               0x35      /* Followed by the door phase, its percentage done and its remaining seconds, */
+#define DOOR_PROGRESS_PAYLOAD       3         /* pushed by the Control ECU when a phase starts then every second            */
+
+/* Door phases of DOOR_PROGRESS, in the order of the door timeline */
+#define DOOR_PHASE_UNLOCKING        0
+#define DOOR_PHASE_OPEN             1
+#define DOOR_PHASE_LOCKING          2
+#define DOOR_PHASE_CLOSED           3
+
+//One-Time Access Code Handlers (opens the door, the password is left unchanged)
+#define ACCESS_CODE_OPTION          0x1A      /* Followed by the ACCESS_CODE_LENGTH digits (0..9) */
+#define ACCESS_CODE_UNAVAILABLE     0x34      /* The clock of the Control ECU was not set since its last reset */
 
-//Wrong Password Handler
+//Users Handlers (every request starts with an administrator password, answered by USER_RESULT)
+#define USER_ADD_REQUEST            0x50      /* admin(5) userId flags code(5) validFrom(4) validUntil(4), times low first */
+#define USER_REVOKE_REQUEST         0x51      /* admin(5) userId */
+#define USER_LIST_REQUEST           0x52      /* admin(5), answered by one USER_ENTRY per user then USER_LIST_END */
+#define USER_ENTRY                  0x53      /* userId flags validFrom(4) validUntil(4) */
+#define USER_LIST_END               0x54      /* count */
+#define USER_RESULT                 0x55      /* Status of the Control ECU users table, 0 = done */
+#define USER_RESULT_OK              0
+#define USER_RESULT_TABLE_FULL      1
+
+//Wrong Password Handlers
 #define WRONG_PASSWORD			    0x25
+#define LOCKOUT_STATUS              0x26      /* Followed by the remaining lockout seconds (2 bytes, low first), 0 = lockout over */
+#define LOCKOUT_STATUS_PAYLOAD      2
+
+//System Status Handlers (HMI asks at boot whether a password exists or a lockout is running)
+#define SYSTEM_STATUS_REQUEST       0x12
+#define SYSTEM_READY                0x32
+#define PASSWORD_NOT_SET            0x33
+
+//Diagnostics Handlers (single bytes sent in clear outside the frames by the diagnostics tool)
+#define TRACE_DUMP_REQUEST          0x40
+#define RESET_REPORT_REQUEST        0x41
+#define RAM_REPORT_REQUEST          0x42
+#define LINK_BENCHMARK_REQUEST      0x44
+#define LINE_ERRORS_REQUEST         0x4D      /* Answered by 'U' 'E', see UART_sendErrorReport */
+#define HEARTBEAT_REPORT_REQUEST    0x4E      /* Answered by 'H' 'T', see HB_sendReport */
+
+/* WATCHDOG MACROS */
+#define HMI_WDG_TASK_MAIN                   0
+#define HMI_WDG_MAIN_TIMEOUT                4     /* Seconds without a check-in before resetting */
+
+/* UI ENGINE MACROS */
+#define HMI_STATE_SAME              0xFF          /* Transition that does not leave (nor redraw) the state */
+#define HMI_ANY                     0xFF          /* Transition value that matches any key, message or byte */
+#define HMI_NO_SCREEN               SCREEN_COUNT  /* The entry action draws the screen itself */
+
+/* State flags */
+#define HMI_FLAG_PASSWORD_INPUT     0x01          /* Digits are collected, ENTER raises HMI_EVENT_INPUT_DONE */
+#define HMI_FLAG_PEER_WAIT          0x02          /* Waiting on Control ECU, left to the watchdog if it never answers */
+#define HMI_FLAG_CODE_INPUT         0x04          /* Like HMI_FLAG_PASSWORD_INPUT for an access code (0 is a valid digit) */
+#define HMI_FLAG_ID_INPUT           0x08          /* Like HMI_FLAG_CODE_INPUT for a user number */
+#define HMI_FLAG_PEER_BUSY          0x10          /* Control ECU moves the door and does not read the link, the heartbeat is held */
+
+/* UI states (also logged by TRACE_setState to locate a stuck handshake step) */
+typedef enum {
+	HMI_STATE_MAIN_MENU,
+	HMI_STATE_ENTER_PASSWORD,
+	HMI_STATE_NEW_PASSWORD,
+	HMI_STATE_WAIT_NEW_READY,
+	HMI_STATE_CONFIRM_PASSWORD,
+	HMI_STATE_WAIT_CONFIRM_READY,
+	HMI_STATE_WAIT_MATCH_READY,
+	HMI_STATE_WAIT_MATCH_STATUS,
+	HMI_STATE_WAIT_RESPONSE,
+	HMI_STATE_DOOR_UNLOCKING,
+	HMI_STATE_DOOR_OPEN,
+	HMI_STATE_DOOR_LOCKING,
+	HMI_STATE_WRONG_PASSWORD,
+	HMI_STATE_PASSWORD_MISMATCH,
+	HMI_STATE_KEYPAD_LOCKED,
+	HMI_STATE_RESET_REPORT,
+	HMI_STATE_WAIT_SYSTEM_STATUS,
+	HMI_STATE_ENTER_CODE,
+	HMI_STATE_CODE_UNAVAILABLE,
+	HMI_STATE_USER_MENU,
+	HMI_STATE_ADMIN_PASSWORD,
+	HMI_STATE_USER_ID,
+	HMI_STATE_USER_CODE,
+	HMI_STATE_WAIT_USER_RESULT,
+	HMI_STATE_USER_RESULT,
+	HMI_STATE_USER_COUNT,
+	HMI_STATE_CONTROLLER_OFFLINE,
+	HMI_STATE_COUNT
+} HMI_StateID;
+
+/* Events dispatched through the transitions table */
+typedef enum {
+	HMI_EVENT_KEY,           /* value = pressed key                                   */
+	HMI_EVENT_MESSAGE,       /* value = first byte of a message from the Control ECU  */
+	HMI_EVENT_DIAG,          /* value = byte received by UART outside the link frames */
+	HMI_EVENT_INPUT_DONE,    /* value = HMI_ANY                                       */
+	HMI_EVENT_LINK_UP,       /* value = HMI_ANY, a new link session was established   */
+	HMI_EVENT_LINK_DOWN,     /* value = HMI_ANY, the heartbeat timed out              */
+	HMI_EVENT_LOCKOUT,       /* value = TRUE while locked out, FALSE when the lockout is over (time in g_lockoutRemaining) */
+	HMI_EVENT_DOOR           /* value = door phase of a DOOR_PROGRESS (progress in g_doorProgress) */
+} HMI_EventType;
+
+typedef struct {
+	uint8 screen;            /* SCREEN_ID drawn on entry or HMI_NO_SCREEN */
+	uint8 flags;
+	uint16 timeout;          /* Ticks before going to timeoutNext, 0 for no timeout */
+	uint8 timeoutNext;
+	void (*entryAction)(void);
+} HMI_StateConfigType;
+
+typedef struct {
+	uint8 state;
+	uint8 event;             /* HMI_EventType */
+	uint8 value;
+	uint8 next;              /* HMI_StateID or HMI_STATE_SAME */
+	uint8 (*action)(uint8 next);   /* May redirect the transition by returning another state */
+} HMI_TransitionType;
 
 /*********************************************************************
  *                          Global variables                         *
  ********************************************************************/
 
-uint8 g_InputPassword[PASSWORD_LENGTH];   /* Global array to hold the values of the password entered by the user */
-uint8 g_Password_Match_Status;            /* Global variable to hold the Matching status between the two password sent to Control ECU */
-uint16 g_sec = 0;                         /* Global variable that is incremented inside Timer1 ISR every interrupt (1 Second) */
-uint8 g_wrongPasswordCounter=0;           /* Global variable that is used as counter of number of wrong passwords entered */
+uint8 g_InputPassword[ACCESS_CODE_LENGTH];  /* Global array to hold the values of the password (or access code) entered by the user */
+uint8 g_passwordLength = 0;               /* Number of digits entered so far */
+uint8 g_selectedOption = 0;               /* Option byte sent to Control ECU with the password */
+uint8 g_adminPassword[PASSWORD_LENGTH];   /* Administrator password sent with the users requests */
+uint8 g_oldPassword[PASSWORD_LENGTH];     /* Current password, sent with the new one once it is confirmed */
+uint8 g_newPassword[PASSWORD_LENGTH];     /* New password, matched with its confirmation on this ECU */
+uint8 g_userId = 0;                       /* User number entered for an add or a revoke request */
+uint8 g_userRequest = 0;                  /* Users request selected in the users menu */
+uint8 g_userResult = 0;                   /* USER_RESULT status or USER_LIST_END count of the Control ECU */
+uint16 g_lockoutRemaining = 0;            /* Lockout seconds left as pushed by the Control ECU, the HMI never counts them itself */
+uint8 g_doorPeriods[DOOR_PERIODS_PAYLOAD] = { 15, 3, 15 };   /* Unlocking, left open and locking seconds of the last UNLOCKING_DOOR */
+uint8 g_doorProgress[DOOR_PROGRESS_PAYLOAD] = { DOOR_PHASE_CLOSED, 100, 0 };  /* Phase, percentage done and remaining seconds of the last DOOR_PROGRESS */
+uint8 g_doorShownSeconds = 0;                                /* Remaining seconds on the door screen, redrawn when they change */
+LCD_ProgressBarType g_doorBar;                               /* Progress bar of the door screen */
+volatile uint16 g_ticks = 0;              /* Global variable that is incremented inside Timer1 ISR every interrupt (10 ms) */
+
+uint8 g_currentState = HMI_STATE_MAIN_MENU;    /* Current UI state */
+HMI_StateConfigType g_currentStateConfig;      /* RAM copy of the current state entry of the states table */
+uint16 g_stateEntryTick = 0;                   /* System tick when the current state was entered */
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 /*
- * Description: Function to display the application main options
+ * Description: Timer Call Back Function the is related to HMI Module
  */
-void HMI_AppMainOptions();
+void HMI_timerCallBack(void);
 
 /*
- * Description: Function to Initialize System Password
+ * Description: Function to read the system tick counter atomically
  */
-void HMI_SystemPasswordInit(uint8 *password);
+uint16 HMI_getTicks(void);
 
 /*
- * Description: Function to get password as an input from the keypad and store it in a global array
+ * Description: Function to enter a new UI state, draw its screen and run its entry action
  */
-void HMI_getPassword(uint8 *password);
+void HMI_enterState(uint8 state);
 
 /*
- * Description: Function to send the entered password Byte by Byte to the Control ECU By UART
+ * Description: Function to look up the event in the transitions table of the current state and apply it
  */
-void HMI_sendPasswordByUART(uint8 *password);
+void HMI_dispatchEvent(HMI_EventType event, uint8 value);
 
 /*
- * Description: Timer Call Back Function the is related to HMI Module
+ * Description: Function to scan the keypad once per tick and return a debounced key press or KEYPAD_NO_KEY_PRESSED
  */
-void HMI_timerCallBack(void);
+uint8 HMI_pollKey(void);
+
+/*
+ * Description: Function to handle a key press, collecting the password digits in password input states
+ */
+void HMI_handleKey(uint8 key);
+
+/*
+ * Description: Function to feed a byte received by UART to the link and dispatch the resulting event
+ */
+void HMI_handleByte(uint8 data);
 
 /*
- * Description: A function that displays on LCD that door is opening or closing for a certain period of time
+ * Description: Function to send a one byte message to the Control ECU through the link
  */
-void HMI_OpenDoor(void);
+void HMI_sendRequest(uint8 request);
 
 #endif /* HMI_APPLICATION_H_ */
@@ -0,0 +1,227 @@
+ /******************************************************************************
+ *
+ * Module: BAUD
+ *
+ * File Name: baud.c
+ *
+ * Description: Source file for the negotiation of the fastest UART baud rate of the link
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include "baud.h"
+#include "link.h"
+#include "trace.h"
+#include "watchdog.h"
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static BAUD_ConfigType g_baudConfig;
+static UART_BaudType g_baudCurrent;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static void BAUD_send(uint8 type, uint8 rate);
+static void BAUD_sendCheckBurst(uint8 rate);
+static uint8 BAUD_waitCheckBurst(uint8 rate);
+static const uint8 *BAUD_waitMessage(uint8 type, uint8 length);
+static void BAUD_switch(UART_BaudType baud);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Keep the configuration, the UART must already run at the boot rate.
+ */
+void BAUD_init(const BAUD_ConfigType *configPtr)
+{
+	g_baudConfig = *configPtr;
+	g_baudCurrent = g_baudConfig.boot;
+}
+
+/*
+ * Description :
+ * Initiator: agree with the peer on the fastest rate that passes the check, from the
+ * fastest one down. Blocks up to one timeout per message awaited, call it right after a new
+ * session (a peer that does not know the messages leaves the link at its current rate).
+ */
+void BAUD_negotiate(void)
+{
+	const uint8 *message;
+	uint8 proposed = g_baudConfig.fastest;
+	uint8 rate;
+
+	while (proposed > g_baudConfig.boot)
+	{
+		BAUD_send(BAUD_PROPOSE_MESSAGE, proposed);
+		message = BAUD_waitMessage(BAUD_ACCEPT_MESSAGE, BAUD_MESSAGE_LENGTH);
+		if ((message == NULL_PTR) || (message[1] > proposed))
+			return;
+		rate = message[1];
+
+		BAUD_switch((rate < g_baudConfig.boot) ? g_baudConfig.boot : (UART_BaudType)rate);
+		if (g_baudCurrent == g_baudConfig.boot)
+			return;
+
+		BAUD_sendCheckBurst(rate);
+		if (BAUD_waitCheckBurst(rate))
+			return;
+
+		/* The responder gave up at the end of its own timeout, which started first */
+		proposed = g_baudCurrent - 1;
+		BAUD_switch(g_baudConfig.boot);
+	}
+}
+
+/*
+ * Description :
+ * Responder: answer a PROPOSE message and check the new rate (blocks up to one timeout per CHECK).
+ * Return TRUE if the message was one of the negotiation.
+ */
+uint8 BAUD_handleMessage(const uint8 *message, uint8 length)
+{
+	uint8 rate;
+
+	if ((length == 0) || (message[0] < BAUD_PROPOSE_MESSAGE) || (message[0] > BAUD_CHECK_MESSAGE))
+		return FALSE;
+
+	/* A late CHECK of a negotiation given up is dropped */
+	if ((message[0] != BAUD_PROPOSE_MESSAGE) || (length != BAUD_MESSAGE_LENGTH))
+		return TRUE;
+
+	rate = (message[1] < g_baudConfig.fastest) ? message[1] : g_baudConfig.fastest;
+	if (rate < g_baudConfig.boot)
+	{
+		rate = g_baudConfig.boot;
+	}
+	BAUD_send(BAUD_ACCEPT_MESSAGE, rate);
+	BAUD_switch((UART_BaudType)rate);
+	if (g_baudCurrent == g_baudConfig.boot)
+		return TRUE;
+
+	if (BAUD_waitCheckBurst(rate))
+	{
+		BAUD_sendCheckBurst(rate);
+	}
+	else
+	{
+		BAUD_switch(g_baudConfig.boot);
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Go back to the boot rate, called when the peer stopped answering: a peer that was reset
+ * (or dropped a rate) runs at the boot rate.
+ */
+void BAUD_fallback(void)
+{
+	if (g_baudCurrent != g_baudConfig.boot)
+	{
+		BAUD_switch(g_baudConfig.boot);
+	}
+}
+
+UART_BaudType BAUD_getCurrent(void)
+{
+	return g_baudCurrent;
+}
+
+static void BAUD_send(uint8 type, uint8 rate)
+{
+	uint8 message[BAUD_MESSAGE_LENGTH];
+
+	message[0] = type;
+	message[1] = rate;
+	(void)LINK_sendMessage(message, BAUD_MESSAGE_LENGTH);
+}
+
+/*
+ * Description :
+ * Send the CHECK messages of a burst, LINK_sendMessage queues each one while the previous
+ * frame is shifted out so they leave back to back.
+ */
+static void BAUD_sendCheckBurst(uint8 rate)
+{
+	uint8 message[BAUD_CHECK_LENGTH];
+	uint8 i;
+
+	message[0] = BAUD_CHECK_MESSAGE;
+	message[1] = rate;
+	for (i = 3; i < BAUD_CHECK_LENGTH; i++)
+	{
+		message[i] = 0x55;                         /* Alternate bits, the fill only makes full frames */
+	}
+	for (i = 0; i < BAUD_CHECK_BURST; i++)
+	{
+		message[2] = i;
+		(void)LINK_sendMessage(message, BAUD_CHECK_LENGTH);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE once every CHECK message of a burst arrived in order, none may be missing.
+ */
+static uint8 BAUD_waitCheckBurst(uint8 rate)
+{
+	const uint8 *message;
+	uint8 i;
+
+	for (i = 0; i < BAUD_CHECK_BURST; i++)
+	{
+		message = BAUD_waitMessage(BAUD_CHECK_MESSAGE, BAUD_CHECK_LENGTH);
+		if ((message == NULL_PTR) || (message[1] != rate) || (message[2] != i))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Feed the received bytes to the link until a message of the type and length arrives or
+ * the timeout is over, NULL_PTR then. The other messages and the diagnostics requests are
+ * dropped meanwhile, a line error fails the wait: the rate is not reliable.
+ */
+static const uint8 *BAUD_waitMessage(uint8 type, uint8 length)
+{
+	uint32 start = TRACE_getMicroseconds();
+	const uint8 *message;
+	uint8 received;
+	uint8 data;
+
+	while ((TRACE_getMicroseconds() - start) < ((uint32)g_baudConfig.timeout * 1000))
+	{
+		WDG_checkIn(g_baudConfig.wdgTask);
+		if (!UART_isByteReceived())
+			continue;
+
+		if (UART_readByte(&data) != UART_RX_OK)
+		{
+			LINK_resync();
+			return NULL_PTR;
+		}
+		if (LINK_receiveByte(data) != LINK_RX_MESSAGE)
+			continue;
+
+		message = LINK_getMessage(&received);
+		if ((received == length) && (message[0] == type))
+			return message;
+	}
+	return NULL_PTR;
+}
+
+static void BAUD_switch(UART_BaudType baud)
+{
+	UART_setBaud(baud);
+	g_baudCurrent = baud;
+	TRACE_record(TRACE_EVT_BAUD_CHANGE, baud);
+}
@@ -0,0 +1,132 @@
+ /******************************************************************************
+ *
+ * Module: HMI SCREENS
+ *
+ * File Name: hmi_screens.c
+ *
+ * Description: Source file for the HMI screens table stored in flash
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/pgmspace.h>
+#include "hmi_screens.h"
+#include "lcd.h"
+
+/*******************************************************************************
+ *                           Screens Strings                                   *
+ *******************************************************************************/
+
+/* All the UI text lives in flash only, nothing is copied to .data at startup */
+static const char g_strOpenDoorOption[]    PROGMEM = "+:Door  =:Users";
+static const char g_strChangePassOption[]  PROGMEM = "-:Pass  *:Code";
+static const char g_strEnterPass[]         PROGMEM = "Enter the pass: ";
+static const char g_strEnterNewPass[]      PROGMEM = "Enter a Password: ";
+static const char g_strReEnterPass[]       PROGMEM = "Re-Enter the same";
+static const char g_strPasswordLabel[]     PROGMEM = "password: ";
+static const char g_strWrongPassword[]     PROGMEM = "Wrong Password";
+static const char g_strPasswordMismatch[]  PROGMEM = "PASSWORD MISMATCH";
+static const char g_strDoorUnlocking[]     PROGMEM = "Door is unlocking";
+static const char g_strDoorOpen[]          PROGMEM = "Door is now open";
+static const char g_strDoorLocking[]       PROGMEM = "Door is locking";
+static const char g_strWatchdogReset[]     PROGMEM = "Watchdog reset";
+static const char g_strStuckState[]        PROGMEM = "Stuck state: ";
+static const char g_strKeypadLocked[]      PROGMEM = "Keypad locked";
+static const char g_strRetryIn[]           PROGMEM = "Retry in: ";
+static const char g_strPleaseWait[]        PROGMEM = "Please wait...";
+static const char g_strEnterCode[]         PROGMEM = "Access code: ";
+static const char g_strCodesDisabled[]     PROGMEM = "Codes disabled";
+static const char g_strClockNotSet[]       PROGMEM = "Clock not set";
+static const char g_strUserMenu[]          PROGMEM = "1:Add 2:Revoke";
+static const char g_strListOption[]        PROGMEM = "3:List";
+static const char g_strAdminPass[]         PROGMEM = "Admin password: ";
+static const char g_strUserId[]            PROGMEM = "User number: ";
+static const char g_strUserCode[]          PROGMEM = "User password: ";
+static const char g_strDone[]              PROGMEM = "Done";
+static const char g_strRefused[]           PROGMEM = "Refused";
+static const char g_strUnknownOrUsed[]     PROGMEM = "Unknown or used";
+static const char g_strUsersFull[]         PROGMEM = "No free slot";
+static const char g_strUsersLabel[]        PROGMEM = "Users: ";
+static const char g_strController[]        PROGMEM = "Controller";
+static const char g_strOffline[]           PROGMEM = "offline";
+
+/*******************************************************************************
+ *                           Custom Characters                                 *
+ *******************************************************************************/
+
+/* 5x8 dots, one row per byte from the top */
+static const uint8 g_glyphLocked[LCD_GLYPH_HEIGHT]   PROGMEM = { 0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00 };
+static const uint8 g_glyphUnlocked[LCD_GLYPH_HEIGHT] PROGMEM = { 0x0E, 0x10, 0x10, 0x1F, 0x1B, 0x1B, 0x1F, 0x00 };
+
+/*******************************************************************************
+ *                           Screens Table                                     *
+ *******************************************************************************/
+
+/* Indexed by SCREEN_ID */
+static const SCREEN_ConfigType g_screens[SCREEN_COUNT] PROGMEM = {
+	{ g_strOpenDoorOption,   g_strChangePassOption, SCREEN_NO_CURSOR, 0  },  /* SCREEN_MAIN_MENU         */
+	{ g_strEnterPass,        NULL_PTR,              1,                0  },  /* SCREEN_ENTER_PASSWORD    */
+	{ g_strEnterNewPass,     NULL_PTR,              1,                0  },  /* SCREEN_NEW_PASSWORD      */
+	{ g_strReEnterPass,      g_strPasswordLabel,    1,                10 },  /* SCREEN_CONFIRM_PASSWORD  */
+	{ g_strWrongPassword,    NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_WRONG_PASSWORD    */
+	{ g_strPasswordMismatch, NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_PASSWORD_MISMATCH */
+	{ g_strDoorUnlocking,    NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_DOOR_UNLOCKING    */
+	{ g_strDoorOpen,         NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_DOOR_OPEN         */
+	{ g_strDoorLocking,      NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_DOOR_LOCKING      */
+	{ g_strWatchdogReset,    NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_WATCHDOG_RESET    */
+	{ g_strWatchdogReset,    g_strStuckState,       1,                13 },  /* SCREEN_WATCHDOG_HANG     */
+	{ g_strKeypadLocked,     g_strRetryIn,          1,                SCREEN_LOCKOUT_TIME_COLUMN },  /* SCREEN_KEYPAD_LOCKED */
+	{ g_strPleaseWait,       NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_PLEASE_WAIT       */
+	{ g_strEnterCode,        NULL_PTR,              1,                0  },  /* SCREEN_ENTER_CODE        */
+	{ g_strCodesDisabled,    g_strClockNotSet,      SCREEN_NO_CURSOR, 0  },  /* SCREEN_CODE_UNAVAILABLE  */
+	{ g_strUserMenu,         g_strListOption,       SCREEN_NO_CURSOR, 0  },  /* SCREEN_USER_MENU         */
+	{ g_strAdminPass,        NULL_PTR,              1,                0  },  /* SCREEN_ADMIN_PASSWORD    */
+	{ g_strUserId,           NULL_PTR,              1,                0  },  /* SCREEN_USER_ID           */
+	{ g_strUserCode,         NULL_PTR,              1,                0  },  /* SCREEN_USER_CODE         */
+	{ g_strDone,             NULL_PTR,              SCREEN_NO_CURSOR, 0  },  /* SCREEN_USER_DONE         */
+	{ g_strRefused,          g_strUnknownOrUsed,    SCREEN_NO_CURSOR, 0  },  /* SCREEN_USER_REFUSED      */
+	{ g_strRefused,          g_strUsersFull,        SCREEN_NO_CURSOR, 0  },  /* SCREEN_USERS_FULL        */
+	{ g_strUsersLabel,       NULL_PTR,              0,                7  },  /* SCREEN_USER_COUNT        */
+	{ g_strController,       g_strOffline,          SCREEN_NO_CURSOR, 0  },  /* SCREEN_CONTROLLER_OFFLINE */
+};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Upload the custom characters of the screens, after LCD_init.
+ */
+void SCREEN_init(void)
+{
+	LCD_defineGlyph_P(SCREEN_GLYPH_LOCKED, g_glyphLocked);
+	LCD_defineGlyph_P(SCREEN_GLYPH_UNLOCKED, g_glyphUnlocked);
+}
+
+/*
+ * Description :
+ * Clear the LCD, display the two lines of the required screen directly from flash
+ * and move the cursor to the input position of the screen.
+ */
+void SCREEN_show(SCREEN_ID screen)
+{
+	SCREEN_ConfigType config;
+
+	if (screen >= SCREEN_COUNT)
+		return;
+
+	memcpy_P(&config, &g_screens[screen], sizeof(SCREEN_ConfigType));
+
+	LCD_clearScreen();
+	LCD_displayStringRowColumn_P(0, 0, config.firstLine);
+	if (config.secondLine != NULL_PTR)
+	{
+		LCD_displayStringRowColumn_P(1, 0, config.secondLine);
+	}
+	if (config.cursorRow != SCREEN_NO_CURSOR)
+	{
+		LCD_moveCursor(config.cursorRow, config.cursorCol);
+	}
+}
@@ -0,0 +1,90 @@
+ /******************************************************************************
+ *
+ * Module: HMI SCREENS
+ *
+ * File Name: hmi_screens.h
+ *
+ * Description: Header file for the HMI screens table stored in flash
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef HMI_SCREENS_H_
+#define HMI_SCREENS_H_
+
+#include "std_types.h"
+#include "lcd.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Cursor row value of the screens that do not take any input */
+#define SCREEN_NO_CURSOR          0xFF
+
+/* Column where the remaining lockout time is written on the second line of SCREEN_KEYPAD_LOCKED */
+#define SCREEN_LOCKOUT_TIME_COLUMN  10
+
+/* Second line of the door screens: lock icon, progress bar then the remaining seconds */
+#define SCREEN_PROGRESS_COLUMN      2
+#define SCREEN_PROGRESS_WIDTH       10        /* 50 columns of dots, one per 2% */
+#define SCREEN_PROGRESS_TIME_COLUMN 13
+
+/* Custom characters loaded by SCREEN_init (CGRAM slots left free by the LCD driver) */
+#define SCREEN_GLYPH_LOCKED         (LCD_GLYPH_USER_FIRST + 0)
+#define SCREEN_GLYPH_UNLOCKED       (LCD_GLYPH_USER_FIRST + 1)
+
+typedef enum {
+	SCREEN_MAIN_MENU,
+	SCREEN_ENTER_PASSWORD,
+	SCREEN_NEW_PASSWORD,
+	SCREEN_CONFIRM_PASSWORD,
+	SCREEN_WRONG_PASSWORD,
+	SCREEN_PASSWORD_MISMATCH,
+	SCREEN_DOOR_UNLOCKING,
+	SCREEN_DOOR_OPEN,
+	SCREEN_DOOR_LOCKING,
+	SCREEN_WATCHDOG_RESET,
+	SCREEN_WATCHDOG_HANG,
+	SCREEN_KEYPAD_LOCKED,
+	SCREEN_PLEASE_WAIT,
+	SCREEN_ENTER_CODE,
+	SCREEN_CODE_UNAVAILABLE,
+	SCREEN_USER_MENU,
+	SCREEN_ADMIN_PASSWORD,
+	SCREEN_USER_ID,
+	SCREEN_USER_CODE,
+	SCREEN_USER_DONE,
+	SCREEN_USER_REFUSED,
+	SCREEN_USERS_FULL,
+	SCREEN_USER_COUNT,
+	SCREEN_CONTROLLER_OFFLINE,
+	SCREEN_COUNT
+} SCREEN_ID;
+
+typedef struct {
+	const char *firstLine;      /* PROGMEM string */
+	const char *secondLine;     /* PROGMEM string or NULL_PTR */
+	uint8 cursorRow;            /* Where the input (or a value) is written after the text, or SCREEN_NO_CURSOR */
+	uint8 cursorCol;
+} SCREEN_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Upload the custom characters of the screens, after LCD_init.
+ */
+void SCREEN_init(void);
+
+/*
+ * Description :
+ * Clear the LCD, display the two lines of the required screen directly from flash
+ * and move the cursor to the input position of the screen.
+ */
+void SCREEN_show(SCREEN_ID screen);
+
+#endif /* HMI_SCREENS_H_ */
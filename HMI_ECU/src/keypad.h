@@ -35,6 +35,9 @@
 #define KEYPAD_BUTTON_PRESSED            LOGIC_LOW
 #define KEYPAD_BUTTON_RELEASED           LOGIC_HIGH
 
+/* Returned by KEYPAD_scanKey when no button is pressed (0 is a valid key) */
+#define KEYPAD_NO_KEY_PRESSED            0xFF
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -45,4 +48,11 @@
  */
 uint8 KEYPAD_getPressedKey(void);
 
+/*
+ * Description :
+ * Scan the keypad once without blocking,
+ * Return the pressed button or KEYPAD_NO_KEY_PRESSED.
+ */
+uint8 KEYPAD_scanKey(void);
+
 #endif /* KEYPAD_H_ */
@@ -14,6 +14,8 @@
 
 #include <stdlib.h>       /* For itoa Function */
 #include <util/delay.h>   /* For the delay functions */
+#include <avr/pgmspace.h> /* For reading the strings stored in flash */
+#include <string.h>       /* For memset Function */
 #include "lcd.h"
 #include "Macros.h"
 
@@ -30,6 +32,9 @@
  */
 void LCD_init(void)
 {
+	uint8 pattern[LCD_GLYPH_HEIGHT];
+	uint8 i;
+
 	/* Configure the direction for RS and E pins as output pins */
 	GPIO_setupPinDirection(LCD_RS_PORT_ID, LCD_RS_PIN_ID, PIN_OUTPUT);
 	GPIO_setupPinDirection(LCD_E_PORT_ID, LCD_E_PIN_ID, PIN_OUTPUT);
@@ -64,7 +69,15 @@ void LCD_init(void)
 #endif
 
 	LCD_sendCommand(LCD_CURSOR_OFF);      /* Cursor off */
-	LCD_sendCommand(LCD_CLEAR_SCREEN);    /* Clear LCD at the beginning */
+
+	/* Partial blocks of the progress bar: the dots on fill the glyph from the left */
+	for (i = 1; i < LCD_GLYPH_WIDTH; i++)
+	{
+		memset(pattern, (0x1F << (LCD_GLYPH_WIDTH - i)) & 0x1F, LCD_GLYPH_HEIGHT);
+		LCD_defineGlyph(LCD_GLYPH_BAR_FIRST + i - 1, pattern);
+	}
+
+	LCD_sendCommand(LCD_CLEAR_SCREEN);    /* Clear LCD at the beginning (back to DDRAM address 0) */
 }
 
 /*
@@ -186,6 +199,22 @@ void LCD_displayString(const char *Str)
 	 *********************************************************/
 }
 
+/*
+ * Description :
+ * Display the required string stored in the flash memory (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str)
+{
+	uint8 character;
+
+	/* Every character is read from flash, the string is never copied to RAM */
+	while ((character = pgm_read_byte(Str)) != '\0')
+	{
+		LCD_displayCharacter(character);
+		Str++;
+	}
+}
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -224,13 +253,23 @@ void LCD_displayStringRowColumn(uint8 row, uint8 col, const char *Str)
 	LCD_displayString(Str);       /* display the string */
 }
 
+/*
+ * Description :
+ * Display the required string stored in the flash memory (PROGMEM) in a specified row and column index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row, uint8 col, const char *Str)
+{
+	LCD_moveCursor(row, col);     /* go to to the required LCD position */
+	LCD_displayString_P(Str);     /* display the string */
+}
+
 /*
  * Description :
  * Display the required decimal value on the screen
  */
 void LCD_integerToString(int data)
 {
-	char buff[16];             /* String to hold the ASCII result */
+	char buff[7];              /* String to hold the ASCII result, the longest int is "-32768" */
 	itoa(data, buff, 10);      /* Use itoa C function to convert the data to its corresponding ASCII value, 10 for decimal */
 	LCD_displayString(buff);   /* Display the string */
 }
@@ -243,3 +282,93 @@ void LCD_clearScreen(void)
 {
 	LCD_sendCommand(LCD_CLEAR_SCREEN); /* Send clear display command */
 }
+
+/*
+ * Description :
+ * Upload a custom 5x8 character (LCD_GLYPH_HEIGHT rows, 5 low bits each) in a CGRAM slot, from RAM.
+ * The cursor position is lost, move it before writing text.
+ */
+void LCD_defineGlyph(uint8 index, const uint8 *pattern)
+{
+	uint8 i;
+
+	/* The data writes go to CGRAM from this address on, one row per byte */
+	LCD_sendCommand(LCD_SET_CGRAM_ADDRESS | ((index % LCD_GLYPH_COUNT) * LCD_GLYPH_HEIGHT));
+	for (i = 0; i < LCD_GLYPH_HEIGHT; i++)
+	{
+		LCD_displayCharacter(pattern[i]);
+	}
+}
+
+/*
+ * Description :
+ * Same as LCD_defineGlyph with the pattern read from the flash memory (PROGMEM).
+ */
+void LCD_defineGlyph_P(uint8 index, const uint8 *pattern)
+{
+	uint8 rows[LCD_GLYPH_HEIGHT];
+
+	memcpy_P(rows, pattern, LCD_GLYPH_HEIGHT);
+	LCD_defineGlyph(index, rows);
+}
+
+/*
+ * Description :
+ * Draw an empty progress bar of width cells at a row and column index on the screen
+ */
+void LCD_progressInit(LCD_ProgressBarType *bar, uint8 row, uint8 col, uint8 width)
+{
+	uint8 i;
+
+	bar->row = row;
+	bar->col = col;
+	bar->width = width;
+	bar->filled = 0;
+
+	LCD_moveCursor(row, col);
+	for (i = 0; i < width; i++)
+	{
+		LCD_displayCharacter(' ');
+	}
+}
+
+/*
+ * Description :
+ * Fill the bar up to a percentage with a resolution of one column of dots. Only the cells
+ * whose dots change are written: a move of the cursor and one character per step.
+ */
+void LCD_progressUpdate(LCD_ProgressBarType *bar, uint8 percent)
+{
+	uint8 filled, first, last, cell, dots;
+
+	if (percent > 100)
+	{
+		percent = 100;
+	}
+	filled = (uint8)(((uint16)percent * bar->width * LCD_GLYPH_WIDTH) / 100);
+	if (filled == bar->filled)
+		return;
+
+	/* Cells between the old and the new end of the bar, written left to right (auto increment) */
+	first = ((filled < bar->filled) ? filled : bar->filled) / LCD_GLYPH_WIDTH;
+	last = (((filled > bar->filled) ? filled : bar->filled) - 1) / LCD_GLYPH_WIDTH;
+	bar->filled = filled;
+
+	LCD_moveCursor(bar->row, bar->col + first);
+	for (cell = first; cell <= last; cell++)
+	{
+		dots = (filled > (cell * LCD_GLYPH_WIDTH)) ? (filled - (cell * LCD_GLYPH_WIDTH)) : 0;
+		if (dots == 0)
+		{
+			LCD_displayCharacter(' ');
+		}
+		else if (dots >= LCD_GLYPH_WIDTH)
+		{
+			LCD_displayCharacter(LCD_GLYPH_FULL);
+		}
+		else
+		{
+			LCD_displayCharacter(LCD_GLYPH_BAR_FIRST + dots - 1);
+		}
+	}
+}
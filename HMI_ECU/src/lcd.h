@@ -64,6 +64,7 @@
 #define LCD_SET_CURSOR_ON_SECOND_ROW         0xC0
 
 #define LCD_SET_CURSOR_LOCATION              0x80     /* Used in MoveCursor(row,col) Function */
+#define LCD_SET_CGRAM_ADDRESS                0x40     /* Used in DefineGlyph(index,pattern) Function */
 
 #define LCD_MOVE_CURSOR_RIGHT                0x06
 #define LCD_MOVE_CURSOR_LEFT                 0x04
@@ -81,6 +82,26 @@
 
 #define LCD_TWO_LINES_EIGHT_BITS_MODE        0x38
 
+/*
+ * Custom 5x8 characters (CGRAM), displayed with their index as character code. Slots 0 to 3
+ * hold the partial blocks of the progress bar (1 to 4 columns of dots, from the left), loaded
+ * by LCD_init, slots 4 to 7 are free for LCD_defineGlyph.
+ */
+#define LCD_GLYPH_COUNT                      8
+#define LCD_GLYPH_HEIGHT                     8
+#define LCD_GLYPH_WIDTH                      5        /* Columns of dots per character */
+#define LCD_GLYPH_BAR_FIRST                  0
+#define LCD_GLYPH_USER_FIRST                 4
+#define LCD_GLYPH_FULL                       0xFF     /* All dots on, from the character ROM */
+
+/* Progress bar drawn by LCD_progressUpdate, only the cells that change are written */
+typedef struct {
+	uint8 row;
+	uint8 col;
+	uint8 width;          /* Cells of the bar              */
+	uint8 filled;         /* Columns of dots currently on  */
+} LCD_ProgressBarType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -111,6 +132,12 @@ void LCD_displayCharacter(uint8 data);
  */
 void LCD_displayString(const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in the flash memory (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str);
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -123,6 +150,12 @@ void LCD_moveCursor(uint8 row,uint8 col);
  */
 void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in the flash memory (PROGMEM) in a specified row and column index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str);
+
 /*
  * Description :
  * Display the required decimal value on the screen
@@ -135,4 +168,25 @@ void LCD_integerToString(int data);
  */
 void LCD_clearScreen(void);
 
+/*
+ * Description :
+ * Upload a custom 5x8 character (LCD_GLYPH_HEIGHT rows, 5 low bits each) in a CGRAM slot, from RAM
+ * or from the flash memory (PROGMEM). The cursor position is lost, move it before writing text.
+ */
+void LCD_defineGlyph(uint8 index, const uint8 *pattern);
+void LCD_defineGlyph_P(uint8 index, const uint8 *pattern);
+
+/*
+ * Description :
+ * Draw an empty progress bar of width cells at a row and column index on the screen
+ */
+void LCD_progressInit(LCD_ProgressBarType *bar, uint8 row, uint8 col, uint8 width);
+
+/*
+ * Description :
+ * Fill the bar up to a percentage with a resolution of one column of dots. Only the cells
+ * whose dots change are written: a move of the cursor and one character per step.
+ */
+void LCD_progressUpdate(LCD_ProgressBarType *bar, uint8 percent);
+
 #endif /* LCD_H_ */
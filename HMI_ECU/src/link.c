@@ -0,0 +1,634 @@
+ /******************************************************************************
+ *
+ * Module: LINK
+ *
+ * File Name: link.c
+ *
+ * Description: Source file for the authenticated and encrypted HMI <-> Control session layer
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "link.h"
+#include "speck.h"
+#include "trace.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Offsets in a frame (after the SOF) */
+#define LINK_LENGTH_OFFSET         0
+#define LINK_TYPE_OFFSET           1
+#define LINK_COUNTER_OFFSET        2
+#define LINK_PAYLOAD_OFFSET        LINK_HEADER_SIZE
+
+/* Room for the longest frame, or for a HELLO_ACK followed by the nonce it answers (tag input) */
+#define LINK_FRAME_BUFFER_SIZE     (LINK_HEADER_SIZE + LINK_MAX_PAYLOAD + LINK_TAG_SIZE)
+
+/* Labels of the session keys derivation */
+#define LINK_LABEL_ENCRYPTION      'E'
+#define LINK_LABEL_AUTHENTICATION  'M'
+
+#define LINK_BENCHMARK_BLOCKS      16
+
+/* Direction byte of the tags computed by the provisioning tool (the ECUs use their role) */
+#define LINK_TOOL_DIRECTION        2
+
+typedef struct {
+	SPECK_KeyType encryptionKey;
+	SPECK_CmacKeyType authenticationKey;
+	uint16 txCounter;              /* Counter of the last sent frame          */
+	uint16 rxCounter;              /* Counter of the last accepted frame      */
+	uint8 connected;
+} LINK_SessionType;
+
+/*******************************************************************************
+ *                           Global variables                                  *
+ *******************************************************************************/
+
+static const uint8 g_linkMasterKey[SPECK_KEY_SIZE] PROGMEM = LINK_MASTER_KEY;
+
+static LINK_ConfigType g_linkConfig;
+static LINK_SessionType g_linkSession;
+static uint32 g_linkBootCounter;
+static uint16 g_linkNonceCount = 0;                    /* Nonces generated during this boot */
+static uint8 g_linkLocalNonce[LINK_NONCE_SIZE];
+static uint8 g_linkHelloPending = FALSE;                /* Initiator waiting for the HELLO_ACK */
+static uint32 g_linkPeerBootCounter = 0;                /* Newest nonce of the peer accepted in a handshake: */
+static uint16 g_linkPeerNonceCount = 0;                 /* an older one is a replay                          */
+static uint8 g_linkPeerNonceSeen = FALSE;
+static uint8 g_linkToolChallenge[LINK_NONCE_SIZE];
+static uint8 g_linkToolChallengePending = FALSE;
+
+/* Frames sent from the UART interrupts, one is sealed while the other one is on the wire */
+static uint8 g_linkTxFrames[2][LINK_FRAME_BUFFER_SIZE];
+static uint8 g_linkTxFrameIndex = 0;
+static const uint8 g_linkSof = LINK_SOF;
+static uint8 g_linkRxFrame[LINK_FRAME_BUFFER_SIZE];
+static uint8 g_linkRxIndex = 0;
+static uint8 g_linkRxInFrame = FALSE;
+static uint8 g_linkMessage[LINK_MAX_PAYLOAD];
+static uint8 g_linkMessageLength = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static LINK_RxEventType LINK_processFrame(void);
+static void LINK_loadMasterKey(SPECK_CmacKeyType *masterKey);
+static void LINK_newNonce(void);
+static uint8 LINK_isPeerNonceFresh(const uint8 *nonce);
+static void LINK_acceptPeerNonce(const uint8 *nonce);
+static void LINK_deriveSession(const SPECK_CmacKeyType *masterKey, const uint8 *initiatorNonce, const uint8 *responderNonce);
+static void LINK_computeTag(const SPECK_CmacKeyType *key, uint8 direction, const uint8 *data, uint8 length, uint8 *tag);
+static uint8 LINK_isTagValid(const uint8 *expected, const uint8 *received);
+static void LINK_buildHeader(uint8 *frame, LINK_FrameType type, uint8 length, uint16 counter);
+static void LINK_seal(uint8 *frame, uint8 direction);
+static uint8 LINK_open(uint8 *frame, uint8 direction);
+static void LINK_sendHandshake(LINK_FrameType type, const uint8 *nonce, const uint8 *boundNonce);
+static uint8* LINK_nextTxFrame(void);
+static void LINK_sendFrame(const uint8 *frame);
+static void LINK_sendWord(uint16 data);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Increment the boot counter kept in the internal EEPROM (it makes every nonce of
+ * this boot unique) and reset the session.
+ */
+void LINK_init(const LINK_ConfigType *configPtr)
+{
+	g_linkConfig = *configPtr;
+
+	g_linkBootCounter = eeprom_read_dword((const uint32_t *)g_linkConfig.nonceEepromAddress) + 1;
+	eeprom_update_dword((uint32_t *)g_linkConfig.nonceEepromAddress, g_linkBootCounter);
+
+	g_linkSession.connected = FALSE;
+	g_linkHelloPending = FALSE;
+	g_linkPeerNonceSeen = FALSE;
+	g_linkRxInFrame = FALSE;
+}
+
+/*
+ * Description :
+ * Initiator: send a HELLO with a new nonce. Responder: send a REKEY so that the
+ * initiator starts a new session (used at boot).
+ */
+void LINK_connect(void)
+{
+	if (g_linkConfig.role == LINK_ROLE_INITIATOR)
+	{
+		g_linkSession.connected = FALSE;
+		LINK_newNonce();
+		LINK_sendHandshake(LINK_FRAME_HELLO, g_linkLocalNonce, NULL_PTR);
+		g_linkHelloPending = TRUE;
+	}
+	else
+	{
+		/* A fresh nonce, so the initiator can tell this REKEY from a replayed one */
+		LINK_newNonce();
+		LINK_sendHandshake(LINK_FRAME_REKEY, g_linkLocalNonce, NULL_PTR);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE while a session is established.
+ */
+uint8 LINK_isConnected(void)
+{
+	return g_linkSession.connected;
+}
+
+/*
+ * Description :
+ * Feed one byte received by the UART, frames are checked and decrypted once complete.
+ * Old, replayed, reflected or forged frames are dropped.
+ */
+LINK_RxEventType LINK_receiveByte(uint8 data)
+{
+	LINK_RxEventType event;
+
+	if (!g_linkRxInFrame)
+	{
+		if (data != LINK_SOF)
+			return LINK_RX_RAW;
+
+		g_linkRxInFrame = TRUE;
+		g_linkRxIndex = 0;
+		return LINK_RX_NONE;
+	}
+
+	g_linkRxFrame[g_linkRxIndex] = data;
+	g_linkRxIndex++;
+
+	if ((g_linkRxIndex == 1) && (data > LINK_MAX_PAYLOAD))
+	{
+		g_linkRxInFrame = FALSE;       /* Not a frame, hunt for the next SOF */
+		return LINK_RX_NONE;
+	}
+
+	if (g_linkRxIndex == (LINK_HEADER_SIZE + g_linkRxFrame[LINK_LENGTH_OFFSET] + LINK_TAG_SIZE))
+	{
+		event = LINK_processFrame();
+
+		/* One record per frame, the ring keeps the handshake steps and the states around it */
+		TRACE_record(TRACE_EVT_LINK_RX, ((uint16)event << 12) | ((uint16)g_linkRxFrame[LINK_TYPE_OFFSET] << 8) |
+					 g_linkRxFrame[LINK_LENGTH_OFFSET]);
+		g_linkRxInFrame = FALSE;
+		return event;
+	}
+
+	return LINK_RX_NONE;
+}
+
+/*
+ * Description :
+ * Drop the frame being received after a line error, the next byte hunts for a SOF again.
+ */
+void LINK_resync(void)
+{
+	g_linkRxInFrame = FALSE;
+}
+
+/*
+ * Description :
+ * Return the payload of the last message (valid until the next LINK_receiveByte) and its length.
+ */
+const uint8* LINK_getMessage(uint8 *length)
+{
+	*length = g_linkMessageLength;
+	return g_linkMessage;
+}
+
+/*
+ * Description :
+ * Encrypt, authenticate and send a message, return FALSE if there is no session.
+ */
+uint8 LINK_sendMessage(const uint8 *payload, uint8 length)
+{
+	uint8 *frame;
+
+	if ((!g_linkSession.connected) || (length > LINK_MAX_PAYLOAD))
+		return FALSE;
+
+	/* The counter must never repeat within a session, a new session is needed after 65535 frames */
+	if (g_linkSession.txCounter == 0xFFFF)
+	{
+		g_linkSession.connected = FALSE;
+		return FALSE;
+	}
+	g_linkSession.txCounter++;
+
+	frame = LINK_nextTxFrame();
+	LINK_buildHeader(frame, LINK_FRAME_DATA, length, g_linkSession.txCounter);
+	memcpy(&frame[LINK_PAYLOAD_OFFSET], payload, length);
+	LINK_seal(frame, g_linkConfig.role);
+	LINK_sendFrame(frame);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Send a fresh challenge in clear through UART for a provisioning tool request that
+ * arrives outside the session: 'L' 'C' challenge(8).
+ */
+void LINK_sendToolChallenge(void)
+{
+	uint8 i;
+
+	LINK_newNonce();
+	memcpy(g_linkToolChallenge, g_linkLocalNonce, LINK_NONCE_SIZE);
+	g_linkToolChallengePending = TRUE;
+
+	UART_sendByte(LINK_CHALLENGE_SYNC1);
+	UART_sendByte(LINK_CHALLENGE_SYNC2);
+	for (i = 0; i < LINK_NONCE_SIZE; i++)
+	{
+		UART_sendByte(g_linkToolChallenge[i]);
+	}
+}
+
+/*
+ * Description :
+ * Check the answer of the provisioning tool: tag = CMAC(master key, 2 || challenge || data)
+ * truncated to LINK_TAG_SIZE. The challenge is used once, so an answer cannot be replayed.
+ */
+uint8 LINK_isToolTagValid(const uint8 *data, uint8 length, const uint8 *tag)
+{
+	SPECK_CmacKeyType masterKey;
+	uint8 input[LINK_NONCE_SIZE + LINK_TOOL_DATA_MAX];
+	uint8 expectedTag[SPECK_BLOCK_SIZE];
+
+	if ((!g_linkToolChallengePending) || (length > LINK_TOOL_DATA_MAX))
+		return FALSE;
+	g_linkToolChallengePending = FALSE;
+
+	memcpy(input, g_linkToolChallenge, LINK_NONCE_SIZE);
+	memcpy(&input[LINK_NONCE_SIZE], data, length);
+	LINK_loadMasterKey(&masterKey);
+	LINK_computeTag(&masterKey, LINK_TOOL_DIRECTION, input, LINK_NONCE_SIZE + length, expectedTag);
+	return LINK_isTagValid(expectedTag, tag);
+}
+
+/*
+ * Description :
+ * Measure the cipher and send the report through UART, all values are little-endian
+ * microseconds: 'L' 'B' blockTime(2) sealTime(2) openTime(2)
+ * where seal/open is the cost of a frame with the largest payload.
+ */
+void LINK_sendBenchmark(void)
+{
+	uint8 frame[LINK_FRAME_BUFFER_SIZE];
+	uint8 block[SPECK_BLOCK_SIZE] = { 0 };
+	uint32 start, blockTime, sealTime, openTime;
+	uint8 i;
+
+	start = TRACE_getMicroseconds();
+	for (i = 0; i < LINK_BENCHMARK_BLOCKS; i++)
+	{
+		SPECK_encryptBlock(&g_linkSession.encryptionKey, block);
+	}
+	blockTime = (TRACE_getMicroseconds() - start) / LINK_BENCHMARK_BLOCKS;
+
+	/* Works on a scratch frame, the session counters are left untouched */
+	memset(frame, 0, sizeof(frame));
+	LINK_buildHeader(frame, LINK_FRAME_DATA, LINK_MAX_PAYLOAD, 1);
+	start = TRACE_getMicroseconds();
+	LINK_seal(frame, g_linkConfig.role);
+	sealTime = TRACE_getMicroseconds() - start;
+
+	start = TRACE_getMicroseconds();
+	(void)LINK_open(frame, g_linkConfig.role);
+	openTime = TRACE_getMicroseconds() - start;
+
+	UART_sendByte(LINK_REPORT_SYNC1);
+	UART_sendByte(LINK_REPORT_SYNC2);
+	LINK_sendWord((uint16)blockTime);
+	LINK_sendWord((uint16)sealTime);
+	LINK_sendWord((uint16)openTime);
+}
+
+/*
+ * Description :
+ * Check a complete frame in g_linkRxFrame and act on it.
+ */
+static LINK_RxEventType LINK_processFrame(void)
+{
+	SPECK_CmacKeyType masterKey;
+	uint8 expectedTag[SPECK_BLOCK_SIZE];
+	uint8 receivedTag[LINK_TAG_SIZE];
+	uint8 length = g_linkRxFrame[LINK_LENGTH_OFFSET];
+	uint8 type = g_linkRxFrame[LINK_TYPE_OFFSET];
+	uint16 counter = g_linkRxFrame[LINK_COUNTER_OFFSET] | ((uint16)g_linkRxFrame[LINK_COUNTER_OFFSET + 1] << 8);
+	uint8 peerDirection = (g_linkConfig.role == LINK_ROLE_INITIATOR) ? LINK_ROLE_RESPONDER : LINK_ROLE_INITIATOR;
+
+	if (type == LINK_FRAME_DATA)
+	{
+		if (!g_linkSession.connected)
+		{
+			/* The responder lost the session (reset), the initiator must start a new one */
+			if (g_linkConfig.role == LINK_ROLE_RESPONDER)
+			{
+				LINK_connect();
+			}
+			return LINK_RX_NONE;
+		}
+		if (counter <= g_linkSession.rxCounter)
+			return LINK_RX_NONE;          /* Replayed or older frame */
+		if (!LINK_open(g_linkRxFrame, peerDirection))
+			return LINK_RX_NONE;
+
+		g_linkSession.rxCounter = counter;
+		memcpy(g_linkMessage, &g_linkRxFrame[LINK_PAYLOAD_OFFSET], length);
+		g_linkMessageLength = length;
+		return LINK_RX_MESSAGE;
+	}
+
+	/* Handshake frames are authenticated with the master key */
+	memcpy(receivedTag, &g_linkRxFrame[LINK_PAYLOAD_OFFSET + length], LINK_TAG_SIZE);
+	LINK_loadMasterKey(&masterKey);
+
+	if ((type == LINK_FRAME_HELLO) && (g_linkConfig.role == LINK_ROLE_RESPONDER) && (length == LINK_NONCE_SIZE))
+	{
+		LINK_computeTag(&masterKey, peerDirection, g_linkRxFrame, LINK_HEADER_SIZE + length, expectedTag);
+		if (!LINK_isTagValid(expectedTag, receivedTag))
+			return LINK_RX_NONE;
+
+		/* A replayed HELLO must not replace the keys of the live session */
+		if (!LINK_isPeerNonceFresh(&g_linkRxFrame[LINK_PAYLOAD_OFFSET]))
+			return LINK_RX_NONE;
+		LINK_acceptPeerNonce(&g_linkRxFrame[LINK_PAYLOAD_OFFSET]);
+
+		/* A fresh responder nonce makes any frame of an older session useless */
+		LINK_newNonce();
+		LINK_deriveSession(&masterKey, &g_linkRxFrame[LINK_PAYLOAD_OFFSET], g_linkLocalNonce);
+		LINK_sendHandshake(LINK_FRAME_HELLO_ACK, g_linkLocalNonce, &g_linkRxFrame[LINK_PAYLOAD_OFFSET]);
+		return LINK_RX_CONNECTED;
+	}
+	else if ((type == LINK_FRAME_HELLO_ACK) && g_linkHelloPending && (length == LINK_NONCE_SIZE))
+	{
+		/* The tag also covers the nonce of our HELLO, so an old HELLO_ACK cannot be replayed */
+		memcpy(&g_linkRxFrame[LINK_PAYLOAD_OFFSET + length], g_linkLocalNonce, LINK_NONCE_SIZE);
+		LINK_computeTag(&masterKey, peerDirection, g_linkRxFrame, LINK_HEADER_SIZE + (2 * LINK_NONCE_SIZE), expectedTag);
+		if (!LINK_isTagValid(expectedTag, receivedTag))
+			return LINK_RX_NONE;
+
+		g_linkHelloPending = FALSE;
+		LINK_acceptPeerNonce(&g_linkRxFrame[LINK_PAYLOAD_OFFSET]);
+		LINK_deriveSession(&masterKey, g_linkLocalNonce, &g_linkRxFrame[LINK_PAYLOAD_OFFSET]);
+		return LINK_RX_CONNECTED;
+	}
+	else if ((type == LINK_FRAME_REKEY) && (g_linkConfig.role == LINK_ROLE_INITIATOR) && (length == LINK_NONCE_SIZE))
+	{
+		/* Only a REKEY newer than every nonce of the responder seen so far ends the session */
+		LINK_computeTag(&masterKey, peerDirection, g_linkRxFrame, LINK_HEADER_SIZE + length, expectedTag);
+		if (LINK_isTagValid(expectedTag, receivedTag) && LINK_isPeerNonceFresh(&g_linkRxFrame[LINK_PAYLOAD_OFFSET]))
+		{
+			LINK_acceptPeerNonce(&g_linkRxFrame[LINK_PAYLOAD_OFFSET]);
+			LINK_connect();
+		}
+	}
+
+	return LINK_RX_NONE;
+}
+
+/*
+ * Description :
+ * Expand the master key from flash, used only during the nonce exchange.
+ */
+static void LINK_loadMasterKey(SPECK_CmacKeyType *masterKey)
+{
+	uint8 keyBytes[SPECK_KEY_SIZE];
+
+	memcpy_P(keyBytes, g_linkMasterKey, SPECK_KEY_SIZE);
+	SPECK_cmacSetKey(masterKey, keyBytes);
+	memset(keyBytes, 0, SPECK_KEY_SIZE);
+}
+
+/*
+ * Description :
+ * Nonce = boot counter (unique across resets) + nonce count (unique in this boot) + timer jitter.
+ */
+static void LINK_newNonce(void)
+{
+	uint16 jitter = TCNT1;
+
+	memcpy(g_linkLocalNonce, &g_linkBootCounter, sizeof(g_linkBootCounter));
+	g_linkLocalNonce[4] = (uint8)g_linkNonceCount;
+	g_linkLocalNonce[5] = (uint8)(g_linkNonceCount >> 8);
+	g_linkLocalNonce[6] = (uint8)jitter;
+	g_linkLocalNonce[7] = (uint8)(jitter >> 8);
+	g_linkNonceCount++;
+}
+
+/*
+ * Description :
+ * Return TRUE if a nonce of the peer is newer than the last one accepted: its boot counter
+ * and nonce count (see LINK_newNonce) only grow, the jitter bytes are not compared.
+ */
+static uint8 LINK_isPeerNonceFresh(const uint8 *nonce)
+{
+	uint32 bootCounter;
+	uint16 nonceCount = nonce[4] | ((uint16)nonce[5] << 8);
+
+	memcpy(&bootCounter, nonce, sizeof(bootCounter));
+	if (!g_linkPeerNonceSeen || (bootCounter > g_linkPeerBootCounter))
+		return TRUE;
+
+	return (bootCounter == g_linkPeerBootCounter) && (nonceCount > g_linkPeerNonceCount);
+}
+
+static void LINK_acceptPeerNonce(const uint8 *nonce)
+{
+	memcpy(&g_linkPeerBootCounter, nonce, sizeof(g_linkPeerBootCounter));
+	g_linkPeerNonceCount = nonce[4] | ((uint16)nonce[5] << 8);
+	g_linkPeerNonceSeen = TRUE;
+}
+
+/*
+ * Description :
+ * Derive the encryption and authentication keys of the session from both nonces:
+ * key = CMAC(master, label || index || initiatorNonce || responderNonce) for index 0 and 1.
+ */
+static void LINK_deriveSession(const SPECK_CmacKeyType *masterKey, const uint8 *initiatorNonce, const uint8 *responderNonce)
+{
+	uint8 input[2 + (2 * LINK_NONCE_SIZE)];
+	uint8 keyBytes[SPECK_KEY_SIZE];
+
+	memcpy(&input[2], initiatorNonce, LINK_NONCE_SIZE);
+	memcpy(&input[2 + LINK_NONCE_SIZE], responderNonce, LINK_NONCE_SIZE);
+
+	input[0] = LINK_LABEL_ENCRYPTION;
+	input[1] = 0;
+	SPECK_cmac(masterKey, input, sizeof(input), NULL_PTR, 0, keyBytes);
+	input[1] = 1;
+	SPECK_cmac(masterKey, input, sizeof(input), NULL_PTR, 0, &keyBytes[SPECK_BLOCK_SIZE]);
+	SPECK_setKey(&g_linkSession.encryptionKey, keyBytes);
+
+	input[0] = LINK_LABEL_AUTHENTICATION;
+	input[1] = 0;
+	SPECK_cmac(masterKey, input, sizeof(input), NULL_PTR, 0, keyBytes);
+	input[1] = 1;
+	SPECK_cmac(masterKey, input, sizeof(input), NULL_PTR, 0, &keyBytes[SPECK_BLOCK_SIZE]);
+	SPECK_cmacSetKey(&g_linkSession.authenticationKey, keyBytes);
+
+	memset(keyBytes, 0, SPECK_KEY_SIZE);
+	g_linkSession.txCounter = 0;
+	g_linkSession.rxCounter = 0;
+	g_linkSession.connected = TRUE;
+}
+
+/*
+ * Description :
+ * CMAC of the sender direction followed by the data, the direction stops a frame
+ * from being reflected back to its sender.
+ */
+static void LINK_computeTag(const SPECK_CmacKeyType *key, uint8 direction, const uint8 *data, uint8 length, uint8 *tag)
+{
+	SPECK_cmac(key, &direction, 1, data, length, tag);
+}
+
+/*
+ * Description :
+ * Compare the truncated tags in constant time.
+ */
+static uint8 LINK_isTagValid(const uint8 *expected, const uint8 *received)
+{
+	volatile uint8 difference = 0;
+	uint8 i;
+
+	for (i = 0; i < LINK_TAG_SIZE; i++)
+	{
+		difference |= expected[i] ^ received[i];
+	}
+	return (difference == 0) ? TRUE : FALSE;
+}
+
+static void LINK_buildHeader(uint8 *frame, LINK_FrameType type, uint8 length, uint16 counter)
+{
+	frame[LINK_LENGTH_OFFSET] = length;
+	frame[LINK_TYPE_OFFSET] = type;
+	frame[LINK_COUNTER_OFFSET] = (uint8)counter;
+	frame[LINK_COUNTER_OFFSET + 1] = (uint8)(counter >> 8);
+}
+
+/*
+ * Description :
+ * Encrypt the payload in CTR mode (nonce = direction || counter || 0) then append
+ * the tag of the header and the ciphertext (encrypt-then-MAC).
+ */
+static void LINK_seal(uint8 *frame, uint8 direction)
+{
+	uint8 nonce[SPECK_BLOCK_SIZE - 1] = { 0 };
+	uint8 tag[SPECK_BLOCK_SIZE];
+	uint8 length = frame[LINK_LENGTH_OFFSET];
+
+	nonce[0] = direction;
+	nonce[1] = frame[LINK_COUNTER_OFFSET];
+	nonce[2] = frame[LINK_COUNTER_OFFSET + 1];
+	SPECK_ctr(&g_linkSession.encryptionKey, nonce, &frame[LINK_PAYLOAD_OFFSET], length);
+
+	LINK_computeTag(&g_linkSession.authenticationKey, direction, frame, LINK_HEADER_SIZE + length, tag);
+	memcpy(&frame[LINK_PAYLOAD_OFFSET + length], tag, LINK_TAG_SIZE);
+}
+
+/*
+ * Description :
+ * Check the tag of a sealed frame and decrypt its payload in place, return FALSE if forged.
+ */
+static uint8 LINK_open(uint8 *frame, uint8 direction)
+{
+	uint8 nonce[SPECK_BLOCK_SIZE - 1] = { 0 };
+	uint8 tag[SPECK_BLOCK_SIZE];
+	uint8 length = frame[LINK_LENGTH_OFFSET];
+
+	LINK_computeTag(&g_linkSession.authenticationKey, direction, frame, LINK_HEADER_SIZE + length, tag);
+	if (!LINK_isTagValid(tag, &frame[LINK_PAYLOAD_OFFSET + length]))
+		return FALSE;
+
+	nonce[0] = direction;
+	nonce[1] = frame[LINK_COUNTER_OFFSET];
+	nonce[2] = frame[LINK_COUNTER_OFFSET + 1];
+	SPECK_ctr(&g_linkSession.encryptionKey, nonce, &frame[LINK_PAYLOAD_OFFSET], length);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Send a HELLO, HELLO_ACK (nonce + tag also covering the bound nonce) or REKEY (nonce)
+ * frame authenticated with the master key.
+ */
+static void LINK_sendHandshake(LINK_FrameType type, const uint8 *nonce, const uint8 *boundNonce)
+{
+	SPECK_CmacKeyType masterKey;
+	uint8 tag[SPECK_BLOCK_SIZE];
+	uint8 length = (nonce != NULL_PTR) ? LINK_NONCE_SIZE : 0;
+	uint8 tagInputLength = LINK_HEADER_SIZE + length;
+	uint8 *frame = LINK_nextTxFrame();
+
+	LINK_buildHeader(frame, type, length, 0);
+	if (nonce != NULL_PTR)
+	{
+		memcpy(&frame[LINK_PAYLOAD_OFFSET], nonce, LINK_NONCE_SIZE);
+	}
+	if (boundNonce != NULL_PTR)
+	{
+		memcpy(&frame[LINK_PAYLOAD_OFFSET + length], boundNonce, LINK_NONCE_SIZE);
+		tagInputLength += LINK_NONCE_SIZE;
+	}
+
+	LINK_loadMasterKey(&masterKey);
+	LINK_computeTag(&masterKey, g_linkConfig.role, frame, tagInputLength, tag);
+	memcpy(&frame[LINK_PAYLOAD_OFFSET + length], tag, LINK_TAG_SIZE);
+	LINK_sendFrame(frame);
+}
+
+/*
+ * Description :
+ * Return the frame buffer that is not on the wire: the UART starts a transmission only
+ * once the previous one is over, so the frame sent before the last one is free.
+ */
+static uint8* LINK_nextTxFrame(void)
+{
+	g_linkTxFrameIndex ^= 1;
+	return g_linkTxFrames[g_linkTxFrameIndex];
+}
+
+/*
+ * Description :
+ * Start the transmission of the SOF and the frame without copying them, it goes on
+ * from the UART interrupts while the next message is sealed.
+ */
+static void LINK_sendFrame(const uint8 *frame)
+{
+	UART_SegmentType segments[2];
+
+	segments[0].data = &g_linkSof;
+	segments[0].length = 1;
+	segments[1].data = frame;
+	segments[1].length = LINK_HEADER_SIZE + frame[LINK_LENGTH_OFFSET] + LINK_TAG_SIZE;
+	TRACE_record(TRACE_EVT_LINK_TX, ((uint16)frame[LINK_TYPE_OFFSET] << 8) | frame[LINK_LENGTH_OFFSET]);
+	UART_sendGatherAsync(segments, 2, NULL_PTR);
+}
+
+/*
+ * Description :
+ * Send a 16-bit value through UART, low byte first.
+ */
+static void LINK_sendWord(uint16 data)
+{
+	UART_sendByte((uint8)data);
+	UART_sendByte((uint8)(data >> 8));
+}
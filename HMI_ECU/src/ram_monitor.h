@@ -0,0 +1,70 @@
+ /******************************************************************************
+ *
+ * Module: RAM MONITOR
+ *
+ * File Name: ram_monitor.h
+ *
+ * Description: Header file for the stack painting and RAM high-water-mark monitor
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#ifndef RAM_MONITOR_H_
+#define RAM_MONITOR_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Value written in all the free RAM (between the end of .noinit and RAMEND) at boot */
+#define RAMMON_PAINT_BYTE          0xC5
+
+/* Number of application states (TRACE_setState IDs) tracked separately */
+#define RAMMON_MAX_STATES          28
+
+/* Sync bytes that start the report sent over the UART */
+#define RAMMON_REPORT_SYNC1        'R'
+#define RAMMON_REPORT_SYNC2        'M'
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Clear the per-state statistics, the stack itself is painted before main
+ * by RAMMON_paintStack which is placed in the .init3 section.
+ */
+void RAMMON_init(void);
+
+/*
+ * Description :
+ * Sample the stack pointer and the painted area and charge any new stack depth
+ * to the current application state, meant to be called periodically from the timer ISR.
+ */
+void RAMMON_sample(void);
+
+/*
+ * Description :
+ * Return the number of RAM bytes that the stack never reached since boot.
+ */
+uint16 RAMMON_getFreeRam(void);
+
+/*
+ * Description :
+ * Return the deepest stack usage in bytes since boot.
+ */
+uint16 RAMMON_getStackHighWaterMark(void);
+
+/*
+ * Description :
+ * Send the report through UART, all 16-bit values are little-endian:
+ * 'R' 'M' staticRam(2) stackHighWaterMark(2) freeRam(2) numberOfStates stateStackUsage(2*numberOfStates)
+ * A state that was never sampled reports a stack usage of 0.
+ */
+void RAMMON_sendReport(void);
+
+#endif /* RAM_MONITOR_H_ */
@@ -0,0 +1,208 @@
+ /******************************************************************************
+ *
+ * Module: SPECK
+ *
+ * File Name: speck.c
+ *
+ * Description: Source file for the Speck64/128 block cipher with CTR mode and CMAC
+ *
+ * Author: Mostafa Mahmoud
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include "speck.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Speck only needs additions, XORs and the rotations by 8 and 3: the first one is
+ * byte moves for avr-gcc and the second one is 3 single bit rotations, which is why
+ * it is one of the cheapest 64-bit block ciphers on an 8-bit MCU.
+ */
+#define ROR8(x)        (((x) >> 8) | ((x) << 24))
+#define ROL8(x)        (((x) << 8) | ((x) >> 24))
+
+/* Constant of the subkeys doubling in GF(2^64) */
+#define SPECK_CMAC_RB  0x1B
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+static inline uint32 SPECK_rol3(uint32 x);
+static inline uint32 SPECK_loadWord(const uint8 *bytes);
+static inline void SPECK_storeWord(uint8 *bytes, uint32 word);
+static void SPECK_doubleSubkey(const uint8 *in, uint8 *out);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Expand a 16-byte key (little-endian words, as in the Speck reference test vectors).
+ */
+void SPECK_setKey(SPECK_KeyType *key, const uint8 *keyBytes)
+{
+	uint32 k = SPECK_loadWord(keyBytes);
+	uint32 l[3];
+	uint8 i;
+
+	l[0] = SPECK_loadWord(keyBytes + 4);
+	l[1] = SPECK_loadWord(keyBytes + 8);
+	l[2] = SPECK_loadWord(keyBytes + 12);
+
+	for (i = 0; i < SPECK_ROUNDS; i++)
+	{
+		key->roundKeys[i] = k;
+		/* l[i+3] = (k[i] + ROR8(l[i])) ^ i, kept in a window of 3 words */
+		l[i % 3] = (k + ROR8(l[i % 3])) ^ i;
+		k = SPECK_rol3(k) ^ l[i % 3];
+	}
+}
+
+/*
+ * Description :
+ * Encrypt one 8-byte block in place.
+ */
+void SPECK_encryptBlock(const SPECK_KeyType *key, uint8 *block)
+{
+	uint32 y = SPECK_loadWord(block);
+	uint32 x = SPECK_loadWord(block + 4);
+	uint8 i;
+
+	for (i = 0; i < SPECK_ROUNDS; i++)
+	{
+		x = (ROR8(x) + y) ^ key->roundKeys[i];
+		y = SPECK_rol3(y) ^ x;
+	}
+
+	SPECK_storeWord(block, y);
+	SPECK_storeWord(block + 4, x);
+}
+
+/*
+ * Description :
+ * Encrypt or decrypt (the same operation) data in CTR mode. The counter block is
+ * the 7-byte nonce followed by the block index, so up to 256 blocks per nonce.
+ */
+void SPECK_ctr(const SPECK_KeyType *key, const uint8 *nonce, uint8 *data, uint8 length)
+{
+	uint8 keyStream[SPECK_BLOCK_SIZE];
+	uint8 blockIndex = 0;
+	uint8 i;
+
+	while (length != 0)
+	{
+		memcpy(keyStream, nonce, SPECK_BLOCK_SIZE - 1);
+		keyStream[SPECK_BLOCK_SIZE - 1] = blockIndex;
+		SPECK_encryptBlock(key, keyStream);
+
+		for (i = 0; (i < SPECK_BLOCK_SIZE) && (length != 0); i++)
+		{
+			*data ^= keyStream[i];
+			data++;
+			length--;
+		}
+		blockIndex++;
+	}
+}
+
+/*
+ * Description :
+ * Expand the key and compute the CMAC subkeys.
+ */
+void SPECK_cmacSetKey(SPECK_CmacKeyType *cmacKey, const uint8 *keyBytes)
+{
+	uint8 l[SPECK_BLOCK_SIZE] = { 0 };
+
+	SPECK_setKey(&cmacKey->key, keyBytes);
+	SPECK_encryptBlock(&cmacKey->key, l);
+	SPECK_doubleSubkey(l, cmacKey->k1);
+	SPECK_doubleSubkey(cmacKey->k1, cmacKey->k2);
+}
+
+/*
+ * Description :
+ * Compute the CMAC of up to two concatenated buffers (the second may be NULL_PTR),
+ * the 8-byte tag is written to tag.
+ */
+void SPECK_cmac(const SPECK_CmacKeyType *cmacKey, const uint8 *data1, uint8 length1,
+		const uint8 *data2, uint8 length2, uint8 *tag)
+{
+	uint16 total = (uint16)length1 + length2;
+	uint16 i;
+	uint8 position = 0;
+
+	memset(tag, 0, SPECK_BLOCK_SIZE);
+
+	for (i = 0; i < total; i++)
+	{
+		/* A full block is only encrypted once it is known not to be the last one */
+		if (position == SPECK_BLOCK_SIZE)
+		{
+			SPECK_encryptBlock(&cmacKey->key, tag);
+			position = 0;
+		}
+		tag[position] ^= (i < length1) ? data1[i] : data2[i - length1];
+		position++;
+	}
+
+	if (position == SPECK_BLOCK_SIZE)
+	{
+		for (i = 0; i < SPECK_BLOCK_SIZE; i++)
+		{
+			tag[i] ^= cmacKey->k1[i];
+		}
+	}
+	else
+	{
+		tag[position] ^= 0x80;
+		for (i = 0; i < SPECK_BLOCK_SIZE; i++)
+		{
+			tag[i] ^= cmacKey->k2[i];
+		}
+	}
+	SPECK_encryptBlock(&cmacKey->key, tag);
+}
+
+static inline uint32 SPECK_rol3(uint32 x)
+{
+	return (x << 3) | (x >> 29);
+}
+
+static inline uint32 SPECK_loadWord(const uint8 *bytes)
+{
+	return ((uint32)bytes[3] << 24) | ((uint32)bytes[2] << 16) | ((uint16)bytes[1] << 8) | bytes[0];
+}
+
+static inline void SPECK_storeWord(uint8 *bytes, uint32 word)
+{
+	bytes[0] = (uint8)word;
+	bytes[1] = (uint8)(word >> 8);
+	bytes[2] = (uint8)(word >> 16);
+	bytes[3] = (uint8)(word >> 24);
+}
+
+/*
+ * Description :
+ * Multiply a subkey by x in GF(2^64), the block is a big-endian bit string as in the CMAC specification.
+ */
+static void SPECK_doubleSubkey(const uint8 *in, uint8 *out)
+{
+	uint8 carry = in[0] >> 7;
+	uint8 i;
+
+	for (i = 0; i < SPECK_BLOCK_SIZE - 1; i++)
+	{
+		out[i] = (uint8)(in[i] << 1) | (in[i + 1] >> 7);
+	}
+	out[SPECK_BLOCK_SIZE - 1] = (uint8)(in[SPECK_BLOCK_SIZE - 1] << 1);
+	if (carry)
+	{
+		out[SPECK_BLOCK_SIZE - 1] ^= SPECK_CMAC_RB;
+	}
+}
@@ -14,6 +14,7 @@
 #include <avr/interrupt.h>
 #include "timer.h"
 #include "Macros.h"
+#include "trace.h"
 
 /*******************************************************************************
  *                           Global variables                                  *
@@ -37,6 +38,8 @@ ISR(TIMER0_COMP_vect)
 {
 	if (g_Timer0_CallBackPtr != NULL_PTR)
 	{
+		TRACE_record(TRACE_EVT_TIMER_CALLBACK, (TIMER0 << 8) | 1);
+
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_Timer0_CallBackPtr)(); /* another method to call the function using pointer to function g_Timer0_CallBackPtr */
 	}
@@ -47,6 +50,8 @@ ISR(TIMER0_OVF_vect)
 {
 	if (g_Timer0_CallBackPtr != NULL_PTR)
 	{
+		TRACE_record(TRACE_EVT_TIMER_CALLBACK, (TIMER0 << 8) | 1);
+
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_Timer0_CallBackPtr)(); /* another method to call the function using pointer to function g_Timer0_CallBackPtr */
 	}
@@ -56,8 +61,13 @@ ISR(TIMER0_OVF_vect)
 
 ISR(TIMER1_COMPA_vect)
 {
+	/* Timer1 compare match is the time base of the trace timestamps */
+	TRACE_timerTick();
+
 	if (g_Timer1_CallBackPtr != NULL_PTR)
 	{
+		TRACE_record(TRACE_EVT_TIMER_CALLBACK, (TIMER1 << 8) | 1);
+
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_Timer1_CallBackPtr)(); /* another method to call the function using pointer to function g_Timer1_CallBackPtr */
 	}
@@ -68,6 +78,8 @@ ISR(TIMER1_OVF_vect)
 {
 	if (g_Timer1_CallBackPtr != NULL_PTR)
 	{
+		TRACE_record(TRACE_EVT_TIMER_CALLBACK, (TIMER1 << 8) | 1);
+
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_Timer1_CallBackPtr)(); /* another method to call the function using pointer to function g_Timer1_CallBackPtr */
 	}
@@ -77,6 +89,8 @@ ISR(TIMER2_COMP_vect)
 {
 	if (g_Timer2_CallBackPtr != NULL_PTR)
 	{
+		TRACE_record(TRACE_EVT_TIMER_CALLBACK, (TIMER2 << 8) | 1);
+
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_Timer2_CallBackPtr)(); /* another method to call the function using pointer to function g_Timer2_CallBackPtr */
 	}
@@ -87,6 +101,8 @@ ISR(TIMER2_OVF_vect)
 {
 	if (g_Timer2_CallBackPtr != NULL_PTR)
 	{
+		TRACE_record(TRACE_EVT_TIMER_CALLBACK, (TIMER2 << 8) | 1);
+
 		/* Call the Call Back function in the application after the edge is detected */
 		(*g_Timer2_CallBackPtr)(); /* another method to call the function using pointer to function g_Timer2_CallBackPtr */
 	}
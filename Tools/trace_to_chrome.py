@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+Module: TRACE host tool
+
+File Name: trace_to_chrome.py
+
+Description: Convert the trace dump frames sent by TRACE_dump() on the HMI or
+             Control ECU into Chrome trace_event JSON (open it with
+             chrome://tracing or https://ui.perfetto.dev).
+
+Usage:
+    # Convert a raw capture of the ECU TX line
+    trace_to_chrome.py capture.bin -o trace.json
+
+    # Send TRACE_DUMP_REQUEST to an ECU through a USB-UART adapter and convert the answer
+    trace_to_chrome.py --port /dev/ttyUSB0 -o trace.json
+
+Each boot session found in the ring is shown as its own process, application
+states are shown as spans (the latency of each handshake phase), and the
+UART/EEPROM/timer events are shown as instant events on separate threads.
+
+Author: Mostafa Mahmoud
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_DUMP_REQUEST = 0x40
+FRAME_SYNC = b"TR"
+HEADER_FORMAT = "<BBHB"          # ecuId, usPerCount, bootCount, count
+RECORD_FORMAT = "<IBH"           # timestamp, event, arg
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+ECU_NAMES = {0x01: "HMI_ECU", 0x02: "CONTROL_ECU"}
+
+(EVT_BOOT, EVT_STATE, EVT_UART_RX, EVT_UART_TX, EVT_EEPROM_READ, EVT_EEPROM_WRITE, EVT_TIMER_CALLBACK,
+ EVT_RESET_CAUSE, EVT_WATCHDOG, EVT_UART_ERROR, EVT_BAUD_CHANGE, EVT_LINK_TX, EVT_LINK_RX) = range(13)
+
+UART_ERRORS = {1: "overrun", 2: "frame error", 3: "parity error", 4: "break"}
+
+BAUD_RATES = (9600, 38400, 76800, 125000, 250000)      # UART_BaudType
+
+LINK_FRAME_TYPES = {1: "DATA", 2: "HELLO", 3: "HELLO_ACK", 4: "REKEY"}          # LINK_FrameType
+LINK_RX_RESULTS = {0: "none", 2: "message", 3: "connected"}                      # LINK_RxEventType
+
+RESET_FLAGS = ((0x01, "PORF"), (0x02, "EXTRF"), (0x04, "BORF"), (0x08, "WDRF"), (0x10, "JTRF"))
+
+STATE_NAMES = {
+    0x01: {
+        0x00: "MAIN_MENU", 0x01: "ENTER_PASSWORD", 0x02: "NEW_PASSWORD",
+        0x03: "WAIT_NEW_READY", 0x04: "CONFIRM_PASSWORD", 0x05: "WAIT_CONFIRM_READY",
+        0x06: "WAIT_MATCH_READY", 0x07: "WAIT_MATCH_STATUS", 0x08: "WAIT_RESPONSE",
+        0x09: "DOOR_UNLOCKING", 0x0A: "DOOR_OPEN", 0x0B: "DOOR_LOCKING",
+        0x0C: "WRONG_PASSWORD", 0x0D: "PASSWORD_MISMATCH", 0x0E: "KEYPAD_LOCKED",
+        0x0F: "RESET_REPORT", 0x10: "WAIT_SYSTEM_STATUS", 0x11: "ENTER_CODE",
+        0x12: "CODE_UNAVAILABLE", 0x13: "USER_MENU", 0x14: "ADMIN_PASSWORD", 0x15: "USER_ID",
+        0x16: "USER_CODE", 0x17: "WAIT_USER_RESULT", 0x18: "USER_RESULT", 0x19: "USER_COUNT",
+        0x1A: "CONTROLLER_OFFLINE",
+    },
+    0x02: {
+        0x00: "WAIT_COMMAND", 0x01: "RECEIVE_COMMAND", 0x02: "WAIT_PASSWORD",
+        0x03: "RECEIVE_PASSWORD", 0x04: "WAIT_CONFIRMATION", 0x05: "RECEIVE_CONFIRMATION",
+        0x06: "STORE_PASSWORD", 0x07: "OPEN_DOOR", 0x08: "LOCKED_OUT",
+    },
+}
+
+LINK_BYTE_NAMES = {
+    0x10: "READY_TO_SEND", 0x20: "READY_TO_RECEIVE", 0x18: "CHANGE_PASSWORD_OPTION",
+    0x19: "OPEN_DOOR_OPTION", 0x31: "UNLOCKING_DOOR", 0x35: "DOOR_PROGRESS",
+    0x25: "WRONG_PASSWORD", 0x26: "LOCKOUT_STATUS", 0x12: "SYSTEM_STATUS_REQUEST",
+    0x32: "SYSTEM_READY", 0x33: "PASSWORD_NOT_SET", 0x40: "TRACE_DUMP_REQUEST",
+    0x41: "RESET_REPORT_REQUEST", 0x42: "RAM_REPORT_REQUEST", 0x43: "HASH_BENCHMARK_REQUEST",
+    0x44: "LINK_BENCHMARK_REQUEST", 0x45: "OTP_BENCHMARK_REQUEST", 0x46: "CLOCK_SET_REQUEST",
+    0x47: "AUDIT_QUERY_REQUEST", 0x48: "CONFIG_SET_REQUEST", 0x49: "CONFIG_DUMP_REQUEST",
+    0x4A: "COUNTERS_REQUEST", 0x4B: "FLASH_LOG_QUERY_REQUEST",
+    0x4C: "CRC_BENCHMARK_REQUEST", 0x4D: "LINE_ERRORS_REQUEST", 0x4E: "HEARTBEAT_REPORT_REQUEST",
+    0x50: "USER_ADD_REQUEST", 0x51: "USER_REVOKE_REQUEST", 0x52: "USER_LIST_REQUEST",
+    0x53: "USER_ENTRY", 0x54: "USER_LIST_END", 0x55: "USER_RESULT", 0x7E: "LINK_SOF",
+}
+
+THREAD_STATE, THREAD_UART, THREAD_EEPROM, THREAD_TIMER = 1, 2, 3, 4
+THREAD_NAMES = {THREAD_STATE: "state", THREAD_UART: "uart", THREAD_EEPROM: "eeprom", THREAD_TIMER: "timer"}
+
+
+def parse_frames(data):
+    """Yield (ecu_id, us_per_count, boot_count, records) for every valid frame in data."""
+    pos = 0
+    header_size = struct.calcsize(HEADER_FORMAT)
+    while True:
+        pos = data.find(FRAME_SYNC, pos)
+        if pos < 0:
+            return
+        start = pos + len(FRAME_SYNC)
+        header = data[start:start + header_size]
+        if len(header) < header_size:
+            return
+        ecu_id, us_per_count, boot_count, count = struct.unpack(HEADER_FORMAT, header)
+        body_end = start + header_size + count * RECORD_SIZE
+        if body_end + 1 > len(data):
+            return
+        if (sum(data[start:body_end]) & 0xFF) != data[body_end]:
+            pos += 1                    # Sync bytes matched inside other traffic, keep looking
+            continue
+        records = [struct.unpack_from(RECORD_FORMAT, data, start + header_size + i * RECORD_SIZE)
+                   for i in range(count)]
+        yield ecu_id, us_per_count, boot_count, records
+        pos = body_end + 1
+
+
+def split_sessions(records, boot_count):
+    """Split the ring at BOOT events, the timestamps restart from zero after every reset."""
+    boots = [arg for _, event, arg in records if event == EVT_BOOT]
+    sessions = []
+    current = None
+    for record in records:
+        if record[1] == EVT_BOOT:
+            current = (record[2], [])
+            sessions.append(current)
+            continue
+        if current is None:
+            # The BOOT record of the oldest session was overwritten by newer records
+            current = ((boots[0] - 1) if boots else boot_count, [])
+            sessions.append(current)
+        current[1].append(record)
+    return sessions
+
+
+def to_chrome_events(ecu_id, us_per_count, boot_count, records):
+    ecu_name = ECU_NAMES.get(ecu_id, "ECU_%d" % ecu_id)
+    state_names = STATE_NAMES.get(ecu_id, {})
+    events = []
+
+    for boot, session in split_sessions(records, boot_count):
+        pid = ecu_id * 0x10000 + boot
+        events.append({"ph": "M", "pid": pid, "name": "process_name",
+                       "args": {"name": "%s boot #%d" % (ecu_name, boot)}})
+        for tid, name in THREAD_NAMES.items():
+            events.append({"ph": "M", "pid": pid, "tid": tid, "name": "thread_name", "args": {"name": name}})
+
+        open_state = None
+        last_ts = 0
+        for timestamp, event, arg in session:
+            ts = timestamp * us_per_count
+            last_ts = ts
+            if event == EVT_STATE:
+                if open_state is not None:
+                    events.append({"ph": "E", "pid": pid, "tid": THREAD_STATE, "ts": ts})
+                open_state = state_names.get(arg, "STATE_0x%02X" % arg)
+                events.append({"ph": "B", "pid": pid, "tid": THREAD_STATE, "ts": ts, "name": open_state})
+            elif event in (EVT_UART_RX, EVT_UART_TX):
+                direction = "RX" if event == EVT_UART_RX else "TX"
+                name = "%s %s" % (direction, LINK_BYTE_NAMES.get(arg, "0x%02X" % arg))
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_UART, "ts": ts, "name": name})
+            elif event == EVT_UART_ERROR:
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_UART, "ts": ts,
+                               "name": "RX %s" % UART_ERRORS.get(arg >> 8, "error %d" % (arg >> 8)),
+                               "args": {"byte": "0x%02X" % (arg & 0xFF)}})
+            elif event in (EVT_LINK_TX, EVT_LINK_RX):
+                frame_type = LINK_FRAME_TYPES.get((arg >> 8) & 0x0F, "type %d" % ((arg >> 8) & 0x0F))
+                args = {"length": arg & 0xFF}
+                if event == EVT_LINK_RX:
+                    args["result"] = LINK_RX_RESULTS.get(arg >> 12, "result %d" % (arg >> 12))
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_UART, "ts": ts,
+                               "name": "%s %s" % ("TX" if event == EVT_LINK_TX else "RX", frame_type),
+                               "args": args})
+            elif event == EVT_BAUD_CHANGE:
+                baud = BAUD_RATES[arg] if arg < len(BAUD_RATES) else "rate %d" % arg
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_UART, "ts": ts,
+                               "name": "baud %s" % baud})
+            elif event in (EVT_EEPROM_READ, EVT_EEPROM_WRITE):
+                operation = "read" if event == EVT_EEPROM_READ else "write"
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_EEPROM, "ts": ts,
+                               "name": "EEPROM %s" % operation, "args": {"address": "0x%04X" % arg}})
+            elif event == EVT_TIMER_CALLBACK:
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_TIMER, "ts": ts,
+                               "name": "TIMER%d callback" % (arg >> 8), "args": {"calls": arg & 0xFF}})
+            elif event == EVT_RESET_CAUSE:
+                flags = [name for mask, name in RESET_FLAGS if (arg >> 8) & mask]
+                stalled_task = arg & 0xFF
+                events.append({"ph": "i", "s": "p", "pid": pid, "tid": THREAD_STATE, "ts": ts,
+                               "name": "reset: %s" % "|".join(flags or ["none"]),
+                               "args": {"stalled_task": None if stalled_task == 0xFF else stalled_task}})
+            elif event == EVT_WATCHDOG:
+                events.append({"ph": "i", "s": "p", "pid": pid, "tid": THREAD_STATE, "ts": ts,
+                               "name": "watchdog: task %d stalled" % (arg >> 8),
+                               "args": {"state": state_names.get(arg & 0xFF, "STATE_0x%02X" % (arg & 0xFF))}})
+            else:
+                events.append({"ph": "i", "s": "t", "pid": pid, "tid": THREAD_STATE, "ts": ts,
+                               "name": "event %d" % event, "args": {"arg": arg}})
+
+        # The last state is the one the ECU was in when the dump was taken (or when it hung)
+        if open_state is not None:
+            events.append({"ph": "E", "pid": pid, "tid": THREAD_STATE, "ts": last_ts})
+
+    return events
+
+
+def read_from_port(port, baud, timeout):
+    import serial  # pyserial, only needed for live capture
+
+    with serial.Serial(port, baud, timeout=timeout) as link:
+        link.reset_input_buffer()
+        link.write(bytes([TRACE_DUMP_REQUEST]))
+        data = bytearray()
+        while True:
+            chunk = link.read(256)
+            if not chunk:
+                return bytes(data)
+            data.extend(chunk)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert ECU trace dumps to Chrome trace_event JSON")
+    parser.add_argument("capture", nargs="?", help="raw capture of the ECU UART TX line")
+    parser.add_argument("--port", help="serial port to request a dump from")
+    parser.add_argument("--baud", type=int, default=9600,
+                        help="rate of the ECU UART: 9600 at boot, the negotiated rate once the link is up")
+    parser.add_argument("--timeout", type=float, default=2.0)
+    parser.add_argument("-o", "--output", default="-")
+    args = parser.parse_args()
+
+    if args.port:
+        data = read_from_port(args.port, args.baud, args.timeout)
+    elif args.capture:
+        with open(args.capture, "rb") as capture:
+            data = capture.read()
+    else:
+        parser.error("either a capture file or --port is required")
+
+    events = []
+    for frame in parse_frames(data):
+        events.extend(to_chrome_events(*frame))
+    if not events:
+        sys.exit("no valid trace frame found")
+
+    output = json.dumps({"traceEvents": events, "displayTimeUnit": "ms"}, indent=1)
+    if args.output == "-":
+        print(output)
+    else:
+        with open(args.output, "w") as out:
+            out.write(output)
+
+
+if __name__ == "__main__":
+    main()